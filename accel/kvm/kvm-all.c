@@ -73,6 +73,8 @@
 struct KVMParkedVcpu {
     unsigned long vcpu_id;
     int kvm_fd;
+    /* The kernel keeps its position in the dirty ring */
+    uint32_t kvm_fetch_index;
     QLIST_ENTRY(KVMParkedVcpu) node;
 };
 
@@ -102,6 +104,11 @@ struct KVMState
     OnOffAuto kernel_irqchip_split;
     bool sync_mmu;
     uint64_t manual_dirty_log_protect;
+    /* Number of entries in each vCPU dirty ring, 0 without dirty rings */
+    uint32_t kvm_dirty_ring_size;
+    /* Size of each vCPU dirty ring in bytes */
+    uint32_t kvm_dirty_ring_bytes;
+    QemuThread dirty_ring_reaper;
     /* The man page (and posix) say ioctl numbers are signed int, but
      * they're not.  Linux, glibc and *BSD all treat ioctl numbers as
      * unsigned, and treating them as signed here can break things */
@@ -174,8 +181,16 @@ typedef struct KVMResampleFd KVMResampleFd;
 static QLIST_HEAD(, KVMResampleFd) kvm_resample_fd_list =
     QLIST_HEAD_INITIALIZER(kvm_resample_fd_list);
 
-#define kvm_slots_lock(kml)      qemu_mutex_lock(&(kml)->slots_lock)
-#define kvm_slots_unlock(kml)    qemu_mutex_unlock(&(kml)->slots_lock)
+/*
+ * Protects the slots of all the KVMMemoryListeners, because the dirty
+ * rings are shared by all the address spaces.
+ */
+static QemuMutex kml_slots_lock;
+
+#define kvm_slots_lock()    qemu_mutex_lock(&kml_slots_lock)
+#define kvm_slots_unlock()  qemu_mutex_unlock(&kml_slots_lock)
+
+static uint64_t kvm_dirty_ring_reap(KVMState *s);
 
 static inline void kvm_resample_fd_remove(int gsi)
 {
@@ -240,7 +255,7 @@ int kvm_memcrypt_encrypt_data(uint8_t *ptr, uint64_t len)
     return 1;
 }
 
-/* Called with KVMMemoryListener.slots_lock held */
+/* Called with kvm_slots_lock() held */
 static KVMSlot *kvm_get_free_slot(KVMMemoryListener *kml)
 {
     KVMState *s = kvm_state;
@@ -261,14 +276,14 @@ bool kvm_has_free_slot(MachineState *ms)
     bool result;
     KVMMemoryListener *kml = &s->memory_listener;
 
-    kvm_slots_lock(kml);
+    kvm_slots_lock();
     result = !!kvm_get_free_slot(kml);
-    kvm_slots_unlock(kml);
+    kvm_slots_unlock();
 
     return result;
 }
 
-/* Called with KVMMemoryListener.slots_lock held */
+/* Called with kvm_slots_lock() held */
 static KVMSlot *kvm_alloc_slot(KVMMemoryListener *kml)
 {
     KVMSlot *slot = kvm_get_free_slot(kml);
@@ -329,7 +344,7 @@ int kvm_physical_memory_addr_from_host(KVMState *s, void *ram,
     KVMMemoryListener *kml = &s->memory_listener;
     int i, ret = 0;
 
-    kvm_slots_lock(kml);
+    kvm_slots_lock();
     for (i = 0; i < s->nr_slots; i++) {
         KVMSlot *mem = &kml->slots[i];
 
@@ -339,7 +354,7 @@ int kvm_physical_memory_addr_from_host(KVMState *s, void *ram,
             break;
         }
     }
-    kvm_slots_unlock(kml);
+    kvm_slots_unlock();
 
     return ret;
 }
@@ -405,15 +420,29 @@ int kvm_destroy_vcpu(CPUState *cpu)
         goto err;
     }
 
+    if (s->kvm_dirty_ring_size) {
+        struct kvm_dirty_gfn *dirty_gfns = cpu->kvm_dirty_gfns;
+
+        /* Don't lose what the vCPU dirtied last */
+        kvm_dirty_ring_reap(s);
+        cpu->kvm_dirty_gfns = NULL;
+        ret = munmap(dirty_gfns, s->kvm_dirty_ring_bytes);
+        if (ret < 0) {
+            goto err;
+        }
+    }
+
     vcpu = g_malloc0(sizeof(*vcpu));
     vcpu->vcpu_id = kvm_arch_vcpu_id(cpu);
     vcpu->kvm_fd = cpu->kvm_fd;
+    vcpu->kvm_fetch_index = cpu->kvm_fetch_index;
     QLIST_INSERT_HEAD(&kvm_state->kvm_parked_vcpus, vcpu, node);
 err:
     return ret;
 }
 
-static int kvm_get_vcpu(KVMState *s, unsigned long vcpu_id)
+static int kvm_get_vcpu(KVMState *s, unsigned long vcpu_id,
+                        uint32_t *fetch_index)
 {
     struct KVMParkedVcpu *cpu;
 
@@ -423,11 +452,13 @@ static int kvm_get_vcpu(KVMState *s, unsigned long vcpu_id)
 
             QLIST_REMOVE(cpu, node);
             kvm_fd = cpu->kvm_fd;
+            *fetch_index = cpu->kvm_fetch_index;
             g_free(cpu);
             return kvm_fd;
         }
     }
 
+    *fetch_index = 0;
     return kvm_vm_ioctl(s, KVM_CREATE_VCPU, (void *)vcpu_id);
 }
 
@@ -439,7 +470,7 @@ int kvm_init_vcpu(CPUState *cpu)
 
     DPRINTF("kvm_init_vcpu\n");
 
-    ret = kvm_get_vcpu(s, kvm_arch_vcpu_id(cpu));
+    ret = kvm_get_vcpu(s, kvm_arch_vcpu_id(cpu), &cpu->kvm_fetch_index);
     if (ret < 0) {
         DPRINTF("kvm_create_vcpu failed\n");
         goto err;
@@ -469,6 +500,20 @@ int kvm_init_vcpu(CPUState *cpu)
             (void *)cpu->kvm_run + s->coalesced_mmio * PAGE_SIZE;
     }
 
+    if (s->kvm_dirty_ring_size) {
+        /* Use MAP_SHARED to share pages with the kernel */
+        cpu->kvm_dirty_gfns = mmap(NULL, s->kvm_dirty_ring_bytes,
+                                   PROT_READ | PROT_WRITE, MAP_SHARED,
+                                   cpu->kvm_fd,
+                                   PAGE_SIZE * KVM_DIRTY_LOG_PAGE_OFFSET);
+        if (cpu->kvm_dirty_gfns == MAP_FAILED) {
+            cpu->kvm_dirty_gfns = NULL;
+            ret = -errno;
+            DPRINTF("mmap'ing vcpu dirty gfns failed: %d\n", ret);
+            goto err;
+        }
+    }
+
     ret = kvm_arch_init_vcpu(cpu);
 err:
     return ret;
@@ -478,6 +523,30 @@ err:
  * dirty pages logging control
  */
 
+#define ALIGN(x, y)  (((x)+(y)-1) & ~((y)-1))
+
+/* Allocate the dirty bitmap for a slot  */
+static void kvm_memslot_init_dirty_bitmap(KVMSlot *mem)
+{
+    /*
+     * XXX bad kernel interface alert
+     * For dirty bitmap, kernel allocates array of size aligned to
+     * bits-per-long.  But for case when the kernel is 64bits and
+     * the userspace is 32bits, userspace can't align to the same
+     * bits-per-long, since sizeof(long) is different between kernel
+     * and user space.  This way, userspace will provide buffer which
+     * may be 4 bytes less than the kernel will use, resulting in
+     * userspace memory corruption (which is not detectable by valgrind
+     * too, in most cases).
+     * So for now, let's align to 64 instead of HOST_LONG_BITS here, in
+     * a hope that sizeof(long) won't become >8 any time soon.
+     */
+    hwaddr bitmap_size = ALIGN(((mem->memory_size) >> TARGET_PAGE_BITS),
+                                        /*HOST_LONG_BITS*/ 64) / 8;
+    mem->dirty_bmap = g_malloc0(bitmap_size);
+    mem->dirty_bmap_size = bitmap_size;
+}
+
 static int kvm_mem_flags(MemoryRegion *mr)
 {
     bool readonly = mr->readonly || memory_region_is_romd(mr);
@@ -492,7 +561,7 @@ static int kvm_mem_flags(MemoryRegion *mr)
     return flags;
 }
 
-/* Called with KVMMemoryListener.slots_lock held */
+/* Called with kvm_slots_lock() held */
 static int kvm_slot_update_flags(KVMMemoryListener *kml, KVMSlot *mem,
                                  MemoryRegion *mr)
 {
@@ -518,7 +587,7 @@ static int kvm_section_update_flags(KVMMemoryListener *kml,
         return 0;
     }
 
-    kvm_slots_lock(kml);
+    kvm_slots_lock();
 
     while (size && !ret) {
         slot_size = MIN(kvm_max_slot_size, size);
@@ -534,7 +603,7 @@ static int kvm_section_update_flags(KVMMemoryListener *kml,
     }
 
 out:
-    kvm_slots_unlock(kml);
+    kvm_slots_unlock();
     return ret;
 }
 
@@ -584,36 +653,13 @@ static int kvm_get_dirty_pages_log_range(MemoryRegionSection *section,
     return 0;
 }
 
-#define ALIGN(x, y)  (((x)+(y)-1) & ~((y)-1))
-
-/* Allocate the dirty bitmap for a slot  */
-static void kvm_memslot_init_dirty_bitmap(KVMSlot *mem)
-{
-    /*
-     * XXX bad kernel interface alert
-     * For dirty bitmap, kernel allocates array of size aligned to
-     * bits-per-long.  But for case when the kernel is 64bits and
-     * the userspace is 32bits, userspace can't align to the same
-     * bits-per-long, since sizeof(long) is different between kernel
-     * and user space.  This way, userspace will provide buffer which
-     * may be 4 bytes less than the kernel will use, resulting in
-     * userspace memory corruption (which is not detectable by valgrind
-     * too, in most cases).
-     * So for now, let's align to 64 instead of HOST_LONG_BITS here, in
-     * a hope that sizeof(long) won't become >8 any time soon.
-     */
-    hwaddr bitmap_size = ALIGN(((mem->memory_size) >> TARGET_PAGE_BITS),
-                                        /*HOST_LONG_BITS*/ 64) / 8;
-    mem->dirty_bmap = g_malloc0(bitmap_size);
-}
-
 /**
  * kvm_physical_sync_dirty_bitmap - Sync dirty bitmap from kernel space
  *
  * This function will first try to fetch dirty bitmap from the kernel,
  * and then updates qemu's dirty bitmap.
  *
- * NOTE: caller must be with kml->slots_lock held.
+ * NOTE: caller must be with kvm_slots_lock() held.
  *
  * @kml: the KVM memory listener object
  * @section: the memory section to sync the dirty bitmap with
@@ -664,6 +710,189 @@ out:
     return ret;
 }
 
+/*
+ * dirty rings
+ *
+ * With KVM_CAP_DIRTY_LOG_RING each vCPU pushes the pages it dirties to
+ * a ring shared with QEMU, so collecting them costs as much as the
+ * number of dirty pages instead of the size of the guest memory.  The
+ * pages are collected into the KVMSlot dirty bitmaps by the reaper
+ * thread, when a ring is full, and when the dirty log is synced.
+ */
+
+static bool dirty_gfn_is_dirtied(struct kvm_dirty_gfn *gfn)
+{
+    return atomic_load_acquire(&gfn->flags) == KVM_DIRTY_GFN_F_DIRTY;
+}
+
+static void dirty_gfn_set_collected(struct kvm_dirty_gfn *gfn)
+{
+    atomic_store_release(&gfn->flags, KVM_DIRTY_GFN_F_RESET);
+}
+
+/* Called with kvm_slots_lock() held */
+static void kvm_dirty_ring_mark_page(KVMState *s, uint32_t as_id,
+                                     uint32_t slot_id, uint64_t offset)
+{
+    KVMMemoryListener *kml = NULL;
+    KVMSlot *mem;
+    uint8_t clients;
+    int i;
+
+    for (i = 0; i < s->nr_as; i++) {
+        if (s->as[i].ml && s->as[i].ml->as_id == as_id) {
+            kml = s->as[i].ml;
+            break;
+        }
+    }
+    if (!kml || slot_id >= s->nr_slots) {
+        return;
+    }
+
+    mem = &kml->slots[slot_id];
+    if (!(mem->flags & KVM_MEM_LOG_DIRTY_PAGES) ||
+        offset >= mem->memory_size / qemu_real_host_page_size) {
+        /* The slot went away since the page was dirtied */
+        return;
+    }
+
+    /*
+     * Set the page in the ram_list dirty bitmaps straight away, so that
+     * syncing only costs as much as the pages that were dirtied, and
+     * not a walk of the bitmap of every slot.  The clients are those
+     * of cpu_physical_memory_set_dirty_lebitmap().
+     */
+    clients = tcg_enabled() ? DIRTY_CLIENTS_ALL : DIRTY_CLIENTS_NOCODE;
+    if (!global_dirty_log) {
+        clients &= ~(1 << DIRTY_MEMORY_MIGRATION);
+    }
+    cpu_physical_memory_set_dirty_range(mem->ram_start_offset +
+                                        offset * qemu_real_host_page_size,
+                                        qemu_real_host_page_size, clients);
+}
+
+/* Called with kvm_slots_lock() held */
+static uint32_t kvm_dirty_ring_reap_one(KVMState *s, CPUState *cpu)
+{
+    struct kvm_dirty_gfn *dirty_gfns = cpu->kvm_dirty_gfns, *cur;
+    uint32_t ring_size = s->kvm_dirty_ring_size;
+    uint32_t count = 0, fetch = cpu->kvm_fetch_index;
+
+    if (!dirty_gfns) {
+        /* The vCPU is not created yet, or is being unplugged */
+        return 0;
+    }
+
+    while (true) {
+        cur = &dirty_gfns[fetch & (ring_size - 1)];
+        if (!dirty_gfn_is_dirtied(cur)) {
+            break;
+        }
+        kvm_dirty_ring_mark_page(s, cur->slot >> 16, cur->slot & 0xffff,
+                                 cur->offset);
+        dirty_gfn_set_collected(cur);
+        fetch++;
+        count++;
+    }
+    cpu->kvm_fetch_index = fetch;
+
+    return count;
+}
+
+/* Called with kvm_slots_lock() held */
+static uint64_t kvm_dirty_ring_reap_locked(KVMState *s)
+{
+    CPUState *cpu;
+    uint64_t total = 0;
+    int ret;
+
+    CPU_FOREACH(cpu) {
+        total += kvm_dirty_ring_reap_one(s, cpu);
+    }
+
+    if (total) {
+        /* Give the collected entries back to the vCPUs */
+        ret = kvm_vm_ioctl(s, KVM_RESET_DIRTY_RINGS);
+        assert(ret == total);
+    }
+    trace_kvm_dirty_ring_reap(total);
+
+    return total;
+}
+
+/*
+ * Collect the dirty pages of all the vCPUs into the dirty bitmaps.
+ *
+ * Called with the BQL held, which protects the list of vCPUs.
+ */
+static uint64_t kvm_dirty_ring_reap(KVMState *s)
+{
+    uint64_t total;
+
+    kvm_slots_lock();
+    total = kvm_dirty_ring_reap_locked(s);
+    kvm_slots_unlock();
+
+    return total;
+}
+
+static void do_kvm_cpu_synchronize_kick(CPUState *cpu, run_on_cpu_data arg)
+{
+    /* No need to do anything */
+}
+
+/*
+ * Kick all vCPUs out of KVM_RUN synchronously, so that the pages they
+ * dirtied are flushed from the hardware buffers (e.g. PML) to the rings.
+ */
+static void kvm_cpu_synchronize_kick_all(void)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        run_on_cpu(cpu, do_kvm_cpu_synchronize_kick, RUN_ON_CPU_NULL);
+    }
+}
+
+/*
+ * Flush all the dirty pages the vCPUs have to the dirty bitmaps.  This
+ * is called with the BQL held, so it is serialized against itself.
+ */
+static void kvm_dirty_ring_flush(void)
+{
+    assert(qemu_mutex_iothread_locked());
+
+    kvm_cpu_synchronize_kick_all();
+    kvm_dirty_ring_reap(kvm_state);
+}
+
+static QEMU_NORETURN void *kvm_dirty_ring_reaper_thread(void *opaque)
+{
+    KVMState *s = opaque;
+
+    rcu_register_thread();
+
+    /*
+     * Collect the dirty pages every second, so that the rings don't
+     * fill up and make the vCPUs exit to QEMU.  There is no KVM
+     * teardown to stop it, so the thread is detached and lives as long
+     * as QEMU does.
+     */
+    while (true) {
+        sleep(1);
+
+        qemu_mutex_lock_iothread();
+        kvm_dirty_ring_reap(s);
+        qemu_mutex_unlock_iothread();
+    }
+}
+
+static void kvm_dirty_ring_reaper_init(KVMState *s)
+{
+    qemu_thread_create(&s->dirty_ring_reaper, "kvm-reaper",
+                       kvm_dirty_ring_reaper_thread, s, QEMU_THREAD_DETACHED);
+}
+
 /* Alignment requirement for KVM_CLEAR_DIRTY_LOG - 64 pages */
 #define KVM_CLEAR_LOG_SHIFT  6
 #define KVM_CLEAR_LOG_ALIGN  (qemu_real_host_page_size << KVM_CLEAR_LOG_SHIFT)
@@ -805,7 +1034,7 @@ static int kvm_physical_log_clear(KVMMemoryListener *kml,
         return ret;
     }
 
-    kvm_slots_lock(kml);
+    kvm_slots_lock();
 
     for (i = 0; i < s->nr_slots; i++) {
         mem = &kml->slots[i];
@@ -831,7 +1060,7 @@ static int kvm_physical_log_clear(KVMMemoryListener *kml,
         }
     }
 
-    kvm_slots_unlock(kml);
+    kvm_slots_unlock();
 
     return ret;
 }
@@ -1115,6 +1344,7 @@ static void kvm_set_phys_mem(KVMMemoryListener *kml,
     MemoryRegion *mr = section->mr;
     bool writeable = !mr->readonly && !mr->rom_device;
     hwaddr start_addr, size, slot_size;
+    ram_addr_t ram_start_offset;
     void *ram;
 
     if (!memory_region_is_ram(mr)) {
@@ -1135,8 +1365,11 @@ static void kvm_set_phys_mem(KVMMemoryListener *kml,
     /* use aligned delta to align the ram address */
     ram = memory_region_get_ram_ptr(mr) + section->offset_within_region +
           (start_addr - section->offset_within_address_space);
+    ram_start_offset = memory_region_get_ram_addr(mr) +
+                       section->offset_within_region +
+                       (start_addr - section->offset_within_address_space);
 
-    kvm_slots_lock(kml);
+    kvm_slots_lock();
 
     if (!add) {
         do {
@@ -1146,7 +1379,11 @@ static void kvm_set_phys_mem(KVMMemoryListener *kml,
                 goto out;
             }
             if (mem->flags & KVM_MEM_LOG_DIRTY_PAGES) {
-                kvm_physical_sync_dirty_bitmap(kml, section);
+                if (kvm_state->kvm_dirty_ring_size) {
+                    kvm_dirty_ring_reap_locked(kvm_state);
+                } else {
+                    kvm_physical_sync_dirty_bitmap(kml, section);
+                }
             }
 
             /* unregister the slot */
@@ -1172,6 +1409,7 @@ static void kvm_set_phys_mem(KVMMemoryListener *kml,
         mem = kvm_alloc_slot(kml);
         mem->memory_size = slot_size;
         mem->start_addr = start_addr;
+        mem->ram_start_offset = ram_start_offset;
         mem->ram = ram;
         mem->flags = kvm_mem_flags(mr);
 
@@ -1189,12 +1427,13 @@ static void kvm_set_phys_mem(KVMMemoryListener *kml,
             abort();
         }
         start_addr += slot_size;
+        ram_start_offset += slot_size;
         ram += slot_size;
         size -= slot_size;
     } while (size);
 
 out:
-    kvm_slots_unlock(kml);
+    kvm_slots_unlock();
 }
 
 static void kvm_region_add(MemoryListener *listener,
@@ -1221,14 +1460,26 @@ static void kvm_log_sync(MemoryListener *listener,
     KVMMemoryListener *kml = container_of(listener, KVMMemoryListener, listener);
     int r;
 
-    kvm_slots_lock(kml);
+    kvm_slots_lock();
     r = kvm_physical_sync_dirty_bitmap(kml, section);
-    kvm_slots_unlock(kml);
+    kvm_slots_unlock();
     if (r < 0) {
         abort();
     }
 }
 
+/*
+ * Sync the dirty rings of all the vCPUs.  They don't tell which address
+ * space a page belongs to until they are reaped, so this does all the
+ * address spaces whatever section is asked for.  The reaped pages go
+ * straight to the ram_list dirty bitmaps, so there is nothing left to
+ * do per slot.
+ */
+static void kvm_log_sync_global(MemoryListener *listener)
+{
+    kvm_dirty_ring_flush();
+}
+
 static void kvm_log_clear(MemoryListener *listener,
                           MemoryRegionSection *section)
 {
@@ -1323,7 +1574,6 @@ void kvm_memory_listener_register(KVMState *s, KVMMemoryListener *kml,
 {
     int i;
 
-    qemu_mutex_init(&kml->slots_lock);
     kml->slots = g_malloc0(s->nr_slots * sizeof(KVMSlot));
     kml->as_id = as_id;
 
@@ -1335,8 +1585,12 @@ void kvm_memory_listener_register(KVMState *s, KVMMemoryListener *kml,
     kml->listener.region_del = kvm_region_del;
     kml->listener.log_start = kvm_log_start;
     kml->listener.log_stop = kvm_log_stop;
-    kml->listener.log_sync = kvm_log_sync;
-    kml->listener.log_clear = kvm_log_clear;
+    if (s->kvm_dirty_ring_size) {
+        kml->listener.log_sync_global = kvm_log_sync_global;
+    } else {
+        kml->listener.log_sync = kvm_log_sync;
+        kml->listener.log_clear = kvm_log_clear;
+    }
     kml->listener.priority = 10;
 
     memory_listener_register(&kml->listener, as);
@@ -1997,6 +2251,8 @@ static int kvm_init(MachineState *ms)
     const char *kvm_type;
     uint64_t dirty_log_manual_caps;
 
+    qemu_mutex_init(&kml_slots_lock);
+
     s = KVM_STATE(ms->accelerator);
 
     /*
@@ -2121,10 +2377,54 @@ static int kvm_init(MachineState *ms)
     s->coalesced_pio = s->coalesced_mmio &&
                        kvm_check_extension(s, KVM_CAP_COALESCED_PIO);
 
-    dirty_log_manual_caps =
-        kvm_check_extension(s, KVM_CAP_MANUAL_DIRTY_LOG_PROTECT2);
-    dirty_log_manual_caps &= (KVM_DIRTY_LOG_MANUAL_PROTECT_ENABLE |
-                              KVM_DIRTY_LOG_INITIALLY_SET);
+    /*
+     * Enable the dirty rings if asked for, otherwise fall back to the
+     * dirty bitmaps
+     */
+    if (s->kvm_dirty_ring_size) {
+        uint64_t ring_bytes;
+
+        ring_bytes = s->kvm_dirty_ring_size * sizeof(struct kvm_dirty_gfn);
+
+        /* Read the maximum supported size */
+        ret = kvm_vm_check_extension(s, KVM_CAP_DIRTY_LOG_RING);
+        if (ret > 0) {
+            if (ring_bytes > ret) {
+                error_report("KVM dirty ring size %" PRIu32 " too big "
+                             "(maximum is %ld).  Please use a smaller value.",
+                             s->kvm_dirty_ring_size,
+                             (long)ret / sizeof(struct kvm_dirty_gfn));
+                ret = -EINVAL;
+                goto err;
+            }
+
+            ret = kvm_vm_enable_cap(s, KVM_CAP_DIRTY_LOG_RING, 0, ring_bytes);
+            if (ret) {
+                error_report("Enabling of KVM dirty ring failed: %s. "
+                             "Suggested minimum value is 1024.",
+                             strerror(-ret));
+                goto err;
+            }
+
+            s->kvm_dirty_ring_bytes = ring_bytes;
+        } else {
+            warn_report("KVM dirty ring not available, using bitmap method");
+            s->kvm_dirty_ring_size = 0;
+        }
+    }
+
+    /*
+     * KVM_DIRTY_LOG_INITIALLY_SET assumes that no page is write
+     * protected at the start, but the dirty rings need all of them to
+     * be, so the two can't be used together.
+     */
+    dirty_log_manual_caps = 0;
+    if (!s->kvm_dirty_ring_size) {
+        dirty_log_manual_caps =
+            kvm_check_extension(s, KVM_CAP_MANUAL_DIRTY_LOG_PROTECT2);
+        dirty_log_manual_caps &= (KVM_DIRTY_LOG_MANUAL_PROTECT_ENABLE |
+                                  KVM_DIRTY_LOG_INITIALLY_SET);
+    }
     s->manual_dirty_log_protect = dirty_log_manual_caps;
     if (dirty_log_manual_caps) {
         ret = kvm_vm_enable_cap(s, KVM_CAP_MANUAL_DIRTY_LOG_PROTECT2, 0,
@@ -2232,6 +2532,10 @@ static int kvm_init(MachineState *ms)
         qemu_balloon_inhibit(true);
     }
 
+    if (s->kvm_dirty_ring_size) {
+        kvm_dirty_ring_reaper_init(s);
+    }
+
     return 0;
 
 err:
@@ -2539,6 +2843,17 @@ int kvm_cpu_exec(CPUState *cpu)
         case KVM_EXIT_INTERNAL_ERROR:
             ret = kvm_handle_internal_error(cpu, run);
             break;
+        case KVM_EXIT_DIRTY_RING_FULL:
+            /*
+             * The vCPU can't run again until its dirty ring has been
+             * collected and reset.
+             */
+            trace_kvm_dirty_ring_full(cpu->cpu_index);
+            qemu_mutex_lock_iothread();
+            kvm_dirty_ring_reap(kvm_state);
+            qemu_mutex_unlock_iothread();
+            ret = 0;
+            break;
         case KVM_EXIT_SYSTEM_EVENT:
             switch (run->system_event.type) {
             case KVM_SYSTEM_EVENT_SHUTDOWN:
@@ -3125,6 +3440,37 @@ static void kvm_set_kvm_shadow_mem(Object *obj, Visitor *v,
     s->kvm_shadow_mem = value;
 }
 
+static void kvm_get_dirty_ring_size(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    KVMState *s = KVM_STATE(obj);
+    uint32_t value = s->kvm_dirty_ring_size;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void kvm_set_dirty_ring_size(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    KVMState *s = KVM_STATE(obj);
+    Error *error = NULL;
+    uint32_t value;
+
+    visit_type_uint32(v, name, &value, &error);
+    if (error) {
+        error_propagate(errp, error);
+        return;
+    }
+    if (value & (value - 1)) {
+        error_setg(errp, "dirty-ring-size must be a power of two.");
+        return;
+    }
+
+    s->kvm_dirty_ring_size = value;
+}
+
 static void kvm_set_kernel_irqchip(Object *obj, Visitor *v,
                                    const char *name, void *opaque,
                                    Error **errp)
@@ -3206,6 +3552,12 @@ static void kvm_accel_class_init(ObjectClass *oc, void *data)
         NULL, NULL);
     object_class_property_set_description(oc, "kvm-shadow-mem",
         "KVM shadow MMU size");
+
+    object_class_property_add(oc, "dirty-ring-size", "uint32",
+        kvm_get_dirty_ring_size, kvm_set_dirty_ring_size,
+        NULL, NULL);
+    object_class_property_set_description(oc, "dirty-ring-size",
+        "Size of KVM dirty page ring buffer (default: 0, i.e. use bitmap)");
 }
 
 static const TypeInfo kvm_accel_type = {
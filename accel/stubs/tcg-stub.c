@@ -14,6 +14,8 @@
 #include "cpu.h"
 #include "tcg/tcg.h"
 #include "exec/exec-all.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-machine.h"
 
 void tb_flush(CPUState *cpu)
 {
@@ -22,3 +24,9 @@ void tb_flush(CPUState *cpu)
 void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
 {
 }
+
+TcgStats *qmp_query_tcg_stats(bool has_top, int64_t top, Error **errp)
+{
+    error_setg(errp, "TCG statistics are only available with accel=tcg");
+    return NULL;
+}
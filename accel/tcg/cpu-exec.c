@@ -401,6 +401,7 @@ static inline TranslationBlock *tb_find(CPUState *cpu,
     target_ulong cs_base, pc;
     uint32_t flags;
 
+    atomic_set(&cpu->tb_chain_breaks, cpu->tb_chain_breaks + 1);
     tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, cf_mask);
     if (tb == NULL) {
         mmap_lock();
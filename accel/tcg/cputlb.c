@@ -218,8 +218,10 @@ static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
     desc->large_page_addr = -1;
     desc->large_page_mask = -1;
     desc->vindex = 0;
+    desc->lindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
     memset(desc->vtable, -1, sizeof(desc->vtable));
+    memset(desc->ltable, 0, sizeof(desc->ltable));
 }
 
 static void tlb_flush_one_mmuidx_locked(CPUArchState *env, int mmu_idx,
@@ -227,8 +229,13 @@ static void tlb_flush_one_mmuidx_locked(CPUArchState *env, int mmu_idx,
 {
     CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
     CPUTLBDescFast *fast = &env_tlb(env)->f[mmu_idx];
+    size_t old_size = tlb_n_entries(fast);
 
     tlb_mmu_resize_locked(desc, fast, now);
+    if (tlb_n_entries(fast) != old_size) {
+        atomic_set(&env_tlb(env)->c.resize_count,
+                   env_tlb(env)->c.resize_count + 1);
+    }
     tlb_mmu_flush_locked(desc, fast);
 }
 
@@ -321,6 +328,21 @@ void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
     *pelide = elide;
 }
 
+void tlb_fill_counts(size_t *pfill, size_t *plarge_fill)
+{
+    CPUState *cpu;
+    size_t fill = 0, large_fill = 0;
+
+    CPU_FOREACH(cpu) {
+        CPUArchState *env = cpu->env_ptr;
+
+        fill += atomic_read(&env_tlb(env)->c.fill_count);
+        large_fill += atomic_read(&env_tlb(env)->c.large_fill_count);
+    }
+    *pfill = fill;
+    *plarge_fill = large_fill;
+}
+
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
 {
     CPUArchState *env = cpu->env_ptr;
@@ -816,7 +838,8 @@ static void tlb_add_large_page(CPUArchState *env, int mmu_idx,
 
 /* Add a new TLB entry. At most one entry for a given virtual address
  * is permitted. Only a single TARGET_PAGE_SIZE region is mapped, the
- * supplied size is only used by tlb_flush_page.
+ * supplied size is used by tlb_flush_page and, if the CPU class sets
+ * tlb_large_pages, to refill the other pages from the large page table.
  *
  * Called from TCG-generated code, which is under an RCU read-side
  * critical section.
@@ -838,6 +861,7 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
     target_ulong vaddr_page;
     int asidx = cpu_asidx_from_attrs(cpu, attrs);
     int wp_flags;
+    int large_prot = prot;
     bool is_ram, is_romd;
 
     assert_cpu_is_self(cpu);
@@ -928,6 +952,16 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
     /* Make sure there's no cached translation for the new page.  */
     tlb_flush_vtlb_page_locked(env, mmu_idx, vaddr_page);
 
+    if (size > TARGET_PAGE_SIZE && CPU_GET_CLASS(cpu)->tlb_large_pages) {
+        CPUTLBLargeEntry *le = &desc->ltable[desc->lindex++ % CPU_LTLB_SIZE];
+
+        le->mask = ~(size - 1);
+        le->vaddr = vaddr & le->mask;
+        le->paddr = paddr & (hwaddr)(target_long)le->mask;
+        le->attrs = attrs;
+        le->prot = large_prot;
+    }
+
     /*
      * Only evict the old entry to the victim tlb if it's for a
      * different page; otherwise just overwrite the stale data.
@@ -1014,22 +1048,67 @@ static inline ram_addr_t qemu_ram_addr_from_host_nofail(void *ptr)
     return ram_addr;
 }
 
+/*
+ * Refill the page of ADDR from a large page translation seen earlier,
+ * if there is one that allows ACCESS_TYPE.  Returns true on success.
+ */
+static bool tlb_fill_large(CPUState *cpu, target_ulong addr,
+                           MMUAccessType access_type, int mmu_idx)
+{
+    CPUArchState *env = cpu->env_ptr;
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+    int need = access_type == MMU_INST_FETCH ? PAGE_EXEC :
+               access_type == MMU_DATA_STORE ? PAGE_WRITE : PAGE_READ;
+    size_t i;
+
+    for (i = 0; i < CPU_LTLB_SIZE; i++) {
+        CPUTLBLargeEntry *le = &desc->ltable[i];
+
+        if ((le->prot & need) && (addr & le->mask) == le->vaddr) {
+            target_ulong page = addr & TARGET_PAGE_MASK;
+            hwaddr offset = page & ~(hwaddr)(target_long)le->mask;
+
+            tlb_set_page_with_attrs(cpu, page, le->paddr | offset,
+                                    le->attrs, le->prot, mmu_idx,
+                                    TARGET_PAGE_SIZE);
+            atomic_set(&env_tlb(env)->c.large_fill_count,
+                       env_tlb(env)->c.large_fill_count + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
 /*
  * Note: tlb_fill() can trigger a resize of the TLB. This means that all of the
  * caller's prior references to the TLB table (e.g. CPUTLBEntry pointers) must
  * be discarded and looked up again (e.g. via tlb_entry()).
  */
+static bool tlb_fill_probe(CPUState *cpu, target_ulong addr, int size,
+                           MMUAccessType access_type, int mmu_idx,
+                           bool probe, uintptr_t retaddr)
+{
+    CPUClass *cc = CPU_GET_CLASS(cpu);
+    CPUArchState *env = cpu->env_ptr;
+
+    if (cc->tlb_large_pages &&
+        tlb_fill_large(cpu, addr, access_type, mmu_idx)) {
+        return true;
+    }
+    atomic_set(&env_tlb(env)->c.fill_count, env_tlb(env)->c.fill_count + 1);
+    return cc->tlb_fill(cpu, addr, size, access_type, mmu_idx, probe, retaddr);
+}
+
 static void tlb_fill(CPUState *cpu, target_ulong addr, int size,
                      MMUAccessType access_type, int mmu_idx, uintptr_t retaddr)
 {
-    CPUClass *cc = CPU_GET_CLASS(cpu);
     bool ok;
 
     /*
      * This is not a probe, so only valid return is success; failure
      * should result in exception + longjmp to the cpu loop.
      */
-    ok = cc->tlb_fill(cpu, addr, size, access_type, mmu_idx, false, retaddr);
+    ok = tlb_fill_probe(cpu, addr, size, access_type, mmu_idx, false, retaddr);
     assert(ok);
 }
 
@@ -1153,6 +1232,8 @@ static bool victim_tlb_hit(CPUArchState *env, size_t mmu_idx, size_t index,
             CPUIOTLBEntry tmpio, *io = &env_tlb(env)->d[mmu_idx].iotlb[index];
             CPUIOTLBEntry *vio = &env_tlb(env)->d[mmu_idx].viotlb[vidx];
             tmpio = *io; *io = *vio; *vio = tmpio;
+            atomic_set(&env_tlb(env)->c.victim_hit_count,
+                       env_tlb(env)->c.victim_hit_count + 1);
             return true;
         }
     }
@@ -1276,10 +1357,9 @@ static int probe_access_internal(CPUArchState *env, target_ulong addr,
     if (!tlb_hit_page(tlb_addr, page_addr)) {
         if (!victim_tlb_hit(env, mmu_idx, index, elt_ofs, page_addr)) {
             CPUState *cs = env_cpu(env);
-            CPUClass *cc = CPU_GET_CLASS(cs);
 
-            if (!cc->tlb_fill(cs, addr, fault_size, access_type,
-                              mmu_idx, nonfault, retaddr)) {
+            if (!tlb_fill_probe(cs, addr, fault_size, access_type,
+                                mmu_idx, nonfault, retaddr)) {
                 /* Non-faulting page table read failed.  */
                 *phost = NULL;
                 return TLB_INVALID_MASK;
@@ -75,6 +75,7 @@ enum plugin_gen_from {
 enum plugin_gen_cb {
     PLUGIN_GEN_CB_UDATA,
     PLUGIN_GEN_CB_INLINE,
+    PLUGIN_GEN_CB_COND,
     PLUGIN_GEN_CB_MEM,
     PLUGIN_GEN_ENABLE_MEM_HELPER,
     PLUGIN_GEN_DISABLE_MEM_HELPER,
@@ -128,11 +129,25 @@ static void gen_empty_udata_cb(void)
 /*
  * For now we only support addi_i64.
  * When we support more ops, we can generate one empty inline cb for each.
+ *
+ * The target is ptr + cpu_index * stride.  For the common stride == 0
+ * case the ops computing the per-vCPU offset are simply not copied.
  */
 static void gen_empty_inline_cb(void)
 {
     TCGv_i64 val = tcg_temp_new_i64();
     TCGv_ptr ptr = tcg_const_ptr(NULL); /* overwritten later */
+    TCGv_i32 cpu_index = tcg_temp_new_i32();
+    TCGv_ptr cpu_offset = tcg_temp_new_ptr();
+
+    tcg_gen_ld_i32(cpu_index, cpu_env,
+                   -offsetof(ArchCPU, env) + offsetof(CPUState, cpu_index));
+    /* pass a stride that is not a power of 2 so that we get a mul_i32 */
+    tcg_gen_muli_i32(cpu_index, cpu_index, 0xdeadbeef);
+    tcg_gen_ext_i32_ptr(cpu_offset, cpu_index);
+    tcg_gen_add_ptr(ptr, ptr, cpu_offset);
+    tcg_temp_free_ptr(cpu_offset);
+    tcg_temp_free_i32(cpu_index);
 
     tcg_gen_ld_i64(val, ptr, 0);
     /* pass an immediate != 0 so that it doesn't get optimized away */
@@ -142,6 +157,43 @@ static void gen_empty_inline_cb(void)
     tcg_temp_free_i64(val);
 }
 
+/*
+ * Call the udata cb if the value at ptr + cpu_index * stride compares
+ * with an immediate.  Temps do not survive the branch, so cpu_index is
+ * loaded again for the call.
+ */
+static void gen_empty_cond_cb(void)
+{
+    TCGv_ptr ptr = tcg_const_ptr(NULL); /* overwritten later */
+    TCGv_i32 cpu_index = tcg_temp_new_i32();
+    TCGv_ptr cpu_offset = tcg_temp_new_ptr();
+    TCGv_i64 val = tcg_temp_new_i64();
+    TCGLabel *skip = gen_new_label(); /* replaced later */
+    TCGv_ptr udata;
+
+    tcg_gen_ld_i32(cpu_index, cpu_env,
+                   -offsetof(ArchCPU, env) + offsetof(CPUState, cpu_index));
+    /* pass a stride that is not a power of 2 so that we get a mul_i32 */
+    tcg_gen_muli_i32(cpu_index, cpu_index, 0xdeadbeef);
+    tcg_gen_ext_i32_ptr(cpu_offset, cpu_index);
+    tcg_gen_add_ptr(ptr, ptr, cpu_offset);
+    tcg_gen_ld_i64(val, ptr, 0);
+    /* the condition and the immediate are overwritten later */
+    tcg_gen_brcondi_i64(TCG_COND_NE, val, 0xdeadface, skip);
+
+    udata = tcg_const_ptr(NULL); /* overwritten later */
+    tcg_gen_ld_i32(cpu_index, cpu_env,
+                   -offsetof(ArchCPU, env) + offsetof(CPUState, cpu_index));
+    gen_helper_plugin_vcpu_udata_cb(cpu_index, udata);
+    gen_set_label(skip);
+
+    tcg_temp_free_ptr(udata);
+    tcg_temp_free_i64(val);
+    tcg_temp_free_ptr(cpu_offset);
+    tcg_temp_free_i32(cpu_index);
+    tcg_temp_free_ptr(ptr);
+}
+
 static void gen_empty_mem_cb(TCGv addr, uint32_t info)
 {
     do_gen_mem_cb(addr, info);
@@ -198,6 +250,7 @@ static inline void plugin_gen_empty_callback(enum plugin_gen_from from)
     case PLUGIN_GEN_FROM_TB:
         gen_wrapped(from, PLUGIN_GEN_CB_UDATA, gen_empty_udata_cb);
         gen_wrapped(from, PLUGIN_GEN_CB_INLINE, gen_empty_inline_cb);
+        gen_wrapped(from, PLUGIN_GEN_CB_COND, gen_empty_cond_cb);
         break;
     default:
         g_assert_not_reached();
@@ -336,6 +389,32 @@ static TCGOp *copy_const_ptr(TCGOp **begin_op, TCGOp *op, void *ptr)
     return op;
 }
 
+static void skip_op(TCGOp **begin_op, TCGOpcode opc)
+{
+    *begin_op = QTAILQ_NEXT(*begin_op, link);
+    tcg_debug_assert(*begin_op && (*begin_op)->opc == opc);
+}
+
+static TCGOp *copy_ext_i32_ptr(TCGOp **begin_op, TCGOp *op)
+{
+    if (UINTPTR_MAX == UINT32_MAX) {
+        op = copy_op(begin_op, op, INDEX_op_mov_i32);
+    } else {
+        op = copy_op(begin_op, op, INDEX_op_ext_i32_i64);
+    }
+    return op;
+}
+
+static TCGOp *copy_add_ptr(TCGOp **begin_op, TCGOp *op)
+{
+    if (UINTPTR_MAX == UINT32_MAX) {
+        op = copy_op(begin_op, op, INDEX_op_add_i32);
+    } else {
+        op = copy_op(begin_op, op, INDEX_op_add_i64);
+    }
+    return op;
+}
+
 static TCGOp *copy_const_i64(TCGOp **begin_op, TCGOp *op, uint64_t v)
 {
     return copy_movi_i64(begin_op, op, v);
@@ -457,6 +536,61 @@ static TCGOp *append_udata_cb(const struct qemu_plugin_dyn_cb *cb,
     return op;
 }
 
+/* add cpu_index * stride to the pointer, or skip those ops if stride is 0 */
+static TCGOp *copy_vcpu_offset(TCGOp **begin_op, TCGOp *op, size_t stride)
+{
+    if (stride) {
+        /* ld_i32 */
+        op = copy_op(begin_op, op, INDEX_op_ld_i32);
+
+        /* const_i32 */
+        op = copy_op(begin_op, op, INDEX_op_movi_i32);
+        op->args[1] = stride;
+
+        /* mul_i32 */
+        op = copy_op(begin_op, op, INDEX_op_mul_i32);
+
+        /* ext_i32_ptr */
+        op = copy_ext_i32_ptr(begin_op, op);
+
+        /* add_ptr */
+        op = copy_add_ptr(begin_op, op);
+    } else {
+        skip_op(begin_op, INDEX_op_ld_i32);
+        skip_op(begin_op, INDEX_op_movi_i32);
+        skip_op(begin_op, INDEX_op_mul_i32);
+        skip_op(begin_op, UINTPTR_MAX == UINT32_MAX ?
+                INDEX_op_mov_i32 : INDEX_op_ext_i32_i64);
+        skip_op(begin_op, UINTPTR_MAX == UINT32_MAX ?
+                INDEX_op_add_i32 : INDEX_op_add_i64);
+    }
+    return op;
+}
+
+static TCGOp *copy_brcond_i64(TCGOp **begin_op, TCGOp *op, TCGCond cond,
+                              TCGLabel *l)
+{
+    l->refs++;
+    if (TCG_TARGET_REG_BITS == 32) {
+        op = copy_op(begin_op, op, INDEX_op_brcond2_i32);
+        op->args[4] = cond;
+        op->args[5] = label_arg(l);
+    } else {
+        op = copy_op(begin_op, op, INDEX_op_brcond_i64);
+        op->args[2] = cond;
+        op->args[3] = label_arg(l);
+    }
+    return op;
+}
+
+static TCGOp *copy_set_label(TCGOp **begin_op, TCGOp *op, TCGLabel *l)
+{
+    l->present = 1;
+    op = copy_op(begin_op, op, INDEX_op_set_label);
+    op->args[0] = label_arg(l);
+    return op;
+}
+
 static TCGOp *append_inline_cb(const struct qemu_plugin_dyn_cb *cb,
                                TCGOp *begin_op, TCGOp *op,
                                int *unused)
@@ -464,6 +598,8 @@ static TCGOp *append_inline_cb(const struct qemu_plugin_dyn_cb *cb,
     /* const_ptr */
     op = copy_const_ptr(&begin_op, op, cb->userp);
 
+    op = copy_vcpu_offset(&begin_op, op, cb->inline_insn.stride);
+
     /* ld_i64 */
     op = copy_ld_i64(&begin_op, op);
 
@@ -479,6 +615,64 @@ static TCGOp *append_inline_cb(const struct qemu_plugin_dyn_cb *cb,
     return op;
 }
 
+static TCGCond plugin_cond_to_tcg(enum qemu_plugin_cond cond)
+{
+    switch (cond) {
+    case QEMU_PLUGIN_COND_EQ:
+        return TCG_COND_EQ;
+    case QEMU_PLUGIN_COND_NE:
+        return TCG_COND_NE;
+    case QEMU_PLUGIN_COND_LT:
+        return TCG_COND_LTU;
+    case QEMU_PLUGIN_COND_LE:
+        return TCG_COND_LEU;
+    case QEMU_PLUGIN_COND_GT:
+        return TCG_COND_GTU;
+    case QEMU_PLUGIN_COND_GE:
+        return TCG_COND_GEU;
+    default:
+        /* NEVER and ALWAYS are dealt with at registration */
+        g_assert_not_reached();
+    }
+}
+
+static TCGOp *append_cond_cb(const struct qemu_plugin_dyn_cb *cb,
+                             TCGOp *begin_op, TCGOp *op, int *cb_idx)
+{
+    TCGLabel *skip = gen_new_label();
+
+    /* const_ptr */
+    op = copy_const_ptr(&begin_op, op, cb->cond.ptr);
+
+    op = copy_vcpu_offset(&begin_op, op, cb->cond.stride);
+
+    /* ld_i64 */
+    op = copy_ld_i64(&begin_op, op);
+
+    /* const_i64 */
+    op = copy_const_i64(&begin_op, op, cb->cond.imm);
+
+    /* brcond_i64, skipping the call unless the condition holds */
+    op = copy_brcond_i64(&begin_op, op,
+                         tcg_invert_cond(plugin_cond_to_tcg(cb->cond.cond)),
+                         skip);
+
+    /* const_ptr */
+    op = copy_const_ptr(&begin_op, op, cb->userp);
+
+    /* ld_i32 */
+    op = copy_op(&begin_op, op, INDEX_op_ld_i32);
+
+    /* call */
+    op = copy_call(&begin_op, op, HELPER(plugin_vcpu_udata_cb),
+                   cb->f.vcpu_udata, cb->tcg_flags, cb_idx);
+
+    /* set_label */
+    op = copy_set_label(&begin_op, op, skip);
+
+    return op;
+}
+
 static TCGOp *append_mem_cb(const struct qemu_plugin_dyn_cb *cb,
                             TCGOp *begin_op, TCGOp *op, int *cb_idx)
 {
@@ -571,6 +765,12 @@ inject_inline_cb(const GArray *cbs, TCGOp *begin_op, op_ok_fn ok)
     inject_cb_type(cbs, begin_op, append_inline_cb, ok);
 }
 
+static void
+inject_cond_cb(const GArray *cbs, TCGOp *begin_op)
+{
+    inject_cb_type(cbs, begin_op, append_cond_cb, op_ok);
+}
+
 static void
 inject_mem_cb(const GArray *cbs, TCGOp *begin_op)
 {
@@ -678,6 +878,12 @@ static void plugin_gen_tb_inline(const struct qemu_plugin_tb *ptb,
     inject_inline_cb(ptb->cbs[PLUGIN_CB_INLINE], begin_op, op_ok);
 }
 
+static void plugin_gen_tb_cond(const struct qemu_plugin_tb *ptb,
+                               TCGOp *begin_op)
+{
+    inject_cond_cb(ptb->cbs[PLUGIN_CB_COND], begin_op);
+}
+
 static void plugin_gen_insn_udata(const struct qemu_plugin_tb *ptb,
                                   TCGOp *begin_op, int insn_idx)
 {
@@ -694,6 +900,14 @@ static void plugin_gen_insn_inline(const struct qemu_plugin_tb *ptb,
                      begin_op, op_ok);
 }
 
+static void plugin_gen_insn_cond(const struct qemu_plugin_tb *ptb,
+                                 TCGOp *begin_op, int insn_idx)
+{
+    struct qemu_plugin_insn *insn = g_ptr_array_index(ptb->insns, insn_idx);
+
+    inject_cond_cb(insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_COND], begin_op);
+}
+
 static void plugin_gen_mem_regular(const struct qemu_plugin_tb *ptb,
                                    TCGOp *begin_op, int insn_idx)
 {
@@ -740,6 +954,9 @@ static void plugin_inject_cb(const struct qemu_plugin_tb *ptb, TCGOp *begin_op,
         case PLUGIN_GEN_CB_INLINE:
             plugin_gen_tb_inline(ptb, begin_op);
             return;
+        case PLUGIN_GEN_CB_COND:
+            plugin_gen_tb_cond(ptb, begin_op);
+            return;
         default:
             g_assert_not_reached();
         }
@@ -751,6 +968,9 @@ static void plugin_inject_cb(const struct qemu_plugin_tb *ptb, TCGOp *begin_op,
         case PLUGIN_GEN_CB_INLINE:
             plugin_gen_insn_inline(ptb, begin_op, insn_idx);
             return;
+        case PLUGIN_GEN_CB_COND:
+            plugin_gen_insn_cond(ptb, begin_op, insn_idx);
+            return;
         case PLUGIN_GEN_ENABLE_MEM_HELPER:
             plugin_gen_enable_mem_helper(ptb, begin_op, insn_idx);
             return;
@@ -816,6 +1036,9 @@ static void pr_ops(void)
             case PLUGIN_GEN_CB_INLINE:
                 type = "inline";
                 break;
+            case PLUGIN_GEN_CB_COND:
+                type = "cond";
+                break;
             case PLUGIN_GEN_CB_MEM:
                 type = "mem";
                 break;
@@ -41,6 +41,7 @@ typedef struct TCGState {
 
     bool mttcg_enabled;
     unsigned long tb_size;
+    uint32_t tb_jmp_cache_bits;
 } TCGState;
 
 #define TYPE_TCG_ACCEL ACCEL_CLASS_NAME("tcg")
@@ -120,12 +121,14 @@ static void tcg_accel_instance_init(Object *obj)
     TCGState *s = TCG_STATE(obj);
 
     s->mttcg_enabled = default_mttcg_enabled();
+    s->tb_jmp_cache_bits = TB_JMP_CACHE_BITS_DEFAULT;
 }
 
 static int tcg_init(MachineState *ms)
 {
     TCGState *s = TCG_STATE(current_accel());
 
+    tb_jmp_cache_bits = s->tb_jmp_cache_bits;
     tcg_exec_init(s->tb_size * 1024 * 1024);
     cpu_interrupt_handler = tcg_handle_interrupt;
     mttcg_enabled = s->mttcg_enabled;
@@ -194,6 +197,38 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static void tcg_get_tb_jmp_cache_bits(Object *obj, Visitor *v,
+                                      const char *name, void *opaque,
+                                      Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->tb_jmp_cache_bits;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_tb_jmp_cache_bits(Object *obj, Visitor *v,
+                                      const char *name, void *opaque,
+                                      Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    Error *error = NULL;
+    uint32_t value;
+
+    visit_type_uint32(v, name, &value, &error);
+    if (error) {
+        error_propagate(errp, error);
+        return;
+    }
+    if (value < TB_JMP_CACHE_BITS_MIN || value > TB_JMP_CACHE_BITS_MAX) {
+        error_setg(errp, "tb-jmp-cache-bits must be between %d and %d",
+                   TB_JMP_CACHE_BITS_MIN, TB_JMP_CACHE_BITS_MAX);
+        return;
+    }
+
+    s->tb_jmp_cache_bits = value;
+}
+
 static void tcg_accel_class_init(ObjectClass *oc, void *data)
 {
     AccelClass *ac = ACCEL_CLASS(oc);
@@ -211,6 +246,12 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add(oc, "tb-jmp-cache-bits", "int",
+        tcg_get_tb_jmp_cache_bits, tcg_set_tb_jmp_cache_bits,
+        NULL, NULL);
+    object_class_property_set_description(oc, "tb-jmp-cache-bits",
+        "log2 of the number of entries in the per-vCPU TB jump cache");
+
 }
 
 static const TypeInfo tcg_accel_type = {
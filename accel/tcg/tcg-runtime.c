@@ -145,14 +145,10 @@ uint64_t HELPER(ctpop_i64)(uint64_t arg)
     return ctpop64(arg);
 }
 
-void *HELPER(lookup_tb_ptr)(CPUArchState *env)
+static void *lookup_tb_ptr_log(CPUState *cpu, TranslationBlock *tb,
+                               target_ulong pc, target_ulong cs_base,
+                               uint32_t flags)
 {
-    CPUState *cpu = env_cpu(env);
-    TranslationBlock *tb;
-    target_ulong cs_base, pc;
-    uint32_t flags;
-
-    tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, curr_cflags());
     if (tb == NULL) {
         return tcg_ctx->code_gen_epilogue;
     }
@@ -164,6 +160,45 @@ void *HELPER(lookup_tb_ptr)(CPUArchState *env)
     return tb->tc.ptr;
 }
 
+void *HELPER(lookup_tb_ptr)(CPUArchState *env)
+{
+    CPUState *cpu = env_cpu(env);
+    TranslationBlock *tb;
+    target_ulong cs_base, pc;
+    uint32_t flags;
+
+    tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, curr_cflags());
+    return lookup_tb_ptr_log(cpu, tb, pc, cs_base, flags);
+}
+
+void *HELPER(lookup_tb_ptr_site)(CPUArchState *env, uint32_t site)
+{
+    CPUState *cpu = env_cpu(env);
+    TranslationBlock *tb;
+    target_ulong cs_base, pc;
+    uint32_t flags;
+
+    tb = tb_lookup__cpu_state_site(cpu, &pc, &cs_base, &flags,
+                                   curr_cflags(), site, false);
+    return lookup_tb_ptr_log(cpu, tb, pc, cs_base, flags);
+}
+
+void *HELPER(lookup_tb_ptr_return)(CPUArchState *env)
+{
+    CPUState *cpu = env_cpu(env);
+    TranslationBlock *tb;
+    target_ulong cs_base, pc;
+    uint32_t flags, top, site;
+
+    top = cpu->tb_ras_top & (TB_RAS_SIZE - 1);
+    site = cpu->tb_ras[top];
+    cpu->tb_ras_top = (top - 1) & (TB_RAS_SIZE - 1);
+
+    tb = tb_lookup__cpu_state_site(cpu, &pc, &cs_base, &flags,
+                                   curr_cflags(), site, true);
+    return lookup_tb_ptr_log(cpu, tb, pc, cs_base, flags);
+}
+
 void HELPER(exit_atomic)(CPUArchState *env)
 {
     cpu_loop_exit_atomic(env_cpu(env), GETPC());
@@ -52,12 +52,16 @@
 #include "translate-all.h"
 #include "qemu/bitmap.h"
 #include "qemu/error-report.h"
+#include "qapi/error.h"
 #include "qemu/qemu-print.h"
 #include "qemu/timer.h"
 #include "qemu/main-loop.h"
 #include "exec/log.h"
 #include "sysemu/cpus.h"
 #include "sysemu/tcg.h"
+#ifndef CONFIG_USER_ONLY
+#include "qapi/qapi-commands-machine.h"
+#endif
 
 /* #define DEBUG_TB_INVALIDATE */
 /* #define DEBUG_TB_FLUSH */
@@ -929,6 +933,9 @@ static void page_lock_pair(PageDesc **ret_p1, tb_page_addr_t phys1,
 # define MAX_CODE_GEN_BUFFER_SIZE  (32 * MiB)
 #elif defined(__aarch64__)
 # define MAX_CODE_GEN_BUFFER_SIZE  (2 * GiB)
+#elif defined(__riscv)
+  /* AUIPC+JALR reaches [-2GB - 2KB, +2GB - 2KB) from the jump.  */
+# define MAX_CODE_GEN_BUFFER_SIZE  (2 * GiB - 2 * KiB)
 #elif defined(__s390x__)
   /* We have a +- 4GB range on the branches; leave some slop.  */
 # define MAX_CODE_GEN_BUFFER_SIZE  (3 * GiB)
@@ -1215,6 +1222,21 @@ static gboolean tb_host_size_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
+/* Remember where the TB lookup counters were when the code cache shrank */
+static void tb_flush_stats_mark(void)
+{
+    size_t lookups = 0, misses = 0;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        lookups += atomic_read(&cpu->tb_jmp_cache_lookups);
+        misses += atomic_read(&cpu->tb_htable_misses);
+    }
+    atomic_set(&tb_ctx.last_flush_lookups, lookups);
+    atomic_set(&tb_ctx.last_flush_misses, misses);
+    atomic_set(&tb_ctx.last_flush_time, get_clock());
+}
+
 /* flush all the translation blocks */
 static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 {
@@ -1248,6 +1270,7 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
     tcg_region_reset_all();
     /* XXX: flush processor icache at this point if cache flush is
        expensive */
+    tb_flush_stats_mark();
     atomic_mb_set(&tb_ctx.tb_flush_count, tb_ctx.tb_flush_count + 1);
 
 done:
@@ -1271,6 +1294,68 @@ void tb_flush(CPUState *cpu)
     }
 }
 
+static void tb_evict_invalidate(TranslationBlock *tb)
+{
+    /* TBs invalidated earlier stay in the region tree until a flush */
+    if (!(tb_cflags(tb) & CF_INVALID)) {
+        tb_phys_invalidate(tb, -1);
+    }
+}
+
+/*
+ * Free the oldest code regions, falling back to a full flush when that
+ * is not possible, e.g. in user-mode where there is a single region.
+ */
+static void do_tb_evict(CPUState *cpu, run_on_cpu_data tb_flush_count)
+{
+    size_t n;
+    bool done;
+
+    mmap_lock();
+    /* A flush requested by another CPU made room already */
+    if (tb_ctx.tb_flush_count != tb_flush_count.host_int) {
+        mmap_unlock();
+        return;
+    }
+
+    done = tcg_region_evict(tb_evict_invalidate, &n);
+    if (n) {
+        CPUState *other;
+
+        /* Unlike the jump cache, these may point to invalidated TBs */
+        CPU_FOREACH(other) {
+            memset(other->tb_ibtc, 0, sizeof(other->tb_ibtc));
+        }
+        tb_flush_stats_mark();
+        atomic_set(&tb_ctx.tb_evict_count, tb_ctx.tb_evict_count + 1);
+        atomic_set(&tb_ctx.tb_evicted_regions, tb_ctx.tb_evicted_regions + n);
+    }
+    if (!done) {
+        /* We are in a safe-work context, so do_tb_flush() will flush */
+        atomic_set(&tb_ctx.tb_flush_full_count,
+                   tb_ctx.tb_flush_full_count + 1);
+    }
+    mmap_unlock();
+
+    if (!done) {
+        do_tb_flush(cpu, tb_flush_count);
+    }
+}
+
+void tb_evict(CPUState *cpu)
+{
+    if (tcg_enabled()) {
+        unsigned tb_flush_count = atomic_mb_read(&tb_ctx.tb_flush_count);
+
+        if (cpu_in_exclusive_context(cpu)) {
+            do_tb_evict(cpu, RUN_ON_CPU_HOST_INT(tb_flush_count));
+        } else {
+            async_safe_run_on_cpu(cpu, do_tb_evict,
+                                  RUN_ON_CPU_HOST_INT(tb_flush_count));
+        }
+    }
+}
+
 /*
  * Formerly ifdef DEBUG_TB_CHECK. These debug functions are user-mode-only,
  * so in order to prevent bit rot we compile them unconditionally in user-mode,
@@ -1707,8 +1792,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
  buffer_overflow:
     tb = tcg_tb_alloc(tcg_ctx);
     if (unlikely(!tb)) {
-        /* flush must be done */
-        tb_flush(cpu);
+        /* make room by evicting old code, or flush everything */
+        tb_evict(cpu);
         mmap_unlock();
         /* Make the execution loop process the flush as soon as possible.  */
         cpu->exception_index = EXCP_INTERRUPT;
@@ -1723,8 +1808,10 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->cflags = cflags;
     tb->orig_tb = NULL;
     tb->trace_vcpu_dstate = *cpu->trace_dstate;
+    tb->lookup_samples = 0;
     tcg_ctx->tb_cflags = cflags;
  tb_overflow:
+    tcg_ctx->ibtc_site = tb_ibtc_hash_func(pc);
 
 #ifdef CONFIG_PROFILER
     /* includes aborted translations because of exceptions */
@@ -2272,12 +2359,33 @@ static void tb_jmp_cache_clear_page(CPUState *cpu, target_ulong page_addr)
     }
 }
 
+/*
+ * The indirect branch predictions are indexed by branch site, not by
+ * target, so look at every one and drop those whose tb starts in
+ * page_addr or in the page before it.
+ */
+static void tb_ibtc_clear_pages(CPUState *cpu, target_ulong page_addr)
+{
+    target_ulong prev_addr = page_addr - TARGET_PAGE_SIZE;
+    unsigned int i;
+
+    for (i = 0; i < TB_IBTC_SIZE; i++) {
+        TranslationBlock *tb = cpu->tb_ibtc[i];
+
+        if (tb && ((tb->pc & TARGET_PAGE_MASK) == page_addr ||
+                   (tb->pc & TARGET_PAGE_MASK) == prev_addr)) {
+            cpu->tb_ibtc[i] = NULL;
+        }
+    }
+}
+
 void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
 {
     /* Discard jump cache entries for any tb which might potentially
        overlap the flushed page.  */
     tb_jmp_cache_clear_page(cpu, addr - TARGET_PAGE_SIZE);
     tb_jmp_cache_clear_page(cpu, addr);
+    tb_ibtc_clear_pages(cpu, addr);
 }
 
 static void print_qht_statistics(struct qht_stats hst)
@@ -2355,6 +2463,10 @@ void dump_exec_info(void)
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
     size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t fill, large_fill;
+    size_t jc_lookups = 0, jc_misses = 0, ht_misses = 0;
+    size_t ibtc_lookups = 0, ibtc_misses = 0, ras_lookups = 0, ras_misses = 0;
+    CPUState *cpu;
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -2387,8 +2499,12 @@ void dump_exec_info(void)
     qht_statistics_destroy(&hst);
 
     qemu_printf("\nStatistics:\n");
-    qemu_printf("TB flush count      %u\n",
-                atomic_read(&tb_ctx.tb_flush_count));
+    qemu_printf("TB flush count      %u (%u with the code buffer full)\n",
+                atomic_read(&tb_ctx.tb_flush_count),
+                atomic_read(&tb_ctx.tb_flush_full_count));
+    qemu_printf("TB evict count      %u (%zu regions)\n",
+                atomic_read(&tb_ctx.tb_evict_count),
+                atomic_read(&tb_ctx.tb_evicted_regions));
     qemu_printf("TB invalidate count %zu\n",
                 tcg_tb_phys_invalidate_count());
 
@@ -2396,6 +2512,45 @@ void dump_exec_info(void)
     qemu_printf("TLB full flushes    %zu\n", flush_full);
     qemu_printf("TLB partial flushes %zu\n", flush_part);
     qemu_printf("TLB elided flushes  %zu\n", flush_elide);
+
+    tlb_fill_counts(&fill, &large_fill);
+    qemu_printf("TLB fills           %zu\n", fill);
+    qemu_printf("TLB large page hits %zu\n", large_fill);
+
+    CPU_FOREACH(cpu) {
+        jc_lookups += atomic_read(&cpu->tb_jmp_cache_lookups);
+        jc_misses += atomic_read(&cpu->tb_jmp_cache_misses);
+        ht_misses += atomic_read(&cpu->tb_htable_misses);
+        ibtc_lookups += atomic_read(&cpu->tb_ibtc_lookups);
+        ibtc_misses += atomic_read(&cpu->tb_ibtc_misses);
+        ras_lookups += atomic_read(&cpu->tb_ras_lookups);
+        ras_misses += atomic_read(&cpu->tb_ras_misses);
+    }
+    qemu_printf("TB jump cache size  %u entries per vCPU\n",
+                TB_JMP_CACHE_SIZE);
+    qemu_printf("TB lookups          %zu\n", jc_lookups);
+    qemu_printf("TB jump cache hits  %zu (%zu%%)\n", jc_lookups - jc_misses,
+                jc_lookups ? ((jc_lookups - jc_misses) * 100) / jc_lookups : 0);
+    qemu_printf("TB hash table hits  %zu\n", jc_misses - ht_misses);
+    qemu_printf("TB lookup misses    %zu\n", ht_misses);
+    qemu_printf("TB indirect jumps   %zu, %zu predicted (%zu%%)\n",
+                ibtc_lookups, ibtc_lookups - ibtc_misses,
+                ibtc_lookups ? ((ibtc_lookups - ibtc_misses) * 100) /
+                ibtc_lookups : 0);
+    qemu_printf("TB returns          %zu, %zu predicted (%zu%%)\n",
+                ras_lookups, ras_lookups - ras_misses,
+                ras_lookups ? ((ras_lookups - ras_misses) * 100) /
+                ras_lookups : 0);
+    if (atomic_read(&tb_ctx.tb_flush_count) ||
+        atomic_read(&tb_ctx.tb_evict_count)) {
+        size_t lookups = jc_lookups - atomic_read(&tb_ctx.last_flush_lookups);
+        size_t misses = ht_misses - atomic_read(&tb_ctx.last_flush_misses);
+        int64_t age = get_clock() - atomic_read(&tb_ctx.last_flush_time);
+
+        qemu_printf("Since last flush    %" PRId64 " ms, %zu lookups, "
+                    "%zu%% hits\n", age / SCALE_MS, lookups,
+                    lookups ? ((lookups - misses) * 100) / lookups : 0);
+    }
     tcg_dump_info();
 }
 
@@ -2404,6 +2559,110 @@ void dump_opcount_info(void)
     tcg_dump_op_count();
 }
 
+/* The @max most looked up TBs, sorted by decreasing lookup count */
+struct tb_hot_blocks {
+    TcgHotBlock *blocks;
+    size_t n;
+    size_t max;
+};
+
+static gboolean tb_hot_blocks_iter(gpointer key, gpointer value,
+                                   gpointer data)
+{
+    const TranslationBlock *tb = value;
+    struct tb_hot_blocks *hot = data;
+    size_t lookups = atomic_read(&tb->lookup_samples) * TB_LOOKUP_SAMPLE;
+    size_t i;
+
+    if (tb_cflags(tb) & CF_INVALID) {
+        return false;
+    }
+    if (hot->n == hot->max) {
+        if (hot->max == 0 || lookups <= hot->blocks[hot->n - 1].lookups) {
+            return false;
+        }
+        hot->n--;
+    }
+    for (i = hot->n; i > 0 && hot->blocks[i - 1].lookups < lookups; i--) {
+        hot->blocks[i] = hot->blocks[i - 1];
+    }
+    hot->blocks[i].pc = tb->pc;
+    hot->blocks[i].flags = tb->flags;
+    hot->blocks[i].size = tb->size;
+    hot->blocks[i].lookups = lookups;
+    hot->n++;
+    return false;
+}
+
+TcgStats *qmp_query_tcg_stats(bool has_top, int64_t top, Error **errp)
+{
+    struct tb_hot_blocks hot = {};
+    TcgVcpuStatsList **vcpu_tail;
+    TcgHotBlockList **hot_tail;
+    TcgStats *stats;
+    CPUState *cpu;
+    size_t i;
+
+    if (!tcg_enabled()) {
+        error_setg(errp, "TCG statistics are only available with accel=tcg");
+        return NULL;
+    }
+    if (!has_top) {
+        top = 10;
+    } else if (top < 0) {
+        error_setg(errp, "Parameter 'top' expects a non-negative value");
+        return NULL;
+    }
+
+    stats = g_new0(TcgStats, 1);
+    stats->tb_flushes = atomic_read(&tb_ctx.tb_flush_count);
+    stats->tb_flushes_full = atomic_read(&tb_ctx.tb_flush_full_count);
+    stats->tb_flushes_requested = stats->tb_flushes - stats->tb_flushes_full;
+    stats->tb_evictions = atomic_read(&tb_ctx.tb_evict_count);
+    stats->tb_invalidations = tcg_tb_phys_invalidate_count();
+
+    vcpu_tail = &stats->vcpus;
+    CPU_FOREACH(cpu) {
+        CPUTLBCommon *c = &env_tlb((CPUArchState *)cpu->env_ptr)->c;
+        TcgVcpuStats *v = g_new0(TcgVcpuStats, 1);
+
+        v->cpu_index = cpu->cpu_index;
+        v->tlb_fills = atomic_read(&c->fill_count);
+        v->tlb_large_page_hits = atomic_read(&c->large_fill_count);
+        v->tlb_victim_hits = atomic_read(&c->victim_hit_count);
+        v->tlb_full_flushes = atomic_read(&c->full_flush_count);
+        v->tlb_partial_flushes = atomic_read(&c->part_flush_count);
+        v->tlb_elided_flushes = atomic_read(&c->elide_flush_count);
+        v->tlb_resizes = atomic_read(&c->resize_count);
+        v->tb_lookups = atomic_read(&cpu->tb_jmp_cache_lookups);
+        v->tb_jmp_cache_misses = atomic_read(&cpu->tb_jmp_cache_misses);
+        v->tb_lookup_misses = atomic_read(&cpu->tb_htable_misses);
+        v->tb_chain_breaks = atomic_read(&cpu->tb_chain_breaks);
+        v->tb_indirect_lookups = atomic_read(&cpu->tb_ibtc_lookups);
+        v->tb_indirect_misses = atomic_read(&cpu->tb_ibtc_misses);
+        v->tb_return_lookups = atomic_read(&cpu->tb_ras_lookups);
+        v->tb_return_misses = atomic_read(&cpu->tb_ras_misses);
+
+        *vcpu_tail = g_new0(TcgVcpuStatsList, 1);
+        (*vcpu_tail)->value = v;
+        vcpu_tail = &(*vcpu_tail)->next;
+    }
+
+    hot.max = MIN(top, tcg_nb_tbs());
+    hot.blocks = g_new(TcgHotBlock, hot.max + 1);
+    tcg_tb_foreach(tb_hot_blocks_iter, &hot);
+
+    hot_tail = &stats->hot_blocks;
+    for (i = 0; i < hot.n; i++) {
+        *hot_tail = g_new0(TcgHotBlockList, 1);
+        (*hot_tail)->value = g_memdup(&hot.blocks[i], sizeof(TcgHotBlock));
+        hot_tail = &(*hot_tail)->next;
+    }
+    g_free(hot.blocks);
+
+    return stats;
+}
+
 #else /* CONFIG_USER_ONLY */
 
 void cpu_interrupt(CPUState *cpu, int mask)
@@ -334,6 +334,24 @@ int64_t cpu_get_clock(void)
     return ti;
 }
 
+/*
+ * Return the offset of cpu_get_clock() from get_clock() while the VM is
+ * running, so that devices can hand it to code that cannot afford the
+ * seqlock.  It only changes when the VM is started.
+ */
+int64_t cpu_get_clock_offset(void)
+{
+    int64_t offset;
+    unsigned start;
+
+    do {
+        start = seqlock_read_begin(&timers_state.vm_clock_seqlock);
+        offset = timers_state.cpu_clock_offset;
+    } while (seqlock_read_retry(&timers_state.vm_clock_seqlock, start));
+
+    return offset;
+}
+
 /* enable cpu_get_ticks()
  * Caller must hold BQL which serves as mutex for vm_clock_seqlock.
  */
@@ -1916,13 +1916,32 @@ float16 float64_to_float16(float64 a, bool ieee, float_status *s)
     return float16a_round_pack_canonical(pr, s, fmt16);
 }
 
-float32 float64_to_float32(float64 a, float_status *s)
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_float64_to_float32(float64 a, float_status *s)
 {
     FloatParts p = float64_unpack_canonical(a, s);
     FloatParts pr = float_to_float(p, &float32_params, s);
     return float32_round_pack_canonical(pr, s);
 }
 
+float32 float64_to_float32(float64 a, float_status *s)
+{
+    if (likely(float64_is_normal(a) && can_use_fpu(s))) {
+        union_float64 ud;
+        union_float32 uf;
+
+        ud.s = a;
+        uf.h = ud.h;
+        /* Leave overflow and underflow to softfloat */
+        if (likely(!f32_is_inf(uf) && fabsf(uf.h) > FLT_MIN)) {
+            return uf.s;
+        }
+    } else if (float64_is_zero(a)) {
+        return float32_set_sign(float32_zero, float64_is_neg(a));
+    }
+    return soft_float64_to_float32(a, s);
+}
+
 /*
  * Rounds the floating-point value `a' to an integer, and returns the
  * result as a floating-point value. The operation is performed
@@ -2557,11 +2576,23 @@ float32 int16_to_float32_scalbn(int16_t a, int scale, float_status *status)
 
 float32 int64_to_float32(int64_t a, float_status *status)
 {
+    if (likely(can_use_fpu(status))) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
     return int64_to_float32_scalbn(a, 0, status);
 }
 
 float32 int32_to_float32(int32_t a, float_status *status)
 {
+    if (likely(can_use_fpu(status))) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
     return int64_to_float32_scalbn(a, 0, status);
 }
 
@@ -2588,12 +2619,22 @@ float64 int16_to_float64_scalbn(int16_t a, int scale, float_status *status)
 
 float64 int64_to_float64(int64_t a, float_status *status)
 {
+    if (likely(can_use_fpu(status))) {
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
     return int64_to_float64_scalbn(a, 0, status);
 }
 
 float64 int32_to_float64(int32_t a, float_status *status)
 {
-    return int64_to_float64_scalbn(a, 0, status);
+    /* Exact, so the host conversion is always correct */
+    union_float64 ur;
+
+    ur.h = a;
+    return ur.s;
 }
 
 float64 int16_to_float64(int16_t a, float_status *status)
@@ -2682,11 +2723,23 @@ float32 uint16_to_float32_scalbn(uint16_t a, int scale, float_status *status)
 
 float32 uint64_to_float32(uint64_t a, float_status *status)
 {
+    if (likely(can_use_fpu(status))) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
     return uint64_to_float32_scalbn(a, 0, status);
 }
 
 float32 uint32_to_float32(uint32_t a, float_status *status)
 {
+    if (likely(can_use_fpu(status))) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
     return uint64_to_float32_scalbn(a, 0, status);
 }
 
@@ -2713,12 +2766,22 @@ float64 uint16_to_float64_scalbn(uint16_t a, int scale, float_status *status)
 
 float64 uint64_to_float64(uint64_t a, float_status *status)
 {
+    if (likely(can_use_fpu(status))) {
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
     return uint64_to_float64_scalbn(a, 0, status);
 }
 
 float64 uint32_to_float64(uint32_t a, float_status *status)
 {
-    return uint64_to_float64_scalbn(a, 0, status);
+    /* Exact, so the host conversion is always correct */
+    union_float64 ur;
+
+    ur.h = a;
+    return ur.s;
 }
 
 float64 uint16_to_float64(uint16_t a, float_status *status)
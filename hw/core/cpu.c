@@ -36,6 +36,8 @@
 
 CPUInterruptHandler cpu_interrupt_handler;
 
+unsigned int tb_jmp_cache_bits = TB_JMP_CACHE_BITS_DEFAULT;
+
 CPUState *cpu_by_arch_id(int64_t id)
 {
     CPUState *cpu;
@@ -373,6 +375,7 @@ static void cpu_common_initfn(Object *obj)
     QSIMPLEQ_INIT(&cpu->work_list);
     QTAILQ_INIT(&cpu->breakpoints);
     QTAILQ_INIT(&cpu->watchpoints);
+    cpu->tb_jmp_cache = g_new0(struct TranslationBlock *, TB_JMP_CACHE_SIZE);
 
     cpu_exec_initfn(cpu);
 }
@@ -381,6 +384,7 @@ static void cpu_common_finalize(Object *obj)
 {
     CPUState *cpu = CPU(obj);
 
+    g_free(cpu->tb_jmp_cache);
     qemu_mutex_destroy(&cpu->work_mutex);
 }
 
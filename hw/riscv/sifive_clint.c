@@ -28,11 +28,50 @@
 #include "hw/qdev-properties.h"
 #include "hw/riscv/sifive_clint.h"
 #include "qemu/timer.h"
+#include "sysemu/cpus.h"
+#include "sysemu/runstate.h"
+
+/*
+ * The timebase divides a second evenly, so the conversion from the
+ * virtual clock is a 64-bit division by a constant rather than a
+ * muldiv64, which matters since every rdtime and mtime read lands here.
+ */
+#define SIFIVE_CLINT_NS_PER_TICK \
+    (NANOSECONDS_PER_SECOND / SIFIVE_CLINT_TIMEBASE_FREQ)
 
 static uint64_t cpu_riscv_read_rtc(void)
 {
-    return muldiv64(qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL),
-        SIFIVE_CLINT_TIMEBASE_FREQ, NANOSECONDS_PER_SECOND);
+    QEMU_BUILD_BUG_ON(NANOSECONDS_PER_SECOND % SIFIVE_CLINT_TIMEBASE_FREQ);
+    return qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) / SIFIVE_CLINT_NS_PER_TICK;
+}
+
+/*
+ * Without icount the virtual clock is the host clock plus an offset that
+ * only changes while the VM is stopped.  Hand the offset to the harts on
+ * every start, so that rdtime computes the same value as
+ * cpu_riscv_read_rtc() without calling it.  With icount and record/replay
+ * the harts keep using cpu_riscv_read_rtc().
+ */
+static void sifive_clint_vm_state_change(void *opaque, int running,
+                                         RunState state)
+{
+    SiFiveCLINTState *s = opaque;
+    int64_t offset;
+    int i;
+
+    if (!running || use_icount) {
+        return;
+    }
+
+    offset = cpu_get_clock_offset();
+    for (i = 0; i < s->num_harts; i++) {
+        CPUState *cpu = qemu_get_cpu(i);
+        CPURISCVState *env = cpu ? cpu->env_ptr : NULL;
+
+        if (env) {
+            riscv_cpu_set_rdtime_scale(env, SIFIVE_CLINT_NS_PER_TICK, offset);
+        }
+    }
 }
 
 /*
@@ -254,5 +293,8 @@ DeviceState *sifive_clint_create(hwaddr addr, hwaddr size, uint32_t num_harts,
     qdev_prop_set_uint32(dev, "aperture-size", size);
     sysbus_realize_and_unref(SYS_BUS_DEVICE(dev), &error_fatal);
     sysbus_mmio_map(SYS_BUS_DEVICE(dev), 0, addr);
+    if (provide_rdtime) {
+        qemu_add_vm_change_state_handler(sifive_clint_vm_state_change, dev);
+    }
     return dev;
 }
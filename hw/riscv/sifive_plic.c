@@ -110,51 +110,103 @@ static void sifive_plic_set_claimed(SiFivePLICState *plic, int irq, bool level)
     atomic_set_masked(&plic->claimed[irq >> 5], 1 << (irq & 31), -!!level);
 }
 
-static int sifive_plic_irqs_pending(SiFivePLICState *plic, uint32_t addrid)
+static void sifive_plic_raise(SiFivePLICState *plic, uint32_t addrid)
 {
-    int i, j;
+    uint32_t hartid = plic->addr_config[addrid].hartid;
+    PLICMode mode = plic->addr_config[addrid].mode;
+    CPUState *cpu = qemu_get_cpu(hartid);
+    int level = plic->best_irq[addrid] != 0;
+
+    if (!cpu) {
+        return;
+    }
+
+    switch (mode) {
+    case PLICMode_M:
+        riscv_cpu_update_mip(RISCV_CPU(cpu), MIP_MEIP, BOOL_TO_MASK(level));
+        break;
+    case PLICMode_S:
+        riscv_cpu_update_mip(RISCV_CPU(cpu), MIP_SEIP, BOOL_TO_MASK(level));
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Record the new best source of a context and only touch the hart's
+ * external interrupt line if that changes whether one is deliverable.
+ * MEIP and SEIP are claimed by the PLIC, so nothing else changes them.
+ */
+static void sifive_plic_set_best(SiFivePLICState *plic, uint32_t addrid,
+                                 uint32_t best)
+{
+    bool was_raised = plic->best_irq[addrid] != 0;
+
+    plic->best_irq[addrid] = best;
+    if (was_raised != (best != 0)) {
+        sifive_plic_raise(plic, addrid);
+    }
+}
+
+/*
+ * Rescan the pending, enabled and unclaimed sources of one context for
+ * the highest priority one above its threshold, lowest id first on a
+ * tie.  Only the set bits of each word are visited.
+ */
+static void sifive_plic_update_context(SiFivePLICState *plic, uint32_t addrid)
+{
+    uint32_t best = 0, best_prio = plic->target_priority[addrid];
+    int i;
+
     for (i = 0; i < plic->bitfield_words; i++) {
         uint32_t pending_enabled_not_claimed =
             (plic->pending[i] & ~plic->claimed[i]) &
             plic->enable[addrid * plic->bitfield_words + i];
-        if (!pending_enabled_not_claimed) {
-            continue;
-        }
-        for (j = 0; j < 32; j++) {
-            int irq = (i << 5) + j;
-            uint32_t prio = plic->source_priority[irq];
-            int enabled = pending_enabled_not_claimed & (1 << j);
-            if (enabled && prio > plic->target_priority[addrid]) {
-                return 1;
+
+        while (pending_enabled_not_claimed) {
+            int irq = (i << 5) + ctz32(pending_enabled_not_claimed);
+
+            pending_enabled_not_claimed &= pending_enabled_not_claimed - 1;
+            if (irq < plic->num_sources &&
+                plic->source_priority[irq] > best_prio) {
+                best = irq;
+                best_prio = plic->source_priority[irq];
             }
         }
     }
-    return 0;
+
+    sifive_plic_set_best(plic, addrid, best);
 }
 
-static void sifive_plic_update(SiFivePLICState *plic)
+/*
+ * Update the contexts that enable IRQ after its pending or claimed state
+ * changed.  A context only needs a rescan if IRQ was its best source and
+ * no longer is deliverable; a newly deliverable IRQ is just compared
+ * against the cached best one.
+ */
+static void sifive_plic_update_source(SiFivePLICState *plic, int irq)
 {
+    uint32_t word = irq >> 5, bit = 1u << (irq & 31);
+    bool active = (plic->pending[word] & ~plic->claimed[word]) & bit;
+    uint32_t prio = irq < plic->num_sources ? plic->source_priority[irq] : 0;
     int addrid;
 
-    /* raise irq on harts where this irq is enabled */
     for (addrid = 0; addrid < plic->num_addrs; addrid++) {
-        uint32_t hartid = plic->addr_config[addrid].hartid;
-        PLICMode mode = plic->addr_config[addrid].mode;
-        CPUState *cpu = qemu_get_cpu(hartid);
-        CPURISCVState *env = cpu ? cpu->env_ptr : NULL;
-        if (!env) {
+        uint32_t best = plic->best_irq[addrid];
+        uint32_t best_prio = best ? plic->source_priority[best]
+                                  : plic->target_priority[addrid];
+
+        if (!(plic->enable[addrid * plic->bitfield_words + word] & bit)) {
             continue;
         }
-        int level = sifive_plic_irqs_pending(plic, addrid);
-        switch (mode) {
-        case PLICMode_M:
-            riscv_cpu_update_mip(RISCV_CPU(cpu), MIP_MEIP, BOOL_TO_MASK(level));
-            break;
-        case PLICMode_S:
-            riscv_cpu_update_mip(RISCV_CPU(cpu), MIP_SEIP, BOOL_TO_MASK(level));
-            break;
-        default:
-            break;
+        if (!active) {
+            if (best == irq) {
+                sifive_plic_update_context(plic, addrid);
+            }
+        } else if (prio > best_prio ||
+                   (best && prio == best_prio && irq < best)) {
+            sifive_plic_set_best(plic, addrid, irq);
         }
     }
 
@@ -163,28 +215,31 @@ static void sifive_plic_update(SiFivePLICState *plic)
     }
 }
 
-static uint32_t sifive_plic_claim(SiFivePLICState *plic, uint32_t addrid)
+/*
+ * Update the contexts that enable IRQ after its priority changed.
+ */
+static void sifive_plic_update_priority(SiFivePLICState *plic, int irq)
 {
-    int i, j;
-    for (i = 0; i < plic->bitfield_words; i++) {
-        uint32_t pending_enabled_not_claimed =
-            (plic->pending[i] & ~plic->claimed[i]) &
-            plic->enable[addrid * plic->bitfield_words + i];
-        if (!pending_enabled_not_claimed) {
-            continue;
-        }
-        for (j = 0; j < 32; j++) {
-            int irq = (i << 5) + j;
-            uint32_t prio = plic->source_priority[irq];
-            int enabled = pending_enabled_not_claimed & (1 << j);
-            if (enabled && prio > plic->target_priority[addrid]) {
-                sifive_plic_set_pending(plic, irq, false);
-                sifive_plic_set_claimed(plic, irq, true);
-                return irq;
-            }
+    uint32_t word = irq >> 5, bit = 1u << (irq & 31);
+    int addrid;
+
+    for (addrid = 0; addrid < plic->num_addrs; addrid++) {
+        if (plic->enable[addrid * plic->bitfield_words + word] & bit) {
+            sifive_plic_update_context(plic, addrid);
         }
     }
-    return 0;
+}
+
+static uint32_t sifive_plic_claim(SiFivePLICState *plic, uint32_t addrid)
+{
+    uint32_t irq = plic->best_irq[addrid];
+
+    if (irq) {
+        sifive_plic_set_pending(plic, irq, false);
+        sifive_plic_set_claimed(plic, irq, true);
+        sifive_plic_update_source(plic, irq);
+    }
+    return irq;
 }
 
 static uint64_t sifive_plic_read(void *opaque, hwaddr addr, unsigned size)
@@ -280,6 +335,9 @@ static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
             qemu_log("plic: write priority: irq=%d priority=%d\n",
                 irq, plic->source_priority[irq]);
         }
+        if (irq < plic->num_sources) {
+            sifive_plic_update_priority(plic, irq);
+        }
         return;
     } else if (addr >= plic->pending_base && /* 1 bit per source */
                addr < plic->pending_base + (plic->num_sources >> 3))
@@ -301,6 +359,7 @@ static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
                     mode_to_char(plic->addr_config[addrid].mode), wordid,
                     plic->enable[addrid * plic->bitfield_words + wordid]);
             }
+            sifive_plic_update_context(plic, addrid);
             return;
         }
     } else if (addr >= plic->context_base && /* 4 bytes per reg */
@@ -317,7 +376,7 @@ static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
             }
             if (value <= plic->num_priorities) {
                 plic->target_priority[addrid] = value;
-                sifive_plic_update(plic);
+                sifive_plic_update_context(plic, addrid);
             }
             return;
         } else if (contextid == 4) {
@@ -329,7 +388,7 @@ static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
             }
             if (value < plic->num_sources) {
                 sifive_plic_set_claimed(plic, value, false);
-                sifive_plic_update(plic);
+                sifive_plic_update_source(plic, value);
             }
             return;
         }
@@ -425,7 +484,7 @@ static void sifive_plic_irq_request(void *opaque, int irq, int level)
         qemu_log("sifive_plic_irq_request: irq=%d level=%d\n", irq, level);
     }
     sifive_plic_set_pending(plic, irq, level > 0);
-    sifive_plic_update(plic);
+    sifive_plic_update_source(plic, irq);
 }
 
 static void sifive_plic_realize(DeviceState *dev, Error **errp)
@@ -440,7 +499,8 @@ static void sifive_plic_realize(DeviceState *dev, Error **errp)
     parse_hart_config(plic);
     plic->bitfield_words = (plic->num_sources + 31) >> 5;
     plic->source_priority = g_new0(uint32_t, plic->num_sources);
-    plic->target_priority = g_new(uint32_t, plic->num_addrs);
+    plic->target_priority = g_new0(uint32_t, plic->num_addrs);
+    plic->best_irq = g_new0(uint32_t, plic->num_addrs);
     plic->pending = g_new0(uint32_t, plic->bitfield_words);
     plic->claimed = g_new0(uint32_t, plic->bitfield_words);
     plic->enable = g_new0(uint32_t, plic->bitfield_words * plic->num_addrs);
@@ -39,9 +39,11 @@
 #include "sysemu/arch_init.h"
 #include "sysemu/device_tree.h"
 #include "sysemu/sysemu.h"
+#include "sysemu/kvm.h"
 #include "exec/address-spaces.h"
 #include "hw/pci/pci.h"
 #include "hw/pci-host/gpex.h"
+#include "target/riscv/kvm_riscv.h"
 
 #include <libfdt.h>
 
@@ -182,7 +184,7 @@ static void create_fdt(RISCVVirtState *s, const struct MemmapEntry *memmap,
     uint64_t mem_size, const char *cmdline)
 {
     void *fdt;
-    int cpu, i;
+    int cpu, i, plic_cells;
     uint32_t *cells;
     char *nodename;
     uint32_t plic_phandle, test_phandle, phandle = 1;
@@ -217,6 +219,8 @@ static void create_fdt(RISCVVirtState *s, const struct MemmapEntry *memmap,
 
     qemu_fdt_add_subnode(fdt, "/cpus");
     qemu_fdt_setprop_cell(fdt, "/cpus", "timebase-frequency",
+                          kvm_enabled() ?
+                          kvm_riscv_get_timebase_frequency(&s->soc.harts[0]) :
                           SIFIVE_CLINT_TIMEBASE_FREQ);
     qemu_fdt_setprop_cell(fdt, "/cpus", "#size-cells", 0x0);
     qemu_fdt_setprop_cell(fdt, "/cpus", "#address-cells", 0x1);
@@ -264,39 +268,47 @@ static void create_fdt(RISCVVirtState *s, const struct MemmapEntry *memmap,
         g_free(cpu_nodename);
     }
 
-    cells =  g_new0(uint32_t, s->soc.num_harts * 4);
-    for (cpu = 0; cpu < s->soc.num_harts; cpu++) {
-        nodename =
-            g_strdup_printf("/cpus/cpu@%d/interrupt-controller", cpu);
-        uint32_t intc_phandle = qemu_fdt_get_phandle(fdt, nodename);
-        cells[cpu * 4 + 0] = cpu_to_be32(intc_phandle);
-        cells[cpu * 4 + 1] = cpu_to_be32(IRQ_M_SOFT);
-        cells[cpu * 4 + 2] = cpu_to_be32(intc_phandle);
-        cells[cpu * 4 + 3] = cpu_to_be32(IRQ_M_TIMER);
+    /* Under KVM the kernel provides the timer and IPIs through the SBI */
+    if (!kvm_enabled()) {
+        cells =  g_new0(uint32_t, s->soc.num_harts * 4);
+        for (cpu = 0; cpu < s->soc.num_harts; cpu++) {
+            nodename =
+                g_strdup_printf("/cpus/cpu@%d/interrupt-controller", cpu);
+            uint32_t intc_phandle = qemu_fdt_get_phandle(fdt, nodename);
+            cells[cpu * 4 + 0] = cpu_to_be32(intc_phandle);
+            cells[cpu * 4 + 1] = cpu_to_be32(IRQ_M_SOFT);
+            cells[cpu * 4 + 2] = cpu_to_be32(intc_phandle);
+            cells[cpu * 4 + 3] = cpu_to_be32(IRQ_M_TIMER);
+            g_free(nodename);
+        }
+        nodename = g_strdup_printf("/soc/clint@%lx",
+            (long)memmap[VIRT_CLINT].base);
+        qemu_fdt_add_subnode(fdt, nodename);
+        qemu_fdt_setprop_string(fdt, nodename, "compatible", "riscv,clint0");
+        qemu_fdt_setprop_cells(fdt, nodename, "reg",
+            0x0, memmap[VIRT_CLINT].base,
+            0x0, memmap[VIRT_CLINT].size);
+        qemu_fdt_setprop(fdt, nodename, "interrupts-extended",
+            cells, s->soc.num_harts * sizeof(uint32_t) * 4);
+        g_free(cells);
         g_free(nodename);
     }
-    nodename = g_strdup_printf("/soc/clint@%lx",
-        (long)memmap[VIRT_CLINT].base);
-    qemu_fdt_add_subnode(fdt, nodename);
-    qemu_fdt_setprop_string(fdt, nodename, "compatible", "riscv,clint0");
-    qemu_fdt_setprop_cells(fdt, nodename, "reg",
-        0x0, memmap[VIRT_CLINT].base,
-        0x0, memmap[VIRT_CLINT].size);
-    qemu_fdt_setprop(fdt, nodename, "interrupts-extended",
-        cells, s->soc.num_harts * sizeof(uint32_t) * 4);
-    g_free(cells);
-    g_free(nodename);
 
+    /* A KVM guest has no M-mode, so the PLIC only has S-mode contexts */
     plic_phandle = phandle++;
-    cells =  g_new0(uint32_t, s->soc.num_harts * 4);
+    plic_cells = kvm_enabled() ? 2 : 4;
+    cells =  g_new0(uint32_t, s->soc.num_harts * plic_cells);
     for (cpu = 0; cpu < s->soc.num_harts; cpu++) {
         nodename =
             g_strdup_printf("/cpus/cpu@%d/interrupt-controller", cpu);
         uint32_t intc_phandle = qemu_fdt_get_phandle(fdt, nodename);
-        cells[cpu * 4 + 0] = cpu_to_be32(intc_phandle);
-        cells[cpu * 4 + 1] = cpu_to_be32(IRQ_M_EXT);
-        cells[cpu * 4 + 2] = cpu_to_be32(intc_phandle);
-        cells[cpu * 4 + 3] = cpu_to_be32(IRQ_S_EXT);
+        i = cpu * plic_cells;
+        if (!kvm_enabled()) {
+            cells[i++] = cpu_to_be32(intc_phandle);
+            cells[i++] = cpu_to_be32(IRQ_M_EXT);
+        }
+        cells[i++] = cpu_to_be32(intc_phandle);
+        cells[i++] = cpu_to_be32(IRQ_S_EXT);
         g_free(nodename);
     }
     nodename = g_strdup_printf("/soc/interrupt-controller@%lx",
@@ -309,7 +321,7 @@ static void create_fdt(RISCVVirtState *s, const struct MemmapEntry *memmap,
     qemu_fdt_setprop_string(fdt, nodename, "compatible", "riscv,plic0");
     qemu_fdt_setprop(fdt, nodename, "interrupt-controller", NULL, 0);
     qemu_fdt_setprop(fdt, nodename, "interrupts-extended",
-        cells, s->soc.num_harts * sizeof(uint32_t) * 4);
+        cells, s->soc.num_harts * sizeof(uint32_t) * plic_cells);
     qemu_fdt_setprop_cells(fdt, nodename, "reg",
         0x0, memmap[VIRT_PLIC].base,
         0x0, memmap[VIRT_PLIC].size);
@@ -478,9 +490,11 @@ static void virt_machine_init(MachineState *machine)
     MemoryRegion *system_memory = get_system_memory();
     MemoryRegion *main_mem = g_new(MemoryRegion, 1);
     MemoryRegion *mask_rom = g_new(MemoryRegion, 1);
+    const char *hart_config;
     char *plic_hart_config;
     size_t plic_hart_config_len;
     target_ulong start_addr = memmap[VIRT_DRAM].base;
+    uint64_t kernel_entry = 0;
     int i;
     unsigned int smp_cpus = machine->smp.cpus;
 
@@ -508,12 +522,19 @@ static void virt_machine_init(MachineState *machine)
     memory_region_add_subregion(system_memory, memmap[VIRT_MROM].base,
                                 mask_rom);
 
-    riscv_find_and_load_firmware(machine, BIOS_FILENAME,
-                                 memmap[VIRT_DRAM].base, NULL);
+    /* A KVM guest starts directly in the kernel, in S-mode */
+    if (kvm_enabled()) {
+        if (!machine->kernel_filename) {
+            error_report("KVM requires a kernel, use -kernel");
+            exit(1);
+        }
+    } else {
+        riscv_find_and_load_firmware(machine, BIOS_FILENAME,
+                                     memmap[VIRT_DRAM].base, NULL);
+    }
 
     if (machine->kernel_filename) {
-        uint64_t kernel_entry = riscv_load_kernel(machine->kernel_filename,
-                                                  NULL);
+        kernel_entry = riscv_load_kernel(machine->kernel_filename, NULL);
 
         if (machine->initrd_filename) {
             hwaddr start;
@@ -570,15 +591,24 @@ static void virt_machine_init(MachineState *machine)
                           memmap[VIRT_MROM].base + sizeof(reset_vec),
                           &address_space_memory);
 
+    /* Without firmware, KVM harts are pointed at the kernel on reset */
+    for (i = 0; kvm_enabled() && i < smp_cpus; i++) {
+        s->soc.harts[i].env.kernel_addr = kernel_entry;
+        s->soc.harts[i].env.fdt_addr = memmap[VIRT_MROM].base +
+                                       sizeof(reset_vec);
+    }
+
     /* create PLIC hart topology configuration string */
-    plic_hart_config_len = (strlen(VIRT_PLIC_HART_CONFIG) + 1) * smp_cpus;
+    hart_config = kvm_enabled() ? VIRT_PLIC_KVM_HART_CONFIG :
+                                  VIRT_PLIC_HART_CONFIG;
+    plic_hart_config_len = (strlen(hart_config) + 1) * smp_cpus;
     plic_hart_config = g_malloc0(plic_hart_config_len);
     for (i = 0; i < smp_cpus; i++) {
         if (i != 0) {
             strncat(plic_hart_config, ",", plic_hart_config_len);
         }
-        strncat(plic_hart_config, VIRT_PLIC_HART_CONFIG, plic_hart_config_len);
-        plic_hart_config_len -= (strlen(VIRT_PLIC_HART_CONFIG) + 1);
+        strncat(plic_hart_config, hart_config, plic_hart_config_len);
+        plic_hart_config_len -= (strlen(hart_config) + 1);
     }
 
     /* MMIO */
@@ -593,9 +623,11 @@ static void virt_machine_init(MachineState *machine)
         VIRT_PLIC_CONTEXT_BASE,
         VIRT_PLIC_CONTEXT_STRIDE,
         memmap[VIRT_PLIC].size);
-    sifive_clint_create(memmap[VIRT_CLINT].base,
-        memmap[VIRT_CLINT].size, smp_cpus,
-        SIFIVE_SIP_BASE, SIFIVE_TIMECMP_BASE, SIFIVE_TIME_BASE, true);
+    if (!kvm_enabled()) {
+        sifive_clint_create(memmap[VIRT_CLINT].base,
+            memmap[VIRT_CLINT].size, smp_cpus,
+            SIFIVE_SIP_BASE, SIFIVE_TIMECMP_BASE, SIFIVE_TIME_BASE, true);
+    }
     sifive_test_create(memmap[VIRT_TEST].base);
 
     for (i = 0; i < VIRTIO_COUNT; i++) {
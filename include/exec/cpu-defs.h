@@ -81,6 +81,8 @@ typedef uint64_t target_ulong;
 
 /* use a fully associative victim tlb of 8 entries */
 #define CPU_VTLB_SIZE 8
+/* and a fully associative tlb of 8 large page translations behind it */
+#define CPU_LTLB_SIZE 8
 
 #if HOST_LONG_BITS == 32 && TARGET_LONG_BITS == 32
 #define CPU_TLB_ENTRY_BITS 4
@@ -153,6 +155,20 @@ typedef struct CPUIOTLBEntry {
     MemTxAttrs attrs;
 } CPUIOTLBEntry;
 
+/*
+ * A translation for a whole naturally aligned large page, as passed to
+ * tlb_set_page_with_attrs().  A miss in the victim tlb on any page it
+ * covers is refilled from here instead of walking the guest page tables.
+ * The entry is empty if @prot is 0, which matches no access.
+ */
+typedef struct CPUTLBLargeEntry {
+    target_ulong vaddr;
+    target_ulong mask;
+    hwaddr paddr;
+    MemTxAttrs attrs;
+    int prot;
+} CPUTLBLargeEntry;
+
 /*
  * Data elements that are per MMU mode, minus the bits accessed by
  * the TCG fast path.
@@ -176,6 +192,10 @@ typedef struct CPUTLBDesc {
     /* The tlb victim table, in two parts.  */
     CPUTLBEntry vtable[CPU_VTLB_SIZE];
     CPUIOTLBEntry viotlb[CPU_VTLB_SIZE];
+    /* The next index to use in the large page table.  */
+    size_t lindex;
+    /* The large page table, only used if CPUClass::tlb_large_pages.  */
+    CPUTLBLargeEntry ltable[CPU_LTLB_SIZE];
     /* The iotlb.  */
     CPUIOTLBEntry *iotlb;
 } CPUTLBDesc;
@@ -211,6 +231,10 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t fill_count;
+    size_t large_fill_count;
+    size_t victim_hit_count;
+    size_t resize_count;
 } CPUTLBCommon;
 
 /*
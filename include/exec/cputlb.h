@@ -27,5 +27,6 @@
 void tlb_protect_code(ram_addr_t ram_addr);
 void tlb_unprotect_code(ram_addr_t ram_addr);
 void tlb_flush_counts(size_t *full, size_t *part, size_t *elide);
+void tlb_fill_counts(size_t *fill, size_t *large_fill);
 #endif
 #endif
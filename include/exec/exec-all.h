@@ -483,8 +483,17 @@ struct TranslationBlock {
     uintptr_t jmp_list_head;
     uintptr_t jmp_list_next[2];
     uintptr_t jmp_dest[2];
+
+    /*
+     * Sampled number of times the TB was looked up for execution, for
+     * statistics.  Only one in TB_LOOKUP_SAMPLE lookups of each vCPU is
+     * counted, so that the shared TB is not written on every lookup.
+     */
+    size_t lookup_samples;
 };
 
+#define TB_LOOKUP_SAMPLE 64
+
 extern bool parallel_cpus;
 
 /* Hide the atomic_read to make code a little easier on the eyes */
@@ -508,6 +517,7 @@ void tb_invalidate_phys_range(target_ulong start, target_ulong end);
 void tb_invalidate_phys_addr(AddressSpace *as, hwaddr addr, MemTxAttrs attrs);
 #endif
 void tb_flush(CPUState *cpu);
+void tb_evict(CPUState *cpu);
 void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
                                    target_ulong cs_base, uint32_t flags,
@@ -35,6 +35,14 @@ struct TBContext {
 
     /* statistics */
     unsigned tb_flush_count;
+    /* flushes because code_gen_buffer was full and eviction failed */
+    unsigned tb_flush_full_count;
+    unsigned tb_evict_count;
+    size_t tb_evicted_regions;
+    /* TB lookup counters and time at the last flush or eviction */
+    size_t last_flush_lookups;
+    size_t last_flush_misses;
+    int64_t last_flush_time;
 };
 
 extern TBContext tb_ctx;
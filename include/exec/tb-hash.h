@@ -59,6 +59,12 @@ static inline unsigned int tb_jmp_cache_hash_func(target_ulong pc)
 
 #endif /* CONFIG_SOFTMMU */
 
+/* The first indirect branch site of the TB at @pc, see TCGContext.ibtc_site */
+static inline uint32_t tb_ibtc_hash_func(target_ulong pc)
+{
+    return qemu_xxhash2(pc) & (TB_IBTC_SIZE - 1);
+}
+
 static inline
 uint32_t tb_hash_func(tb_page_addr_t phys_pc, target_ulong pc, uint32_t flags,
                       uint32_t cf_mask, uint32_t trace_vcpu_dstate)
@@ -16,35 +16,99 @@
 #include "exec/exec-all.h"
 #include "exec/tb-hash.h"
 
+/* Count every TB_LOOKUP_SAMPLE'th lookup, as numbered by @count */
+static inline void tb_lookup_sample(TranslationBlock *tb, size_t count)
+{
+    if (unlikely(!(count & (TB_LOOKUP_SAMPLE - 1)))) {
+        atomic_set(&tb->lookup_samples, tb->lookup_samples + 1);
+    }
+}
+
+static inline bool tb_lookup_match(CPUState *cpu, TranslationBlock *tb,
+                                   target_ulong pc, target_ulong cs_base,
+                                   uint32_t flags, uint32_t cf_mask)
+{
+    return tb &&
+           tb->pc == pc &&
+           tb->cs_base == cs_base &&
+           tb->flags == flags &&
+           tb->trace_vcpu_dstate == *cpu->trace_dstate &&
+           (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask;
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
+static inline TranslationBlock *
+tb_lookup__cpu_state_pc(CPUState *cpu, target_ulong pc, target_ulong cs_base,
+                        uint32_t flags, uint32_t cf_mask)
+{
+    TranslationBlock *tb;
+    uint32_t hash;
+
+    hash = tb_jmp_cache_hash_func(pc);
+    tb = atomic_rcu_read(&cpu->tb_jmp_cache[hash]);
+    atomic_set(&cpu->tb_jmp_cache_lookups, cpu->tb_jmp_cache_lookups + 1);
+
+    if (likely(tb_lookup_match(cpu, tb, pc, cs_base, flags, cf_mask))) {
+        tb_lookup_sample(tb, cpu->tb_jmp_cache_lookups);
+        return tb;
+    }
+    atomic_set(&cpu->tb_jmp_cache_misses, cpu->tb_jmp_cache_misses + 1);
+    tb = tb_htable_lookup(cpu, pc, cs_base, flags, cf_mask);
+    if (tb == NULL) {
+        atomic_set(&cpu->tb_htable_misses, cpu->tb_htable_misses + 1);
+        return NULL;
+    }
+    atomic_set(&cpu->tb_jmp_cache[hash], tb);
+    tb_lookup_sample(tb, cpu->tb_jmp_cache_lookups);
+    return tb;
+}
+
 static inline TranslationBlock *
 tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
                      uint32_t *flags, uint32_t cf_mask)
 {
     CPUArchState *env = (CPUArchState *)cpu->env_ptr;
-    TranslationBlock *tb;
-    uint32_t hash;
 
     cpu_get_tb_cpu_state(env, pc, cs_base, flags);
-    hash = tb_jmp_cache_hash_func(*pc);
-    tb = atomic_rcu_read(&cpu->tb_jmp_cache[hash]);
+    cf_mask &= ~CF_CLUSTER_MASK;
+    cf_mask |= cpu->cluster_index << CF_CLUSTER_SHIFT;
+    return tb_lookup__cpu_state_pc(cpu, *pc, *cs_base, *flags, cf_mask);
+}
+
+/*
+ * As tb_lookup__cpu_state(), but first try the TB that indirect branch
+ * @site went to last time.  @ret tells whether @site was predicted by
+ * the return address stack, for the statistics.
+ *
+ * The prediction is checked like a jump cache entry, so it is dropped
+ * whenever the jump cache is cleared.  Evicting TBs must clear it too.
+ */
+static inline TranslationBlock *
+tb_lookup__cpu_state_site(CPUState *cpu, target_ulong *pc,
+                          target_ulong *cs_base, uint32_t *flags,
+                          uint32_t cf_mask, uint32_t site, bool ret)
+{
+    CPUArchState *env = (CPUArchState *)cpu->env_ptr;
+    size_t *lookups = ret ? &cpu->tb_ras_lookups : &cpu->tb_ibtc_lookups;
+    size_t *misses = ret ? &cpu->tb_ras_misses : &cpu->tb_ibtc_misses;
+    TranslationBlock *tb;
 
+    cpu_get_tb_cpu_state(env, pc, cs_base, flags);
     cf_mask &= ~CF_CLUSTER_MASK;
     cf_mask |= cpu->cluster_index << CF_CLUSTER_SHIFT;
 
-    if (likely(tb &&
-               tb->pc == *pc &&
-               tb->cs_base == *cs_base &&
-               tb->flags == *flags &&
-               tb->trace_vcpu_dstate == *cpu->trace_dstate &&
-               (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask)) {
+    site &= TB_IBTC_SIZE - 1;
+    tb = cpu->tb_ibtc[site];
+    atomic_set(lookups, *lookups + 1);
+    if (likely(tb_lookup_match(cpu, tb, *pc, *cs_base, *flags, cf_mask))) {
+        tb_lookup_sample(tb, *lookups);
         return tb;
     }
-    tb = tb_htable_lookup(cpu, *pc, *cs_base, *flags, cf_mask);
-    if (tb == NULL) {
-        return NULL;
+    atomic_set(misses, *misses + 1);
+    tb = tb_lookup__cpu_state_pc(cpu, *pc, *cs_base, *flags, cf_mask);
+    if (tb) {
+        cpu->tb_ibtc[site] = tb;
     }
-    atomic_set(&cpu->tb_jmp_cache[hash], tb);
     return tb;
 }
 
@@ -117,6 +117,10 @@ struct TranslationBlock;
  *       probe is true, return false; otherwise raise an exception and
  *       do not return.  For user-only mode, always raise an exception
  *       and do not return.
+ * @tlb_large_pages: Indicates that the size passed to tlb_set_page by
+ *       @tlb_fill describes a translation that is the same for every page
+ *       in the naturally aligned range, so the softmmu TLB may reuse it
+ *       for the other pages instead of calling @tlb_fill again.
  * @get_phys_page_debug: Callback for obtaining a physical address.
  * @get_phys_page_attrs_debug: Callback for obtaining a physical address and the
  *       associated memory transaction attributes to use for the access.
@@ -222,6 +226,7 @@ typedef struct CPUClass {
     /* Keep non-pointer data at the end to minimize holes.  */
     int gdb_num_core_regs;
     bool gdb_stop_before_watchpoint;
+    bool tlb_large_pages;
 } CPUClass;
 
 /*
@@ -261,11 +266,31 @@ struct CPUWatchpoint {
 
 struct KVMState;
 struct kvm_run;
+struct kvm_dirty_gfn;
 
 struct hax_vcpu_state;
 
-#define TB_JMP_CACHE_BITS 12
-#define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+/*
+ * Size of the per-vCPU jump cache, set with -accel tcg,tb-jmp-cache-bits.
+ * Half of the bits index within a page (see tb-hash.h), so the upper
+ * limit keeps that no wider than the smallest target page.
+ */
+#define TB_JMP_CACHE_BITS_DEFAULT 12
+#define TB_JMP_CACHE_BITS_MIN 8
+#define TB_JMP_CACHE_BITS_MAX 20
+
+extern unsigned int tb_jmp_cache_bits;
+
+#define TB_JMP_CACHE_BITS tb_jmp_cache_bits
+#define TB_JMP_CACHE_SIZE (1u << TB_JMP_CACHE_BITS)
+
+/*
+ * Per-vCPU indirect branch prediction: the last target of each indirect
+ * jump site, and a stack of the sites that returns are predicted from.
+ */
+#define TB_IBTC_BITS 9
+#define TB_IBTC_SIZE (1u << TB_IBTC_BITS)
+#define TB_RAS_SIZE 16
 
 /* work queue */
 
@@ -387,7 +412,26 @@ struct CPUState {
     IcountDecr *icount_decr_ptr;
 
     /* Accessed in parallel; all accesses must be atomic */
-    struct TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE];
+    struct TranslationBlock **tb_jmp_cache;
+    /* Only written by the vCPU thread, see tb_lookup__cpu_state() */
+    size_t tb_jmp_cache_lookups;
+    size_t tb_jmp_cache_misses;
+    size_t tb_htable_misses;
+    /* Lookups from the execution loop, i.e. not reached by a chained jump */
+    size_t tb_chain_breaks;
+
+    /*
+     * Only accessed by the vCPU thread or in an exclusive context, see
+     * tb_lookup__cpu_state_site().  tb_ras holds IBTC site numbers and is
+     * pushed to by generated code.
+     */
+    struct TranslationBlock *tb_ibtc[TB_IBTC_SIZE];
+    uint32_t tb_ras[TB_RAS_SIZE];
+    uint32_t tb_ras_top;
+    size_t tb_ibtc_lookups;
+    size_t tb_ibtc_misses;
+    size_t tb_ras_lookups;
+    size_t tb_ras_misses;
 
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
@@ -410,6 +454,8 @@ struct CPUState {
     int kvm_fd;
     struct KVMState *kvm_state;
     struct kvm_run *kvm_run;
+    struct kvm_dirty_gfn *kvm_dirty_gfns;
+    uint32_t kvm_fetch_index;
 
     /* Used for events with 'vcpu' and *without* the 'disabled' properties */
     DECLARE_BITMAP(trace_dstate_delayed, CPU_TRACE_DSTATE_MAX_EVENTS);
@@ -462,6 +508,7 @@ static inline void cpu_tb_jmp_cache_clear(CPUState *cpu)
     for (i = 0; i < TB_JMP_CACHE_SIZE; i++) {
         atomic_set(&cpu->tb_jmp_cache[i], NULL);
     }
+    memset(cpu->tb_ibtc, 0, sizeof(cpu->tb_ibtc));
 }
 
 /**
@@ -55,6 +55,8 @@ typedef struct SiFivePLICState {
     uint32_t *pending;
     uint32_t *claimed;
     uint32_t *enable;
+    /* Per context highest priority deliverable source, or 0 for none */
+    uint32_t *best_irq;
 
     /* config */
     char *hart_config;
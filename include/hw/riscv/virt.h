@@ -66,6 +66,7 @@ enum {
 };
 
 #define VIRT_PLIC_HART_CONFIG "MS"
+#define VIRT_PLIC_KVM_HART_CONFIG "S"
 #define VIRT_PLIC_NUM_SOURCES 127
 #define VIRT_PLIC_NUM_PRIORITIES 7
 #define VIRT_PLIC_PRIORITY_BASE 0x04
@@ -48,6 +48,11 @@ struct QIOChannelSocket {
     socklen_t localAddrLen;
     struct sockaddr_storage remoteAddr;
     socklen_t remoteAddrLen;
+    /* zero copy sendmsg() calls made, and those the kernel completed */
+    ssize_t zero_copy_queued;
+    ssize_t zero_copy_sent;
+    /* the kernel copied some of the data since the last flush */
+    bool zero_copy_copied;
 };
 
 
@@ -44,6 +44,7 @@ enum QIOChannelFeature {
     QIO_CHANNEL_FEATURE_FD_PASS,
     QIO_CHANNEL_FEATURE_SHUTDOWN,
     QIO_CHANNEL_FEATURE_LISTEN,
+    QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY,
 };
 
 
@@ -141,6 +142,12 @@ struct QIOChannelClass {
                                   IOHandler *io_read,
                                   IOHandler *io_write,
                                   void *opaque);
+    ssize_t (*io_writev_zero_copy)(QIOChannel *ioc,
+                                   const struct iovec *iov,
+                                   size_t niov,
+                                   Error **errp);
+    int (*io_flush)(QIOChannel *ioc,
+                    Error **errp);
 };
 
 /* General I/O handling functions */
@@ -349,6 +356,66 @@ int qio_channel_writev_all(QIOChannel *ioc,
                            size_t niov,
                            Error **erp);
 
+/**
+ * qio_channel_writev_zero_copy:
+ * @ioc: the channel object
+ * @iov: the array of memory regions to write data from
+ * @niov: the length of the @iov array
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Behaves as qio_channel_writev(), but the data is not copied
+ * into the kernel.  The memory referenced by @iov is instead
+ * pinned until the kernel has finished sending it, so it must
+ * remain valid until the next successful qio_channel_flush().
+ * The contents may still change in the meantime, in which case
+ * it is unspecified whether the old or new data is sent.
+ *
+ * It is an error to call this method unless
+ * qio_channel_has_feature() returns a true value for the
+ * QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY constant.
+ *
+ * Returns: the number of bytes queued, or -1 on error,
+ * or QIO_CHANNEL_ERR_BLOCK if no data is can be sent
+ * and the channel is non-blocking
+ */
+ssize_t qio_channel_writev_zero_copy(QIOChannel *ioc,
+                                     const struct iovec *iov,
+                                     size_t niov,
+                                     Error **errp);
+
+/**
+ * qio_channel_writev_zero_copy_all:
+ * @ioc: the channel object
+ * @iov: the array of memory regions to write data from
+ * @niov: the length of the @iov array
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Behaves as qio_channel_writev_all(), but uses
+ * qio_channel_writev_zero_copy() to queue the data.
+ *
+ * Returns: 0 if all bytes were queued, or -1 on error
+ */
+int qio_channel_writev_zero_copy_all(QIOChannel *ioc,
+                                     const struct iovec *iov,
+                                     size_t niov,
+                                     Error **errp);
+
+/**
+ * qio_channel_flush:
+ * @ioc: the channel object
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Wait until the kernel has released all the memory queued
+ * by qio_channel_writev_zero_copy().  Channels that do not
+ * support zero copy writes have nothing to wait for.
+ *
+ * Returns: 0 if all the data was sent without copying,
+ * 1 if the kernel had to fall back to copying some of it,
+ * or -1 on error
+ */
+int qio_channel_flush(QIOChannel *ioc,
+                      Error **errp);
+
 /**
  * qio_channel_readv:
  * @ioc: the channel object
@@ -68,6 +68,7 @@ enum plugin_dyn_cb_type {
 enum plugin_dyn_cb_subtype {
     PLUGIN_CB_REGULAR,
     PLUGIN_CB_INLINE,
+    PLUGIN_CB_COND,
     PLUGIN_N_CB_SUBTYPES,
 };
 
@@ -88,7 +89,16 @@ struct qemu_plugin_dyn_cb {
         struct {
             enum qemu_plugin_op op;
             uint64_t imm;
+            /* the op applies to userp + cpu_index * stride */
+            size_t stride;
         } inline_insn;
+        struct {
+            enum qemu_plugin_cond cond;
+            uint64_t imm;
+            /* compared with the value at ptr + cpu_index * stride */
+            void *ptr;
+            size_t stride;
+        } cond;
     };
 };
 
@@ -250,6 +250,65 @@ void qemu_plugin_register_vcpu_tb_exec_inline(struct qemu_plugin_tb *tb,
                                               enum qemu_plugin_op op,
                                               void *ptr, uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu() - per-vCPU inline op
+ * @tb: the opaque qemu_plugin_tb handle for the translation
+ * @op: the type of qemu_plugin_op (e.g. ADD_U64)
+ * @ptr: the base of the per-vCPU scoreboard
+ * @stride: the distance in bytes between two vCPUs' entries
+ * @imm: the op data (e.g. 1)
+ *
+ * Like qemu_plugin_register_vcpu_tb_exec_inline(), but the op applies to
+ * @ptr + vcpu_index * @stride.  Each vCPU then updates its own counter,
+ * so counts stay exact with MTTCG.  The scoreboard must have room for
+ * qemu_plugin_n_max_vcpus() entries; a @stride that is a multiple of the
+ * host cache line size avoids false sharing between vCPUs.
+ */
+void qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+    struct qemu_plugin_tb *tb, enum qemu_plugin_op op,
+    void *ptr, size_t stride, uint64_t imm);
+
+/**
+ * enum qemu_plugin_cond - condition of a conditional callback
+ *
+ * The value stored at the callback's location is compared, as an
+ * unsigned 64-bit integer, with the immediate.
+ */
+enum qemu_plugin_cond {
+    QEMU_PLUGIN_COND_NEVER,
+    QEMU_PLUGIN_COND_ALWAYS,
+    QEMU_PLUGIN_COND_EQ,
+    QEMU_PLUGIN_COND_NE,
+    QEMU_PLUGIN_COND_LT,
+    QEMU_PLUGIN_COND_LE,
+    QEMU_PLUGIN_COND_GT,
+    QEMU_PLUGIN_COND_GE,
+};
+
+/**
+ * qemu_plugin_register_vcpu_tb_exec_cond_cb() - conditional TB execution cb
+ * @tb: the opaque qemu_plugin_tb handle for the translation
+ * @cb: callback function
+ * @flags: does the plugin read or write the CPU's registers?
+ * @cond: the condition under which @cb is called
+ * @ptr: the base of the per-vCPU scoreboard holding the value to compare
+ * @stride: the distance in bytes between two vCPUs' entries, or 0
+ * @imm: the value to compare with
+ * @userdata: any plugin data to pass to the @cb
+ *
+ * Like qemu_plugin_register_vcpu_tb_exec_cb(), but @cb is only called if
+ * the uint64_t at @ptr + vcpu_index * @stride satisfies @cond with
+ * respect to @imm.  The comparison is done inline, so a callback that
+ * rarely fires, e.g. every N instructions counted by an inline op, costs
+ * little more than the inline op itself.
+ */
+void qemu_plugin_register_vcpu_tb_exec_cond_cb(struct qemu_plugin_tb *tb,
+                                               qemu_plugin_vcpu_udata_cb_t cb,
+                                               enum qemu_plugin_cb_flags flags,
+                                               enum qemu_plugin_cond cond,
+                                               void *ptr, size_t stride,
+                                               uint64_t imm, void *userdata);
+
 /**
  * qemu_plugin_register_vcpu_insn_exec_cb() - register insn execution cb
  * @insn: the opaque qemu_plugin_insn handle for an instruction
@@ -279,6 +338,38 @@ void qemu_plugin_register_vcpu_insn_exec_inline(struct qemu_plugin_insn *insn,
                                                 enum qemu_plugin_op op,
                                                 void *ptr, uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu() - per-vCPU inline op
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @op: the type of qemu_plugin_op (e.g. ADD_U64)
+ * @ptr: the base of the per-vCPU scoreboard
+ * @stride: the distance in bytes between two vCPUs' entries
+ * @imm: the op data (e.g. 1)
+ *
+ * See qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu().
+ */
+void qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(
+    struct qemu_plugin_insn *insn, enum qemu_plugin_op op,
+    void *ptr, size_t stride, uint64_t imm);
+
+/**
+ * qemu_plugin_register_vcpu_insn_exec_cond_cb() - conditional insn exec cb
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @cb: callback function
+ * @flags: does the plugin read or write the CPU's registers?
+ * @cond: the condition under which @cb is called
+ * @ptr: the base of the per-vCPU scoreboard holding the value to compare
+ * @stride: the distance in bytes between two vCPUs' entries, or 0
+ * @imm: the value to compare with
+ * @userdata: any plugin data to pass to the @cb
+ *
+ * See qemu_plugin_register_vcpu_tb_exec_cond_cb().
+ */
+void qemu_plugin_register_vcpu_insn_exec_cond_cb(
+    struct qemu_plugin_insn *insn, qemu_plugin_vcpu_udata_cb_t cb,
+    enum qemu_plugin_cb_flags flags, enum qemu_plugin_cond cond,
+    void *ptr, size_t stride, uint64_t imm, void *userdata);
+
 /*
  * Helpers to query information about the instructions in a block
  */
@@ -351,6 +442,21 @@ void qemu_plugin_register_vcpu_mem_inline(struct qemu_plugin_insn *insn,
                                           enum qemu_plugin_op op, void *ptr,
                                           uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_mem_inline_per_vcpu() - per-vCPU memory inline op
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @rw: monitor reads, writes or both
+ * @op: the type of qemu_plugin_op (e.g. ADD_U64)
+ * @ptr: the base of the per-vCPU scoreboard
+ * @stride: the distance in bytes between two vCPUs' entries
+ * @imm: the op data (e.g. 1)
+ *
+ * See qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu().
+ */
+void qemu_plugin_register_vcpu_mem_inline_per_vcpu(
+    struct qemu_plugin_insn *insn, enum qemu_plugin_mem_rw rw,
+    enum qemu_plugin_op op, void *ptr, size_t stride, uint64_t imm);
+
 
 
 typedef void
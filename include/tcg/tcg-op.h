@@ -833,6 +833,30 @@ void tcg_gen_goto_tb(unsigned idx);
  */
 void tcg_gen_lookup_and_goto_ptr(void);
 
+/**
+ * tcg_gen_lookup_and_goto_ptr_site() - as tcg_gen_lookup_and_goto_ptr(),
+ * for an indirect jump
+ *
+ * The TB that this jump went to last time is tried before the jump cache.
+ */
+void tcg_gen_lookup_and_goto_ptr_site(void);
+
+/**
+ * tcg_gen_push_return() - predict the return of a call
+ *
+ * Call this when translating a call.  The next return translated with
+ * tcg_gen_lookup_and_goto_ptr_return() is expected to go to the TB that
+ * this call's return went to last time.  Returns nest up to TB_RAS_SIZE
+ * deep; a wrong prediction only costs a jump cache lookup.
+ */
+void tcg_gen_push_return(void);
+
+/**
+ * tcg_gen_lookup_and_goto_ptr_return() - as tcg_gen_lookup_and_goto_ptr(),
+ * for a return
+ */
+void tcg_gen_lookup_and_goto_ptr_return(void);
+
 static inline void tcg_gen_plugin_cb_start(unsigned from, unsigned type,
                                            unsigned wr)
 {
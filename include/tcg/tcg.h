@@ -600,6 +600,7 @@ struct TCGContext {
 
     TCGRegSet reserved_regs;
     uint32_t tb_cflags; /* cflags of the current TB */
+    uint32_t ibtc_site; /* next indirect branch site of the current TB */
     intptr_t current_frame_offset;
     intptr_t frame_start;
     intptr_t frame_end;
@@ -821,6 +822,8 @@ TranslationBlock *tcg_tb_alloc(TCGContext *s);
 void tcg_region_init(void);
 void tb_destroy(TranslationBlock *tb);
 void tcg_region_reset_all(void);
+bool tcg_region_evict(void (*invalidate)(TranslationBlock *),
+                      size_t *n_evicted);
 
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
@@ -27,8 +27,21 @@
 #include "trace.h"
 #include "qapi/clone-visitor.h"
 
+#ifdef CONFIG_LINUX
+#include <linux/errqueue.h>
+
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define QEMU_MSG_ZEROCOPY
+#endif
+#endif
+
 #define SOCKET_MAX_FDS 16
 
+#ifdef QEMU_MSG_ZEROCOPY
+static int qio_channel_socket_flush(QIOChannel *ioc,
+                                    Error **errp);
+#endif
+
 SocketAddress *
 qio_channel_socket_get_local_address(QIOChannelSocket *ioc,
                                      Error **errp)
@@ -154,6 +167,19 @@ int qio_channel_socket_connect_sync(QIOChannelSocket *ioc,
         return -1;
     }
 
+#ifdef QEMU_MSG_ZEROCOPY
+    if (ioc->localAddr.ss_family == AF_INET ||
+        ioc->localAddr.ss_family == AF_INET6) {
+        int v = 1;
+
+        /* Only needed by MSG_ZEROCOPY, so failing is not an error */
+        if (qemu_setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &v, sizeof(v)) == 0) {
+            qio_channel_set_feature(QIO_CHANNEL(ioc),
+                                    QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY);
+        }
+    }
+#endif
+
     return 0;
 }
 
@@ -520,12 +546,13 @@ static ssize_t qio_channel_socket_readv(QIOChannel *ioc,
     return ret;
 }
 
-static ssize_t qio_channel_socket_writev(QIOChannel *ioc,
-                                         const struct iovec *iov,
-                                         size_t niov,
-                                         int *fds,
-                                         size_t nfds,
-                                         Error **errp)
+static ssize_t qio_channel_socket_sendmsg(QIOChannel *ioc,
+                                          const struct iovec *iov,
+                                          size_t niov,
+                                          int *fds,
+                                          size_t nfds,
+                                          int sflags,
+                                          Error **errp)
 {
     QIOChannelSocket *sioc = QIO_CHANNEL_SOCKET(ioc);
     ssize_t ret;
@@ -558,7 +585,7 @@ static ssize_t qio_channel_socket_writev(QIOChannel *ioc,
     }
 
  retry:
-    ret = sendmsg(sioc->fd, &msg, 0);
+    ret = sendmsg(sioc->fd, &msg, sflags);
     if (ret <= 0) {
         if (errno == EAGAIN) {
             return QIO_CHANNEL_ERR_BLOCK;
@@ -566,12 +593,131 @@ static ssize_t qio_channel_socket_writev(QIOChannel *ioc,
         if (errno == EINTR) {
             goto retry;
         }
+#ifdef QEMU_MSG_ZEROCOPY
+        if (errno == ENOBUFS && (sflags & MSG_ZEROCOPY)) {
+            /*
+             * The pages pinned for earlier writes count against the
+             * locked memory limit, so wait for them to be released.
+             */
+            if (sioc->zero_copy_sent < sioc->zero_copy_queued) {
+                int flushed = qio_channel_socket_flush(ioc, errp);
+
+                if (flushed < 0) {
+                    return -1;
+                }
+                /* Leave any copy fallback for the caller's own flush */
+                sioc->zero_copy_copied |= flushed;
+                goto retry;
+            }
+            error_setg_errno(errp, errno,
+                             "Process can't lock enough memory for "
+                             "zero copy writes");
+            return -1;
+        }
+#endif
         error_setg_errno(errp, errno,
                          "Unable to write to socket");
         return -1;
     }
     return ret;
 }
+
+static ssize_t qio_channel_socket_writev(QIOChannel *ioc,
+                                         const struct iovec *iov,
+                                         size_t niov,
+                                         int *fds,
+                                         size_t nfds,
+                                         Error **errp)
+{
+    return qio_channel_socket_sendmsg(ioc, iov, niov, fds, nfds, 0, errp);
+}
+
+#ifdef QEMU_MSG_ZEROCOPY
+static ssize_t qio_channel_socket_writev_zero_copy(QIOChannel *ioc,
+                                                   const struct iovec *iov,
+                                                   size_t niov,
+                                                   Error **errp)
+{
+    QIOChannelSocket *sioc = QIO_CHANNEL_SOCKET(ioc);
+    ssize_t ret;
+
+    ret = qio_channel_socket_sendmsg(ioc, iov, niov, NULL, 0,
+                                     MSG_ZEROCOPY, errp);
+    if (ret > 0) {
+        sioc->zero_copy_queued++;
+    }
+    return ret;
+}
+
+/*
+ * Each successful MSG_ZEROCOPY sendmsg() is completed by a notification
+ * on the socket error queue, which covers a range of sendmsg() calls.
+ * Read them until every call made so far has been accounted for.
+ */
+static int qio_channel_socket_flush(QIOChannel *ioc,
+                                    Error **errp)
+{
+    QIOChannelSocket *sioc = QIO_CHANNEL_SOCKET(ioc);
+    struct msghdr msg = { NULL, };
+    struct sock_extended_err *serr;
+    struct cmsghdr *cm;
+    char control[CMSG_SPACE(sizeof(*serr))];
+
+    while (sioc->zero_copy_sent < sioc->zero_copy_queued) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(sioc->fd, &msg, MSG_ERRQUEUE) < 0) {
+            if (errno == EAGAIN) {
+                /* Nothing completed yet, wait for the next notification */
+                qio_channel_wait(ioc, G_IO_ERR);
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            error_setg_errno(errp, errno,
+                             "Unable to read socket error queue");
+            return -1;
+        }
+
+        cm = CMSG_FIRSTHDR(&msg);
+        if (!cm ||
+            !((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+              (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+            error_setg_errno(errp, EPROTOTYPE,
+                             "Wrong cmsg in socket error queue");
+            return -1;
+        }
+
+        serr = (void *) CMSG_DATA(cm);
+        if (serr->ee_errno != 0) {
+            error_setg_errno(errp, serr->ee_errno,
+                             "Error on socket error queue");
+            return -1;
+        }
+        if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+            error_setg_errno(errp, serr->ee_origin,
+                             "Unexpected origin in socket error queue");
+            return -1;
+        }
+
+        sioc->zero_copy_sent += serr->ee_data - serr->ee_info + 1;
+
+        /* The kernel could not pin the pages and copied them instead */
+        if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+            sioc->zero_copy_copied = true;
+        }
+    }
+
+    if (sioc->zero_copy_copied) {
+        sioc->zero_copy_copied = false;
+        return 1;
+    }
+    return 0;
+}
+#endif /* QEMU_MSG_ZEROCOPY */
 #else /* WIN32 */
 static ssize_t qio_channel_socket_readv(QIOChannel *ioc,
                                         const struct iovec *iov,
@@ -787,6 +933,10 @@ static void qio_channel_socket_class_init(ObjectClass *klass,
     ioc_klass->io_set_delay = qio_channel_socket_set_delay;
     ioc_klass->io_create_watch = qio_channel_socket_create_watch;
     ioc_klass->io_set_aio_fd_handler = qio_channel_socket_set_aio_fd_handler;
+#ifdef QEMU_MSG_ZEROCOPY
+    ioc_klass->io_writev_zero_copy = qio_channel_socket_writev_zero_copy;
+    ioc_klass->io_flush = qio_channel_socket_flush;
+#endif
 }
 
 static const TypeInfo qio_channel_socket_info = {
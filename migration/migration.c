@@ -923,6 +923,8 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
     info->ram->page_size = qemu_target_page_size();
     info->ram->multifd_bytes = ram_counters.multifd_bytes;
     info->ram->pages_per_second = s->pages_per_second;
+    info->ram->dirty_sync_missed_zero_copy =
+        ram_counters.dirty_sync_missed_zero_copy;
 
     if (migrate_use_xbzrle()) {
         info->has_xbzrle_cache = true;
@@ -932,8 +934,10 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
         info->xbzrle_cache->pages = xbzrle_counters.pages;
         info->xbzrle_cache->cache_miss = xbzrle_counters.cache_miss;
         info->xbzrle_cache->cache_miss_rate = xbzrle_counters.cache_miss_rate;
+        info->xbzrle_cache->cache_hit_rate = xbzrle_counters.cache_hit_rate;
         info->xbzrle_cache->encoding_rate = xbzrle_counters.encoding_rate;
         info->xbzrle_cache->overflow = xbzrle_counters.overflow;
+        info->xbzrle_cache->overflow_rate = xbzrle_counters.overflow_rate;
     }
 
     if (migrate_use_compression()) {
@@ -1082,6 +1086,22 @@ static bool migrate_caps_check(bool *cap_list,
         }
     }
 
+    if (cap_list[MIGRATION_CAPABILITY_ZERO_COPY_SEND]) {
+#ifndef CONFIG_LINUX
+        error_setg(errp, "Zero copy send is only supported on Linux");
+        return false;
+#endif
+        if (!cap_list[MIGRATION_CAPABILITY_MULTIFD]) {
+            error_setg(errp, "Zero copy send requires multifd");
+            return false;
+        }
+        if (migrate_multifd_compression() != MULTIFD_COMPRESSION_NONE) {
+            error_setg(errp, "Zero copy send is not compatible with "
+                       "multifd compression");
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -1292,6 +1312,13 @@ static bool migrate_params_check(MigrationParameters *params, Error **errp)
                    "is invalid, it must be in the range of 1 to 10000 ms");
        return false;
     }
+    if (params->has_multifd_compression &&
+        params->multifd_compression != MULTIFD_COMPRESSION_NONE &&
+        migrate_use_zero_copy_send()) {
+        error_setg(errp, "Multifd compression is not compatible with "
+                   "zero-copy-send");
+        return false;
+    }
     return true;
 }
 
@@ -2188,6 +2215,15 @@ bool migrate_postcopy_blocktime(void)
     return s->enabled_capabilities[MIGRATION_CAPABILITY_POSTCOPY_BLOCKTIME];
 }
 
+bool migrate_use_zero_copy_send(void)
+{
+    MigrationState *s;
+
+    s = migrate_get_current();
+
+    return s->enabled_capabilities[MIGRATION_CAPABILITY_ZERO_COPY_SEND];
+}
+
 bool migrate_use_compression(void)
 {
     MigrationState *s;
@@ -2297,6 +2333,15 @@ int migrate_multifd_channels(void)
     return s->parameters.multifd_channels;
 }
 
+bool migrate_multifd_zero_pages(void)
+{
+    MigrationState *s;
+
+    s = migrate_get_current();
+
+    return s->multifd_zero_pages;
+}
+
 MultiFDCompression migrate_multifd_compression(void)
 {
     MigrationState *s;
@@ -3588,6 +3633,8 @@ static Property migration_properties[] = {
                      send_section_footer, true),
     DEFINE_PROP_BOOL("decompress-error-check", MigrationState,
                       decompress_error_check, true),
+    DEFINE_PROP_BOOL("x-multifd-zero-pages", MigrationState,
+                      multifd_zero_pages, true),
     DEFINE_PROP_UINT8("x-clear-bitmap-shift", MigrationState,
                       clear_bitmap_shift, CLEAR_BITMAP_SHIFT_DEFAULT),
 
@@ -3669,6 +3716,7 @@ static Property migration_properties[] = {
     DEFINE_PROP_MIG_CAP("x-block", MIGRATION_CAPABILITY_BLOCK),
     DEFINE_PROP_MIG_CAP("x-return-path", MIGRATION_CAPABILITY_RETURN_PATH),
     DEFINE_PROP_MIG_CAP("x-multifd", MIGRATION_CAPABILITY_MULTIFD),
+    DEFINE_PROP_MIG_CAP("x-zero-copy-send", MIGRATION_CAPABILITY_ZERO_COPY_SEND),
 
     DEFINE_PROP_END_OF_LIST(),
 };
@@ -252,6 +252,13 @@ struct MigrationState
      */
     bool decompress_error_check;
 
+    /*
+     * Whether multifd channels detect zero pages themselves and send
+     * them as a list of offsets in the packet header.  Left at false
+     * for qemu older than 5.1, whose receive side ignores that list.
+     */
+    bool multifd_zero_pages;
+
     /*
      * This decides the size of guest memory chunk that will be used
      * to track dirty bitmap clearing.  The size of memory chunk will
@@ -300,6 +307,7 @@ bool migrate_auto_converge(void);
 bool migrate_use_multifd(void);
 bool migrate_pause_before_switchover(void);
 int migrate_multifd_channels(void);
+bool migrate_multifd_zero_pages(void);
 MultiFDCompression migrate_multifd_compression(void);
 int migrate_multifd_zlib_level(void);
 int migrate_multifd_zstd_level(void);
@@ -316,6 +324,7 @@ bool migrate_use_return_path(void);
 uint64_t ram_get_total_transferred_pages(void);
 
 bool migrate_use_compression(void);
+bool migrate_use_zero_copy_send(void);
 int migrate_compress_level(void);
 int migrate_compress_threads(void);
 int migrate_compress_wait_thread(void);
@@ -0,0 +1,316 @@
+/*
+ * Multifd XBZRLE implementation
+ *
+ * Copyright (c) 2020 SiFive, Inc.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "exec/target_page.h"
+#include "qapi/error.h"
+#include "migration.h"
+#include "ram.h"
+#include "xbzrle.h"
+#include "trace.h"
+#include "multifd.h"
+
+/*
+ * Each page in the packet is a be32 length followed by its data:
+ *  - 0: the page did not change since the copy the destination has
+ *  - the page size: the page is sent whole
+ *  - anything else: the page is XBZRLE encoded
+ */
+
+struct xbzrle_data {
+    /* copy of the page being sent */
+    uint8_t *current_buf;
+    /* copy of the page from the cache */
+    uint8_t *old_buf;
+    /* packet buffer */
+    uint8_t *buf;
+    /* size of packet buffer */
+    uint32_t buf_len;
+};
+
+static struct xbzrle_data *xbzrle_data_new(void)
+{
+    uint32_t page_count = MULTIFD_PACKET_SIZE / qemu_target_page_size();
+    size_t page_size = qemu_target_page_size();
+    struct xbzrle_data *x = g_new0(struct xbzrle_data, 1);
+
+    x->current_buf = qemu_memalign(sizeof(long), page_size);
+    x->old_buf = qemu_memalign(sizeof(long), page_size);
+    /* We will never have more than page_count pages */
+    x->buf_len = page_count * (sizeof(uint32_t) + page_size);
+    x->buf = g_malloc(x->buf_len);
+
+    return x;
+}
+
+static void xbzrle_data_free(struct xbzrle_data *x)
+{
+    qemu_vfree(x->current_buf);
+    qemu_vfree(x->old_buf);
+    g_free(x->buf);
+    g_free(x);
+}
+
+/* Multifd XBZRLE */
+
+/**
+ * xbzrle_send_setup: setup send side
+ *
+ * The pages are encoded against the XBZRLE cache, so that has to be
+ * enabled too.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static int xbzrle_send_setup(MultiFDSendParams *p, Error **errp)
+{
+    if (!migrate_use_xbzrle()) {
+        error_setg(errp, "multifd %d: xbzrle compression needs the xbzrle "
+                   "capability", p->id);
+        return -1;
+    }
+    p->data = xbzrle_data_new();
+    return 0;
+}
+
+/**
+ * xbzrle_send_cleanup: cleanup send side
+ *
+ * @p: Params for the channel that we are using
+ */
+static void xbzrle_send_cleanup(MultiFDSendParams *p, Error **errp)
+{
+    if (p->data) {
+        xbzrle_data_free(p->data);
+        p->data = NULL;
+    }
+}
+
+/**
+ * xbzrle_send_zero_pages: keep the cache in line with the zero pages
+ *
+ * The destination clears these pages, so their cached copies must be
+ * cleared too, or the next version would be encoded against data the
+ * destination no longer has.  This runs for packets that only hold
+ * zero pages as well, which skip xbzrle_send_prepare().
+ *
+ * @p: Params for the channel that we are using
+ */
+static void xbzrle_send_zero_pages(MultiFDSendParams *p)
+{
+    MultiFDPages_t *pages = p->pages;
+    uint32_t i;
+
+    for (i = 0; i < pages->zero_num; i++) {
+        xbzrle_multifd_zero_page(pages->block, pages->zero_offset[i]);
+    }
+}
+
+/**
+ * xbzrle_send_prepare: prepare date to be able to send
+ *
+ * Encode each page against its cached copy, or send it whole when it
+ * is not cached or does not encode in less than a page.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @used: number of pages used
+ * @errp: pointer to an error
+ */
+static int xbzrle_send_prepare(MultiFDSendParams *p, uint32_t used,
+                               Error **errp)
+{
+    struct xbzrle_data *x = p->data;
+    MultiFDPages_t *pages = p->pages;
+    size_t page_size = qemu_target_page_size();
+    uint64_t hits = 0, misses = 0, overflows = 0, bytes = 0;
+    uint32_t out_size = 0;
+    uint32_t i;
+
+    for (i = 0; i < used; i++) {
+        uint8_t *out = x->buf + out_size + sizeof(uint32_t);
+        int len = -1;
+
+        /* The guest may still be writing to the page */
+        memcpy(x->current_buf, pages->iov[i].iov_base, page_size);
+
+        if (xbzrle_multifd_lookup(pages->block, pages->offset[i],
+                                  x->current_buf, x->old_buf)) {
+            len = xbzrle_encode_buffer(x->old_buf, x->current_buf, page_size,
+                                       out, page_size - 1);
+            if (len != 0) {
+                xbzrle_multifd_update(pages->block, pages->offset[i],
+                                      x->current_buf);
+            }
+            if (len < 0) {
+                overflows++;
+                bytes += page_size;
+            } else {
+                bytes += len;
+            }
+            hits++;
+        } else {
+            misses++;
+        }
+        if (len < 0) {
+            memcpy(out, x->current_buf, page_size);
+            len = page_size;
+        }
+        stl_be_p(x->buf + out_size, len);
+        out_size += sizeof(uint32_t) + len;
+    }
+    xbzrle_multifd_account(hits, misses, overflows, bytes);
+    p->next_packet_size = out_size;
+    p->flags |= MULTIFD_FLAG_XBZRLE;
+
+    return 0;
+}
+
+/**
+ * xbzrle_send_write: do the actual write of the data
+ *
+ * Do the actual write of the encoded buffer.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @used: number of pages used
+ * @errp: pointer to an error
+ */
+static int xbzrle_send_write(MultiFDSendParams *p, uint32_t used,
+                             Error **errp)
+{
+    struct xbzrle_data *x = p->data;
+
+    return qio_channel_write_all(p->c, (void *)x->buf, p->next_packet_size,
+                                 errp);
+}
+
+/**
+ * xbzrle_recv_setup: setup receive side
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static int xbzrle_recv_setup(MultiFDRecvParams *p, Error **errp)
+{
+    p->data = xbzrle_data_new();
+    return 0;
+}
+
+/**
+ * xbzrle_recv_cleanup: cleanup receive side
+ *
+ * @p: Params for the channel that we are using
+ */
+static void xbzrle_recv_cleanup(MultiFDRecvParams *p)
+{
+    if (p->data) {
+        xbzrle_data_free(p->data);
+        p->data = NULL;
+    }
+}
+
+/**
+ * xbzrle_recv_pages: read the data from the channel into actual pages
+ *
+ * Read the encoded buffer, and apply each page to the copy that the
+ * destination already has.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @used: number of pages used
+ * @errp: pointer to an error
+ */
+static int xbzrle_recv_pages(MultiFDRecvParams *p, uint32_t used,
+                             Error **errp)
+{
+    struct xbzrle_data *x = p->data;
+    uint32_t in_size = p->next_packet_size;
+    uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
+    size_t page_size = qemu_target_page_size();
+    uint32_t in = 0;
+    uint32_t i;
+    int ret;
+
+    if (flags != MULTIFD_FLAG_XBZRLE) {
+        error_setg(errp, "multifd %d: flags received %x flags expected %x",
+                   p->id, flags, MULTIFD_FLAG_XBZRLE);
+        return -1;
+    }
+    if (in_size > x->buf_len) {
+        error_setg(errp, "multifd %d: packet size received %d maximum %d",
+                   p->id, in_size, x->buf_len);
+        return -1;
+    }
+    ret = qio_channel_read_all(p->c, (void *)x->buf, in_size, errp);
+    if (ret != 0) {
+        return ret;
+    }
+
+    for (i = 0; i < used; i++) {
+        uint8_t *host = p->pages->iov[i].iov_base;
+        uint32_t len;
+
+        if (in_size - in < sizeof(uint32_t)) {
+            error_setg(errp, "multifd %d: packet too short for page %d",
+                       p->id, i);
+            return -1;
+        }
+        len = ldl_be_p(x->buf + in);
+        in += sizeof(uint32_t);
+        if (len > page_size || in_size - in < len) {
+            error_setg(errp, "multifd %d: page %d has bad length %d",
+                       p->id, i, len);
+            return -1;
+        }
+
+        if (len == page_size) {
+            memcpy(host, x->buf + in, page_size);
+        } else if (len &&
+                   xbzrle_decode_buffer(x->buf + in, len, host,
+                                        page_size) < 0) {
+            error_setg(errp, "multifd %d: failed to decode page %d",
+                       p->id, i);
+            return -1;
+        }
+        in += len;
+    }
+    if (in != in_size) {
+        error_setg(errp, "multifd %d: packet size received %d size used %d",
+                   p->id, in_size, in);
+        return -1;
+    }
+    return 0;
+}
+
+static MultiFDMethods multifd_xbzrle_ops = {
+    .send_setup = xbzrle_send_setup,
+    .send_cleanup = xbzrle_send_cleanup,
+    .send_prepare = xbzrle_send_prepare,
+    .send_zero_pages = xbzrle_send_zero_pages,
+    .send_write = xbzrle_send_write,
+    .recv_setup = xbzrle_recv_setup,
+    .recv_cleanup = xbzrle_recv_cleanup,
+    .recv_pages = xbzrle_recv_pages
+};
+
+static void multifd_xbzrle_register(void)
+{
+    multifd_register_ops(MULTIFD_COMPRESSION_XBZRLE, &multifd_xbzrle_ops);
+}
+
+migration_init(multifd_xbzrle_register);
@@ -12,6 +12,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/rcu.h"
+#include "qemu/cutils.h"
 #include "exec/target_page.h"
 #include "sysemu/sysemu.h"
 #include "exec/ramblock.h"
@@ -90,7 +91,8 @@ static int nocomp_send_prepare(MultiFDSendParams *p, uint32_t used,
 /**
  * nocomp_send_write: do the actual write of the data
  *
- * For no compression we just have to write the data.
+ * For no compression we just have to write the data.  With zero copy
+ * the pages are only queued, see multifd_send_flush().
  *
  * Returns 0 for success or -1 for error
  *
@@ -100,6 +102,10 @@ static int nocomp_send_prepare(MultiFDSendParams *p, uint32_t used,
  */
 static int nocomp_send_write(MultiFDSendParams *p, uint32_t used, Error **errp)
 {
+    if (migrate_use_zero_copy_send()) {
+        return qio_channel_writev_zero_copy_all(p->c, p->pages->iov, used,
+                                                errp);
+    }
     return qio_channel_writev_all(p->c, p->pages->iov, used, errp);
 }
 
@@ -241,6 +247,7 @@ static MultiFDPages_t *multifd_pages_init(size_t size)
     pages->allocated = size;
     pages->iov = g_new0(struct iovec, size);
     pages->offset = g_new0(ram_addr_t, size);
+    pages->zero_offset = g_new0(ram_addr_t, size);
 
     return pages;
 }
@@ -255,6 +262,9 @@ static void multifd_pages_clear(MultiFDPages_t *pages)
     pages->iov = NULL;
     g_free(pages->offset);
     pages->offset = NULL;
+    pages->zero_num = 0;
+    g_free(pages->zero_offset);
+    pages->zero_offset = NULL;
     g_free(pages);
 }
 
@@ -268,6 +278,7 @@ static void multifd_send_fill_packet(MultiFDSendParams *p)
     packet->pages_used = cpu_to_be32(p->pages->used);
     packet->next_packet_size = cpu_to_be32(p->next_packet_size);
     packet->packet_num = cpu_to_be64(p->packet_num);
+    packet->zero_pages = cpu_to_be32(p->pages->zero_num);
 
     if (p->pages->block) {
         strncpy(packet->ramblock, p->pages->block->idstr, 256);
@@ -279,6 +290,12 @@ static void multifd_send_fill_packet(MultiFDSendParams *p)
 
         packet->offset[i] = cpu_to_be64(temp);
     }
+
+    for (i = 0; i < p->pages->zero_num; i++) {
+        uint64_t temp = p->pages->zero_offset[i];
+
+        packet->offset[p->pages->used + i] = cpu_to_be64(temp);
+    }
 }
 
 static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
@@ -334,10 +351,19 @@ static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
         return -1;
     }
 
+    p->pages->zero_num = be32_to_cpu(packet->zero_pages);
+    if (p->pages->zero_num > packet->pages_alloc - p->pages->used) {
+        error_setg(errp, "multifd: received packet "
+                   "with %d zero pages and expected maximum pages are %d",
+                   p->pages->zero_num,
+                   packet->pages_alloc - p->pages->used);
+        return -1;
+    }
+
     p->next_packet_size = be32_to_cpu(packet->next_packet_size);
     p->packet_num = be64_to_cpu(packet->packet_num);
 
-    if (p->pages->used == 0) {
+    if (p->pages->used == 0 && p->pages->zero_num == 0) {
         return 0;
     }
 
@@ -363,9 +389,79 @@ static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
         p->pages->iov[i].iov_len = qemu_target_page_size();
     }
 
+    for (i = 0; i < p->pages->zero_num; i++) {
+        uint64_t offset = be64_to_cpu(packet->offset[p->pages->used + i]);
+
+        if (offset > (block->used_length - qemu_target_page_size())) {
+            error_setg(errp, "multifd: zero page offset too long %" PRIu64
+                       " (max " RAM_ADDR_FMT ")",
+                       offset, block->max_length);
+            return -1;
+        }
+        p->pages->zero_offset[i] = offset;
+    }
+    p->pages->block = block;
+
     return 0;
 }
 
+/**
+ * multifd_send_zero_pages: split the zero pages out of a packet
+ *
+ * Scans the pages queued for @p and moves the ones that are all zeroes
+ * to the zero page list, so that only their offsets go on the wire.
+ * This keeps the buffer_is_zero() pass off the migration thread.
+ *
+ * Returns the number of pages that still need their data sent.
+ *
+ * @p: Params for the channel that we are using
+ */
+static uint32_t multifd_send_zero_pages(MultiFDSendParams *p)
+{
+    MultiFDPages_t *pages = p->pages;
+    size_t page_size = qemu_target_page_size();
+    uint32_t i, used = 0;
+
+    pages->zero_num = 0;
+    if (!migrate_multifd_zero_pages()) {
+        return pages->used;
+    }
+
+    for (i = 0; i < pages->used; i++) {
+        if (buffer_is_zero(pages->iov[i].iov_base, page_size)) {
+            pages->zero_offset[pages->zero_num++] = pages->offset[i];
+        } else {
+            pages->offset[used] = pages->offset[i];
+            pages->iov[used] = pages->iov[i];
+            used++;
+        }
+    }
+    pages->used = used;
+    p->zero_pages += pages->zero_num;
+
+    return used;
+}
+
+/**
+ * multifd_recv_zero_pages: clear the zero pages of a received packet
+ *
+ * Pages that are already zero are left untouched so that the
+ * destination does not allocate memory for them.
+ *
+ * @p: Params for the channel that we are using
+ */
+static void multifd_recv_zero_pages(MultiFDRecvParams *p)
+{
+    MultiFDPages_t *pages = p->pages;
+    uint32_t i;
+
+    for (i = 0; i < pages->zero_num; i++) {
+        ram_handle_compressed(pages->block->host + pages->zero_offset[i], 0,
+                              qemu_target_page_size());
+    }
+    pages->zero_num = 0;
+}
+
 struct {
     MultiFDSendParams *params;
     /* array of pages to sent */
@@ -402,6 +498,59 @@ struct {
  * false.
  */
 
+/*
+ * Zero pages are only found by the channel threads, after the migration
+ * thread has already accounted them as normal pages.  Move them over to
+ * the duplicate counter once the channel is done with them, and give
+ * their bytes back to the rate limit, which was charged for them too.
+ * Must be called with p->mutex held.
+ */
+static void multifd_send_account_zero_pages(QEMUFile *f,
+                                            MultiFDSendParams *p)
+{
+    uint64_t bytes = p->zero_pages * qemu_target_page_size();
+
+    qemu_file_update_transfer(f, -(int64_t)bytes);
+    ram_counters.duplicate += p->zero_pages;
+    ram_counters.normal -= p->zero_pages;
+    ram_counters.multifd_bytes -= bytes;
+    ram_counters.transferred -= bytes;
+    p->zero_pages = 0;
+}
+
+/**
+ * multifd_send_flush: wait for the zero copy writes of a channel
+ *
+ * Guest pages written with zero copy stay in use by the kernel after
+ * send_write returns.  Wait for all of them at each sync, so that
+ * everything sent before a dirty bitmap sync has left before the
+ * migration thread carries on.
+ *
+ * Returns 0 for success or -1 for error
+ *
+ * @p: Params for the channel that we are using
+ * @errp: pointer to an error
+ */
+static int multifd_send_flush(MultiFDSendParams *p, Error **errp)
+{
+    int ret;
+
+    if (!migrate_use_zero_copy_send()) {
+        return 0;
+    }
+
+    ret = qio_channel_flush(p->c, errp);
+    if (ret < 0) {
+        return -1;
+    }
+    if (ret == 1) {
+        qemu_mutex_lock(&p->mutex);
+        p->zero_copy_missed++;
+        qemu_mutex_unlock(&p->mutex);
+    }
+    return 0;
+}
+
 static int multifd_send_pages(QEMUFile *f)
 {
     int i;
@@ -433,6 +582,7 @@ static int multifd_send_pages(QEMUFile *f)
         if (!p->pending_job) {
             p->pending_job++;
             next_channel = (i + 1) % migrate_multifd_channels();
+            multifd_send_account_zero_pages(f, p);
             break;
         }
         qemu_mutex_unlock(&p->mutex);
@@ -608,6 +758,12 @@ void multifd_send_sync_main(QEMUFile *f)
 
         trace_multifd_send_sync_main_wait(p->id);
         qemu_sem_wait(&p->sem_sync);
+
+        WITH_QEMU_LOCK_GUARD(&p->mutex) {
+            multifd_send_account_zero_pages(f, p);
+            ram_counters.dirty_sync_missed_zero_copy += p->zero_copy_missed;
+            p->zero_copy_missed = 0;
+        }
     }
     trace_multifd_send_sync_main(multifd_send_state->packet_num);
 }
@@ -638,10 +794,14 @@ static void *multifd_send_thread(void *opaque)
         qemu_mutex_lock(&p->mutex);
 
         if (p->pending_job) {
-            uint32_t used = p->pages->used;
+            uint32_t used = multifd_send_zero_pages(p);
+            uint32_t zero = p->pages->zero_num;
             uint64_t packet_num = p->packet_num;
             flags = p->flags;
 
+            if (zero && multifd_send_state->ops->send_zero_pages) {
+                multifd_send_state->ops->send_zero_pages(p);
+            }
             if (used) {
                 ret = multifd_send_state->ops->send_prepare(p, used,
                                                             &local_err);
@@ -655,10 +815,11 @@ static void *multifd_send_thread(void *opaque)
             p->num_packets++;
             p->num_pages += used;
             p->pages->used = 0;
+            p->pages->zero_num = 0;
             p->pages->block = NULL;
             qemu_mutex_unlock(&p->mutex);
 
-            trace_multifd_send(p->id, packet_num, used, flags,
+            trace_multifd_send(p->id, packet_num, used, zero, flags,
                                p->next_packet_size);
 
             ret = qio_channel_write_all(p->c, (void *)p->packet,
@@ -679,6 +840,10 @@ static void *multifd_send_thread(void *opaque)
             qemu_mutex_unlock(&p->mutex);
 
             if (flags & MULTIFD_FLAG_SYNC) {
+                ret = multifd_send_flush(p, &local_err);
+                if (ret != 0) {
+                    break;
+                }
                 qemu_sem_post(&p->sem_sync);
             }
             qemu_sem_post(&multifd_send_state->channels_ready);
@@ -724,26 +889,34 @@ static void multifd_new_send_channel_async(QIOTask *task, gpointer opaque)
     Error *local_err = NULL;
 
     trace_multifd_new_send_channel_async(p->id);
-    if (qio_task_propagate_error(task, &local_err)) {
-        migrate_set_error(migrate_get_current(), local_err);
-        /* Error happen, we need to tell who pay attention to me */
-        qemu_sem_post(&multifd_send_state->channels_ready);
-        qemu_sem_post(&p->sem_sync);
-        /*
-         * Although multifd_send_thread is not created, but main migration
-         * thread neet to judge whether it is running, so we need to mark
-         * its status.
-         */
-        p->quit = true;
-        object_unref(OBJECT(sioc));
-        error_free(local_err);
-    } else {
-        p->c = QIO_CHANNEL(sioc);
-        qio_channel_set_delay(p->c, false);
-        p->running = true;
-        qemu_thread_create(&p->thread, p->name, multifd_send_thread, p,
-                           QEMU_THREAD_JOINABLE);
+    if (!qio_task_propagate_error(task, &local_err)) {
+        if (migrate_use_zero_copy_send() &&
+            !qio_channel_has_feature(sioc,
+                                     QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY)) {
+            error_setg(&local_err, "multifd %d: channel does not support "
+                       "zero copy send", p->id);
+        } else {
+            p->c = QIO_CHANNEL(sioc);
+            qio_channel_set_delay(p->c, false);
+            p->running = true;
+            qemu_thread_create(&p->thread, p->name, multifd_send_thread, p,
+                               QEMU_THREAD_JOINABLE);
+            return;
+        }
     }
+
+    migrate_set_error(migrate_get_current(), local_err);
+    /* Error happen, we need to tell who pay attention to me */
+    qemu_sem_post(&multifd_send_state->channels_ready);
+    qemu_sem_post(&p->sem_sync);
+    /*
+     * Although multifd_send_thread is not created, but main migration
+     * thread neet to judge whether it is running, so we need to mark
+     * its status.
+     */
+    p->quit = true;
+    object_unref(OBJECT(sioc));
+    error_free(local_err);
 }
 
 int multifd_save_setup(Error **errp)
@@ -926,6 +1099,7 @@ static void *multifd_recv_thread(void *opaque)
 
     while (true) {
         uint32_t used;
+        uint32_t zero;
         uint32_t flags;
 
         if (p->quit) {
@@ -949,10 +1123,11 @@ static void *multifd_recv_thread(void *opaque)
         }
 
         used = p->pages->used;
+        zero = p->pages->zero_num;
         flags = p->flags;
         /* recv methods don't know how to handle the SYNC flag */
         p->flags &= ~MULTIFD_FLAG_SYNC;
-        trace_multifd_recv(p->id, p->packet_num, used, flags,
+        trace_multifd_recv(p->id, p->packet_num, used, zero, flags,
                            p->next_packet_size);
         p->num_packets++;
         p->num_pages += used;
@@ -965,6 +1140,10 @@ static void *multifd_recv_thread(void *opaque)
             }
         }
 
+        if (zero) {
+            multifd_recv_zero_pages(p);
+        }
+
         if (flags & MULTIFD_FLAG_SYNC) {
             qemu_sem_post(&multifd_recv_state->sem_sync);
             qemu_sem_wait(&p->sem_sync);
@@ -32,6 +32,7 @@ int multifd_queue_page(QEMUFile *f, RAMBlock *block, ram_addr_t offset);
 #define MULTIFD_FLAG_NOCOMP (0 << 1)
 #define MULTIFD_FLAG_ZLIB (1 << 1)
 #define MULTIFD_FLAG_ZSTD (2 << 1)
+#define MULTIFD_FLAG_XBZRLE (3 << 1)
 
 /* This value needs to be a multiple of qemu_target_page_size() */
 #define MULTIFD_PACKET_SIZE (512 * 1024)
@@ -46,7 +47,10 @@ typedef struct {
     /* size of the next packet that contains pages */
     uint32_t next_packet_size;
     uint64_t packet_num;
-    uint64_t unused[4];    /* Reserved for future use */
+    /* number of zero pages, their offsets follow the used ones */
+    uint32_t zero_pages;
+    uint32_t unused32[1];    /* Reserved for future use */
+    uint64_t unused64[3];    /* Reserved for future use */
     char ramblock[256];
     uint64_t offset[];
 } __attribute__((packed)) MultiFDPacket_t;
@@ -62,6 +66,10 @@ typedef struct {
     ram_addr_t *offset;
     /* pointer to each page */
     struct iovec *iov;
+    /* number of zero pages */
+    uint32_t zero_num;
+    /* offset of each zero page */
+    ram_addr_t *zero_offset;
     RAMBlock *block;
 } MultiFDPages_t;
 
@@ -102,6 +110,10 @@ typedef struct {
     uint64_t num_packets;
     /* pages sent through this channel */
     uint64_t num_pages;
+    /* zero pages found since the migration thread last looked */
+    uint64_t zero_pages;
+    /* syncs at which the kernel copied some zero copy pages */
+    uint64_t zero_copy_missed;
     /* syncs main thread and channels */
     QemuSemaphore sem_sync;
     /* used for compression methods */
@@ -154,6 +166,8 @@ typedef struct {
     void (*send_cleanup)(MultiFDSendParams *p, Error **errp);
     /* Prepare the send packet */
     int (*send_prepare)(MultiFDSendParams *p, uint32_t used, Error **errp);
+    /* Note the zero pages of every packet, even one with no other page */
+    void (*send_zero_pages)(MultiFDSendParams *p);
     /* Write the send packet */
     int (*send_write)(MultiFDSendParams *p, uint32_t used, Error **errp);
     /* Setup for receiving side */
@@ -17,6 +17,8 @@
 #include "qapi/qmp/qerror.h"
 #include "qapi/error.h"
 #include "qemu/host-utils.h"
+#include "qemu/thread.h"
+#include "qemu/rcu.h"
 #include "page_cache.h"
 
 #ifdef DEBUG_CACHE
@@ -30,19 +32,40 @@
 /* the page in cache will not be replaced in two cycles */
 #define CACHED_PAGE_LIFETIME 2
 
+/* number of pages a page address can be cached in */
+#define CACHE_WAYS 8
+
+/* maximum number of separately locked groups of sets */
+#define CACHE_MAX_SHARDS 64
+
 typedef struct CacheItem CacheItem;
 
 struct CacheItem {
     uint64_t it_addr;
     uint64_t it_age;
+    /* number of times the page was found dirty again while cached */
+    uint64_t it_hits;
     uint8_t *it_data;
 };
 
+/*
+ * Each set is protected by the lock of its shard.  Neighbouring sets
+ * are in different shards, so that channels sending neighbouring
+ * pages don't contend.
+ */
+typedef struct CacheShard {
+    QemuMutex lock;
+} QEMU_ALIGNED(64) CacheShard;
+
 struct PageCache {
+    struct rcu_head rcu;
     CacheItem *page_cache;
+    CacheShard *shards;
     size_t page_size;
     size_t max_num_items;
-    size_t num_items;
+    size_t num_ways;
+    size_t num_sets;
+    size_t num_shards;
 };
 
 PageCache *cache_init(int64_t new_size, size_t page_size, Error **errp)
@@ -72,10 +95,13 @@ PageCache *cache_init(int64_t new_size, size_t page_size, Error **errp)
         return NULL;
     }
     cache->page_size = page_size;
-    cache->num_items = 0;
     cache->max_num_items = num_pages;
+    cache->num_ways = MIN(num_pages, CACHE_WAYS);
+    cache->num_sets = num_pages / cache->num_ways;
+    cache->num_shards = MIN(cache->num_sets, CACHE_MAX_SHARDS);
 
-    DPRINTF("Setting cache buckets to %" PRId64 "\n", cache->max_num_items);
+    DPRINTF("Setting cache buckets to %zu sets of %zu pages\n",
+            cache->num_sets, cache->num_ways);
 
     /* We prefer not to abort if there is no memory */
     cache->page_cache = g_try_malloc((cache->max_num_items) *
@@ -90,9 +116,15 @@ PageCache *cache_init(int64_t new_size, size_t page_size, Error **errp)
     for (i = 0; i < cache->max_num_items; i++) {
         cache->page_cache[i].it_data = NULL;
         cache->page_cache[i].it_age = 0;
+        cache->page_cache[i].it_hits = 0;
         cache->page_cache[i].it_addr = -1;
     }
 
+    cache->shards = g_new(CacheShard, cache->num_shards);
+    for (i = 0; i < cache->num_shards; i++) {
+        qemu_mutex_init(&cache->shards[i].lock);
+    }
+
     return cache;
 }
 
@@ -106,79 +138,181 @@ void cache_fini(PageCache *cache)
     for (i = 0; i < cache->max_num_items; i++) {
         g_free(cache->page_cache[i].it_data);
     }
+    for (i = 0; i < cache->num_shards; i++) {
+        qemu_mutex_destroy(&cache->shards[i].lock);
+    }
 
+    g_free(cache->shards);
     g_free(cache->page_cache);
     cache->page_cache = NULL;
     g_free(cache);
 }
 
-static size_t cache_get_cache_pos(const PageCache *cache,
+void cache_fini_rcu(PageCache *cache)
+{
+    call_rcu(cache, cache_fini, rcu);
+}
+
+static size_t cache_get_cache_set(const PageCache *cache,
                                   uint64_t address)
 {
-    g_assert(cache->max_num_items);
-    return (address / cache->page_size) & (cache->max_num_items - 1);
+    g_assert(cache->num_sets);
+    return (address / cache->page_size) & (cache->num_sets - 1);
 }
 
-static CacheItem *cache_get_by_addr(const PageCache *cache, uint64_t addr)
+static QemuMutex *cache_lock_set(const PageCache *cache, size_t set)
 {
-    size_t pos;
+    QemuMutex *lock = &cache->shards[set & (cache->num_shards - 1)].lock;
 
-    g_assert(cache);
-    g_assert(cache->page_cache);
+    qemu_mutex_lock(lock);
+    return lock;
+}
+
+/* Needs the lock of the set that contains @addr */
+static CacheItem *cache_get_by_addr(const PageCache *cache, size_t set,
+                                    uint64_t addr)
+{
+    CacheItem *it = &cache->page_cache[set * cache->num_ways];
+    size_t i;
+
+    for (i = 0; i < cache->num_ways; i++) {
+        if (it[i].it_addr == addr) {
+            return &it[i];
+        }
+    }
+    return NULL;
+}
+
+/* Needs the lock of the set that contains the item */
+static void cache_hit(CacheItem *it, uint64_t current_age)
+{
+    /* update the it_age when the cache hit */
+    it->it_age = current_age;
+    it->it_hits++;
+}
 
-    pos = cache_get_cache_pos(cache, addr);
+/*
+ * Pick the page of the set to replace with a new one, or NULL if all
+ * of them are still fresh.  Among the pages old enough to be replaced,
+ * the one that was dirtied again the least often goes first; the count
+ * is halved for every cycle the page was left alone, so that pages
+ * that stopped changing eventually make room.
+ *
+ * Needs the lock of @set.
+ */
+static CacheItem *cache_get_victim(const PageCache *cache, size_t set,
+                                   uint64_t current_age)
+{
+    CacheItem *it = &cache->page_cache[set * cache->num_ways];
+    CacheItem *victim = NULL;
+    uint64_t victim_score = 0;
+    size_t i;
+
+    for (i = 0; i < cache->num_ways; i++) {
+        uint64_t idle, score;
 
-    return &cache->page_cache[pos];
+        if (!it[i].it_data) {
+            return &it[i];
+        }
+        if (it[i].it_age + CACHED_PAGE_LIFETIME > current_age) {
+            /* the cache page is fresh, don't replace it */
+            continue;
+        }
+        idle = current_age - it[i].it_age;
+        score = idle < 64 ? it[i].it_hits >> idle : 0;
+        if (!victim || score < victim_score ||
+            (score == victim_score && it[i].it_age < victim->it_age)) {
+            victim = &it[i];
+            victim_score = score;
+        }
+    }
+    return victim;
 }
 
 uint8_t *get_cached_data(const PageCache *cache, uint64_t addr)
 {
-    return cache_get_by_addr(cache, addr)->it_data;
+    size_t set = cache_get_cache_set(cache, addr);
+    QemuMutex *lock = cache_lock_set(cache, set);
+    CacheItem *it = cache_get_by_addr(cache, set, addr);
+
+    qemu_mutex_unlock(lock);
+    return it ? it->it_data : NULL;
 }
 
 bool cache_is_cached(const PageCache *cache, uint64_t addr,
                      uint64_t current_age)
 {
-    CacheItem *it;
+    size_t set = cache_get_cache_set(cache, addr);
+    QemuMutex *lock = cache_lock_set(cache, set);
+    CacheItem *it = cache_get_by_addr(cache, set, addr);
+
+    if (it) {
+        cache_hit(it, current_age);
+    }
+    qemu_mutex_unlock(lock);
+    return it != NULL;
+}
+
+bool cache_lookup(const PageCache *cache, uint64_t addr, uint8_t *buf,
+                  uint64_t current_age)
+{
+    size_t set = cache_get_cache_set(cache, addr);
+    QemuMutex *lock = cache_lock_set(cache, set);
+    CacheItem *it = cache_get_by_addr(cache, set, addr);
+
+    if (it) {
+        cache_hit(it, current_age);
+        memcpy(buf, it->it_data, cache->page_size);
+    }
+    qemu_mutex_unlock(lock);
+    return it != NULL;
+}
 
-    it = cache_get_by_addr(cache, addr);
+bool cache_update(PageCache *cache, uint64_t addr, const uint8_t *pdata)
+{
+    size_t set = cache_get_cache_set(cache, addr);
+    QemuMutex *lock = cache_lock_set(cache, set);
+    CacheItem *it = cache_get_by_addr(cache, set, addr);
 
-    if (it->it_addr == addr) {
-        /* update the it_age when the cache hit */
-        it->it_age = current_age;
-        return true;
+    if (it) {
+        memcpy(it->it_data, pdata, cache->page_size);
     }
-    return false;
+    qemu_mutex_unlock(lock);
+    return it != NULL;
 }
 
 int cache_insert(PageCache *cache, uint64_t addr, const uint8_t *pdata,
                  uint64_t current_age)
 {
-
+    size_t set = cache_get_cache_set(cache, addr);
+    QemuMutex *lock = cache_lock_set(cache, set);
     CacheItem *it;
 
     /* actual update of entry */
-    it = cache_get_by_addr(cache, addr);
-
-    if (it->it_data && it->it_addr != addr &&
-        it->it_age + CACHED_PAGE_LIFETIME > current_age) {
-        /* the cache page is fresh, don't replace it */
-        return -1;
+    it = cache_get_by_addr(cache, set, addr);
+    if (!it) {
+        it = cache_get_victim(cache, set, current_age);
+        if (!it) {
+            qemu_mutex_unlock(lock);
+            return -1;
+        }
+        it->it_hits = 0;
     }
     /* allocate page */
     if (!it->it_data) {
         it->it_data = g_try_malloc(cache->page_size);
         if (!it->it_data) {
             DPRINTF("Error allocating page\n");
+            qemu_mutex_unlock(lock);
             return -1;
         }
-        cache->num_items++;
     }
 
     memcpy(it->it_data, pdata, cache->page_size);
 
     it->it_age = current_age;
     it->it_addr = addr;
+    qemu_mutex_unlock(lock);
 
     return 0;
 }
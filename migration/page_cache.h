@@ -15,7 +15,12 @@
 #ifndef PAGE_CACHE_H
 #define PAGE_CACHE_H
 
-/* Page cache for storing guest pages */
+/*
+ * Page cache for storing guest pages
+ *
+ * The cache is set associative, and every function takes the lock of
+ * the set it touches, so it can be used from several threads at once.
+ */
 typedef struct PageCache PageCache;
 
 /**
@@ -35,6 +40,12 @@ PageCache *cache_init(int64_t cache_size, size_t page_size, Error **errp);
  */
 void cache_fini(PageCache *cache);
 
+/**
+ * cache_fini_rcu: free all cache resources after an RCU grace period
+ * @cache pointer to the PageCache struct
+ */
+void cache_fini_rcu(PageCache *cache);
+
 /**
  * cache_is_cached: Checks to see if the page is cached
  *
@@ -52,15 +63,48 @@ bool cache_is_cached(const PageCache *cache, uint64_t addr,
  *
  * Returns pointer to the data cached or NULL if not cached
  *
+ * The page can be replaced by cache_insert() at any time, so this is
+ * only safe when nothing else is inserting pages into the cache; use
+ * cache_lookup() and cache_update() otherwise.
+ *
  * @cache pointer to the PageCache struct
  * @addr: page addr
  */
 uint8_t *get_cached_data(const PageCache *cache, uint64_t addr);
 
+/**
+ * cache_lookup: copy the data cached for an addr
+ *
+ * Returns %true if the page is cached and was copied to @buf
+ *
+ * @cache pointer to the PageCache struct
+ * @addr: page addr
+ * @buf: where to copy the page
+ * @current_age: current bitmap generation
+ */
+bool cache_lookup(const PageCache *cache, uint64_t addr, uint8_t *buf,
+                  uint64_t current_age);
+
+/**
+ * cache_update: overwrite the data cached for an addr
+ *
+ * Unlike cache_insert(), this does nothing if the page isn't cached.
+ *
+ * Returns %true if the page is cached and was updated
+ *
+ * @cache pointer to the PageCache struct
+ * @addr: page addr
+ * @pdata: pointer to the page
+ */
+bool cache_update(PageCache *cache, uint64_t addr, const uint8_t *pdata);
+
 /**
  * cache_insert: insert the page into the cache. the page cache
  * will dup the data on insert. the previous value will be overwritten
  *
+ * When the set is full, the page that was dirtied again the least
+ * often lately is replaced.
+ *
  * Returns -1 when the page isn't inserted into cache
  *
  * @cache pointer to the PageCache struct
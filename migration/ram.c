@@ -89,7 +89,10 @@ static struct {
     uint8_t *encoded_buf;
     /* buffer for storing page content */
     uint8_t *current_buf;
-    /* Cache for XBZRLE, Protected by lock. */
+    /*
+     * Cache for XBZRLE, Protected by lock.  The multifd channels only
+     * read the pointer, under RCU, and lock the cache sets themselves.
+     */
     PageCache *cache;
     QemuMutex lock;
     /* it will store a page full of zeros */
@@ -116,7 +119,9 @@ static void XBZRLE_cache_unlock(void)
  * This function is called from qmp_migrate_set_cache_size in main
  * thread, possibly while a migration is in progress.  A running
  * migration may be using the cache and might finish during this call,
- * hence changes to the cache are protected by XBZRLE.lock().
+ * hence changes to the cache are protected by XBZRLE.lock().  The
+ * multifd channels don't take the lock, so the old cache is only freed
+ * after an RCU grace period.
  *
  * Returns 0 for success or -1 for error
  *
@@ -143,14 +148,17 @@ int xbzrle_cache_resize(int64_t new_size, Error **errp)
     XBZRLE_cache_lock();
 
     if (XBZRLE.cache != NULL) {
+        PageCache *old_cache = XBZRLE.cache;
+
         new_cache = cache_init(new_size, TARGET_PAGE_SIZE, errp);
         if (!new_cache) {
             ret = -1;
             goto out;
         }
 
-        cache_fini(XBZRLE.cache);
-        XBZRLE.cache = new_cache;
+        /* Readers that see the old cache must be done before it is freed */
+        atomic_rcu_set(&XBZRLE.cache, new_cache);
+        cache_fini_rcu(old_cache);
     }
 out:
     XBZRLE_cache_unlock();
@@ -331,6 +339,8 @@ struct RAMState {
     uint64_t xbzrle_pages_prev;
     /* Amount of xbzrle encoded bytes since the beginning of the period */
     uint64_t xbzrle_bytes_prev;
+    /* xbzrle overflows since the beginning of the period */
+    uint64_t xbzrle_overflow_prev;
 
     /* compression statistics since the beginning of the period */
     /* amount of count that no free thread to compress data */
@@ -778,6 +788,125 @@ static int save_xbzrle_page(RAMState *rs, uint8_t **current_data,
     return 1;
 }
 
+/*
+ * XBZRLE for multifd
+ *
+ * The multifd channels encode pages without the cache lock.  They
+ * copy the cached page out, encode against the copy, and then store
+ * what they sent back into the cache.  A page is only ever in flight on
+ * one channel, because channels are synced with the dirty bitmap.
+ *
+ * The cache itself is only read under RCU, so that it is not freed by a
+ * resize or by the cleanup while a channel is using it.
+ */
+
+/*
+ * PageCache is opaque here, which atomic_rcu_read() can't cope with
+ * because it needs the pointed-to type to strip qualifiers.
+ */
+static PageCache *xbzrle_multifd_cache(void)
+{
+    PageCache *cache;
+
+    atomic_rcu_read__nocheck(&XBZRLE.cache, &cache);
+    return cache;
+}
+
+/**
+ * xbzrle_multifd_lookup: fetch the copy of a page the destination has
+ *
+ * Returns true if @old_buf was filled from the cache.  Otherwise the
+ * page is sent whole, so @current_buf is inserted in the cache.
+ *
+ * @block: block that contains the page
+ * @offset: offset inside the block for the page
+ * @current_buf: the contents of the page that will be sent
+ * @old_buf: where to copy the cached page
+ */
+bool xbzrle_multifd_lookup(RAMBlock *block, ram_addr_t offset,
+                           const uint8_t *current_buf, uint8_t *old_buf)
+{
+    ram_addr_t current_addr = block->offset + offset;
+    uint64_t age = ram_counters.dirty_sync_count;
+    PageCache *cache;
+
+    RCU_READ_LOCK_GUARD();
+    cache = xbzrle_multifd_cache();
+    if (!cache) {
+        /* the migration is being cleaned up */
+        return false;
+    }
+    if (cache_lookup(cache, current_addr, old_buf, age)) {
+        return true;
+    }
+    cache_insert(cache, current_addr, current_buf, age);
+    return false;
+}
+
+/**
+ * xbzrle_multifd_update: record a page encoded by a multifd channel
+ *
+ * Another channel may have evicted the page since the lookup, in which
+ * case there is nothing to update.
+ *
+ * @block: block that contains the page
+ * @offset: offset inside the block for the page
+ * @current_buf: the contents of the page that were sent
+ */
+void xbzrle_multifd_update(RAMBlock *block, ram_addr_t offset,
+                           const uint8_t *current_buf)
+{
+    PageCache *cache;
+
+    RCU_READ_LOCK_GUARD();
+    cache = xbzrle_multifd_cache();
+    if (cache) {
+        cache_update(cache, block->offset + offset, current_buf);
+    }
+}
+
+/**
+ * xbzrle_multifd_zero_page: record a zero page sent by a multifd channel
+ *
+ * Only pages already in the cache need updating, otherwise the next
+ * version of the page will be a cache miss anyway.
+ *
+ * @block: block that contains the page
+ * @offset: offset inside the block for the page
+ */
+void xbzrle_multifd_zero_page(RAMBlock *block, ram_addr_t offset)
+{
+    PageCache *cache;
+
+    RCU_READ_LOCK_GUARD();
+    cache = xbzrle_multifd_cache();
+    if (cache) {
+        cache_update(cache, block->offset + offset, XBZRLE.zero_target_page);
+    }
+}
+
+/**
+ * xbzrle_multifd_account: add up the XBZRLE work of a multifd packet
+ *
+ * The channels count their pages locally and add them once per packet,
+ * so that they don't contend on the counters.
+ *
+ * @pages: number of pages found in the cache
+ * @misses: number of pages not found in the cache
+ * @overflows: number of pages that did not encode in less than a page
+ * @bytes: number of bytes sent for the pages found in the cache
+ */
+void xbzrle_multifd_account(uint64_t pages, uint64_t misses,
+                            uint64_t overflows, uint64_t bytes)
+{
+    XBZRLE_cache_lock();
+    xbzrle_counters.pages += pages;
+    xbzrle_counters.cache_miss += misses;
+    xbzrle_counters.overflow += overflows;
+    xbzrle_counters.bytes += bytes;
+    XBZRLE_cache_unlock();
+}
+
 /**
  * migration_bitmap_find_dirty: find the next dirty page from start
  *
@@ -906,10 +1035,18 @@ static void migration_update_rates(RAMState *rs, int64_t end_time)
 
     if (migrate_use_xbzrle()) {
         double encoded_size, unencoded_size;
-
-        xbzrle_counters.cache_miss_rate = (double)(xbzrle_counters.cache_miss -
-            rs->xbzrle_cache_miss_prev) / page_count;
+        uint64_t hits = xbzrle_counters.pages - rs->xbzrle_pages_prev;
+        uint64_t misses = xbzrle_counters.cache_miss -
+                          rs->xbzrle_cache_miss_prev;
+        uint64_t overflows = xbzrle_counters.overflow -
+                             rs->xbzrle_overflow_prev;
+
+        xbzrle_counters.cache_miss_rate = (double)misses / page_count;
+        xbzrle_counters.cache_hit_rate = hits + misses ?
+            (double)hits / (hits + misses) : 0;
+        xbzrle_counters.overflow_rate = hits ? (double)overflows / hits : 0;
         rs->xbzrle_cache_miss_prev = xbzrle_counters.cache_miss;
+        rs->xbzrle_overflow_prev = xbzrle_counters.overflow;
         unencoded_size = (xbzrle_counters.pages - rs->xbzrle_pages_prev) *
                          TARGET_PAGE_SIZE;
         encoded_size = xbzrle_counters.bytes - rs->xbzrle_bytes_prev;
@@ -1667,6 +1804,15 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss,
         return 1;
     }
 
+    /*
+     * The multifd channels look for zero pages themselves, see
+     * multifd_send_zero_pages().
+     */
+    if (!save_page_use_compression(rs) && migrate_use_multifd()
+        && migrate_multifd_zero_pages() && !migration_in_postcopy()) {
+        return ram_save_multifd_page(rs, block, offset);
+    }
+
     res = save_zero_page(rs, block, offset);
     if (res > 0) {
         /* Must let xbzrle know, otherwise a previous (now 0'd) cached
@@ -1865,18 +2011,29 @@ static void ram_state_cleanup(RAMState **rsp)
 
 static void xbzrle_cleanup(void)
 {
+    PageCache *cache;
+
     XBZRLE_cache_lock();
-    if (XBZRLE.cache) {
-        cache_fini(XBZRLE.cache);
+    cache = XBZRLE.cache;
+    atomic_rcu_set(&XBZRLE.cache, NULL);
+    XBZRLE_cache_unlock();
+
+    if (cache) {
+        /*
+         * Wait for the multifd channels to be done with the cache and
+         * the zero page.  This must not hold the lock, which they take
+         * to account for their pages.
+         */
+        synchronize_rcu();
+
+        cache_fini(cache);
         g_free(XBZRLE.encoded_buf);
         g_free(XBZRLE.current_buf);
         g_free(XBZRLE.zero_target_page);
-        XBZRLE.cache = NULL;
         XBZRLE.encoded_buf = NULL;
         XBZRLE.current_buf = NULL;
         XBZRLE.zero_target_page = NULL;
     }
-    XBZRLE_cache_unlock();
 }
 
 static void ram_save_cleanup(void *opaque)
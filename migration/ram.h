@@ -38,6 +38,13 @@ extern XBZRLECacheStats xbzrle_counters;
 extern CompressionStats compression_counters;
 
 int xbzrle_cache_resize(int64_t new_size, Error **errp);
+bool xbzrle_multifd_lookup(RAMBlock *block, ram_addr_t offset,
+                           const uint8_t *current_buf, uint8_t *old_buf);
+void xbzrle_multifd_update(RAMBlock *block, ram_addr_t offset,
+                           const uint8_t *current_buf);
+void xbzrle_multifd_zero_page(RAMBlock *block, ram_addr_t offset);
+void xbzrle_multifd_account(uint64_t pages, uint64_t misses,
+                            uint64_t overflows, uint64_t bytes);
 uint64_t ram_bytes_remaining(void);
 uint64_t ram_bytes_total(void);
 
@@ -12,6 +12,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/host-utils.h"
 #include "xbzrle.h"
 
 /*
@@ -24,17 +25,14 @@
 
   length = uleb128 encoded integer
  */
-int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
-                         uint8_t *dst, int dlen)
+static int xbzrle_encode_int(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                             uint8_t *dst, int dlen)
 {
     uint32_t zrun_len = 0, nzrun_len = 0;
     int d = 0, i = 0;
     long res;
     uint8_t *nzrun_start = NULL;
 
-    g_assert(!(((uintptr_t)old_buf | (uintptr_t)new_buf | slen) %
-               sizeof(long)));
-
     while (i < slen) {
         /* overflow */
         if (d + 2 > dlen) {
@@ -126,6 +124,351 @@ int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
     return d;
 }
 
+#if defined(CONFIG_AVX512BW_OPT) || defined(CONFIG_AVX2_OPT) || \
+    defined(__SSE2__) || defined(__aarch64__)
+
+/*
+ * The vector encoders split the work in two.  First the ISA specific
+ * part compares a block of both pages into a bitmap with one bit per
+ * byte, set where the bytes are equal.  Then the runs are found with
+ * count-trailing-zeros on that bitmap, 64 bytes at a time, instead of
+ * being walked byte by byte.
+ */
+#define XBZRLE_BLOCK 4096
+
+typedef void XBZRLECompareFn(const uint8_t *old_buf, const uint8_t *new_buf,
+                             int len, uint64_t *eq);
+
+static int xbzrle_encode_runs(XBZRLECompareFn *compare,
+                              uint8_t *old_buf, uint8_t *new_buf, int slen,
+                              uint8_t *dst, int dlen)
+{
+    uint64_t eq[XBZRLE_BLOCK / 64];
+    uint32_t run_len = 0;
+    bool zrun = true;
+    int d = 0, nzrun_start = 0;
+    int off, w;
+
+    /* overflow */
+    if (slen && d + 2 > dlen) {
+        return -1;
+    }
+
+    for (off = 0; off < slen; off += XBZRLE_BLOCK) {
+        int len = MIN(XBZRLE_BLOCK, slen - off);
+
+        compare(old_buf + off, new_buf + off, len, eq);
+
+        for (w = 0; w < len / 64; w++) {
+            uint64_t mask = eq[w];
+            int k = 0;
+
+            /* the whole word continues the current run */
+            if (mask == (zrun ? -1ULL : 0)) {
+                run_len += 64;
+                continue;
+            }
+
+            while (k < 64) {
+                uint64_t ends = (zrun ? ~mask : mask) >> k;
+                int n;
+
+                if (!ends) {
+                    run_len += 64 - k;
+                    break;
+                }
+                n = ctz64(ends);
+                run_len += n;
+                k += n;
+
+                d += uleb128_encode_small(dst + d, run_len);
+                if (zrun) {
+                    nzrun_start = off + w * 64 + k;
+                } else {
+                    /* overflow */
+                    if (d + run_len > dlen) {
+                        return -1;
+                    }
+                    memcpy(dst + d, new_buf + nzrun_start, run_len);
+                    d += run_len;
+                }
+                /* overflow, there is always more to encode here */
+                if (d + 2 > dlen) {
+                    return -1;
+                }
+                zrun = !zrun;
+                run_len = 0;
+            }
+        }
+    }
+
+    if (zrun) {
+        /* buffer unchanged, otherwise skip last zero run */
+        return run_len == slen ? 0 : d;
+    }
+
+    d += uleb128_encode_small(dst + d, run_len);
+    /* overflow */
+    if (d + run_len > dlen) {
+        return -1;
+    }
+    memcpy(dst + d, new_buf + nzrun_start, run_len);
+    return d + run_len;
+}
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+
+static void xbzrle_compare_neon(const uint8_t *old_buf, const uint8_t *new_buf,
+                                int len, uint64_t *eq)
+{
+    static const uint8_t bits[16] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+    };
+    uint8x16_t weight = vld1q_u8(bits);
+    int i, j;
+
+    for (i = 0; i < len; i += 64) {
+        uint64_t mask = 0;
+
+        for (j = 0; j < 64; j += 16) {
+            uint8x16_t t = vandq_u8(vceqq_u8(vld1q_u8(old_buf + i + j),
+                                             vld1q_u8(new_buf + i + j)),
+                                    weight);
+
+            mask |= (uint64_t)vaddv_u8(vget_low_u8(t)) << j;
+            mask |= (uint64_t)vaddv_u8(vget_high_u8(t)) << (j + 8);
+        }
+        eq[i / 64] = mask;
+    }
+}
+
+static int xbzrle_encode_neon(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                              uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_runs(xbzrle_compare_neon, old_buf, new_buf, slen,
+                              dst, dlen);
+}
+#else /* x86 */
+
+/* Do not use push_options pragmas unnecessarily, see util/bufferiszero.c */
+#if defined(CONFIG_AVX512BW_OPT) || defined(CONFIG_AVX2_OPT)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+#include <emmintrin.h>
+
+static void xbzrle_compare_sse2(const uint8_t *old_buf, const uint8_t *new_buf,
+                                int len, uint64_t *eq)
+{
+    int i, j;
+
+    for (i = 0; i < len; i += 64) {
+        uint64_t mask = 0;
+
+        for (j = 0; j < 64; j += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(old_buf + i + j));
+            __m128i b = _mm_loadu_si128((const __m128i *)(new_buf + i + j));
+
+            mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))
+                    << j;
+        }
+        eq[i / 64] = mask;
+    }
+}
+
+static int xbzrle_encode_sse2(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                              uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_runs(xbzrle_compare_sse2, old_buf, new_buf, slen,
+                              dst, dlen);
+}
+#if defined(CONFIG_AVX512BW_OPT) || defined(CONFIG_AVX2_OPT)
+#pragma GCC pop_options
+#endif
+
+#ifdef CONFIG_AVX2_OPT
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#include <immintrin.h>
+
+static void xbzrle_compare_avx2(const uint8_t *old_buf, const uint8_t *new_buf,
+                                int len, uint64_t *eq)
+{
+    int i;
+
+    for (i = 0; i < len; i += 64) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(old_buf + i));
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(new_buf + i));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(old_buf + i + 32));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(new_buf + i + 32));
+        uint32_t lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a0, b0));
+        uint32_t hi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a1, b1));
+
+        eq[i / 64] = ((uint64_t)hi << 32) | lo;
+    }
+}
+
+static int xbzrle_encode_avx2(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                              uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_runs(xbzrle_compare_avx2, old_buf, new_buf, slen,
+                              dst, dlen);
+}
+#pragma GCC pop_options
+#endif /* CONFIG_AVX2_OPT */
+
+#ifdef CONFIG_AVX512BW_OPT
+#pragma GCC push_options
+#pragma GCC target("avx512bw")
+#include <immintrin.h>
+
+static void xbzrle_compare_avx512(const uint8_t *old_buf,
+                                  const uint8_t *new_buf,
+                                  int len, uint64_t *eq)
+{
+    int i;
+
+    for (i = 0; i < len; i += 64) {
+        __m512i a = _mm512_loadu_si512(old_buf + i);
+        __m512i b = _mm512_loadu_si512(new_buf + i);
+
+        eq[i / 64] = _mm512_cmpeq_epi8_mask(a, b);
+    }
+}
+
+static int xbzrle_encode_avx512(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                                uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_runs(xbzrle_compare_avx512, old_buf, new_buf, slen,
+                              dst, dlen);
+}
+#pragma GCC pop_options
+#endif /* CONFIG_AVX512BW_OPT */
+#endif /* x86 */
+
+/* As in util/bufferiszero.c, the most preferred ISA has the lowest bit.  */
+#define CACHE_AVX512BW 1
+#define CACHE_AVX2     2
+#define CACHE_SSE2     4
+#define CACHE_NEON     8
+
+#if defined(__aarch64__)
+# define INIT_CACHE CACHE_NEON
+# define INIT_ACCEL xbzrle_encode_neon
+#elif defined(CONFIG_AVX512BW_OPT) || defined(CONFIG_AVX2_OPT)
+# define INIT_CACHE 0
+# define INIT_ACCEL xbzrle_encode_int
+#else
+# define INIT_CACHE CACHE_SSE2
+# define INIT_ACCEL xbzrle_encode_sse2
+#endif
+
+static unsigned cpuid_cache = INIT_CACHE;
+static int (*encode_accel)(uint8_t *, uint8_t *, int, uint8_t *, int) =
+    INIT_ACCEL;
+
+static void init_accel(unsigned cache)
+{
+    int (*fn)(uint8_t *, uint8_t *, int, uint8_t *, int) = xbzrle_encode_int;
+
+#if defined(__aarch64__)
+    if (cache & CACHE_NEON) {
+        fn = xbzrle_encode_neon;
+    }
+#else
+    if (cache & CACHE_SSE2) {
+        fn = xbzrle_encode_sse2;
+    }
+#ifdef CONFIG_AVX2_OPT
+    if (cache & CACHE_AVX2) {
+        fn = xbzrle_encode_avx2;
+    }
+#endif
+#ifdef CONFIG_AVX512BW_OPT
+    if (cache & CACHE_AVX512BW) {
+        fn = xbzrle_encode_avx512;
+    }
+#endif
+#endif
+    encode_accel = fn;
+}
+
+#if defined(CONFIG_AVX512BW_OPT) || defined(CONFIG_AVX2_OPT)
+#include "qemu/cpuid.h"
+
+static void __attribute__((constructor)) init_cpuid_cache(void)
+{
+    int max = __get_cpuid_max(0, NULL);
+    int a, b, c, d;
+    unsigned cache = 0;
+
+    if (max >= 1) {
+        __cpuid(1, a, b, c, d);
+        if (d & bit_SSE2) {
+            cache |= CACHE_SSE2;
+        }
+
+        /* We must check that AVX is not just available, but usable.  */
+        if ((c & bit_OSXSAVE) && (c & bit_AVX) && max >= 7) {
+            int bv;
+            __asm("xgetbv" : "=a"(bv), "=d"(d) : "c"(0));
+            __cpuid_count(7, 0, a, b, c, d);
+            if ((bv & 0x6) == 0x6 && (b & bit_AVX2)) {
+                cache |= CACHE_AVX2;
+            }
+            /* See util/bufferiszero.c for the XCR0 bits in 0xe6.  */
+            if ((bv & 0xe6) == 0xe6 && (b & bit_AVX512F) &&
+                (b & bit_AVX512BW)) {
+                cache |= CACHE_AVX512BW;
+            }
+        }
+    }
+    cpuid_cache = cache;
+    init_accel(cache);
+}
+#endif /* CONFIG_AVX512BW_OPT || CONFIG_AVX2_OPT */
+
+bool test_xbzrle_encode_next_accel(void)
+{
+    /* If no bits set, we just tested xbzrle_encode_int, and there
+       are no more acceleration options to test.  */
+    if (cpuid_cache == 0) {
+        return false;
+    }
+    /* Disable the accelerator we used before and select a new one.  */
+    cpuid_cache &= cpuid_cache - 1;
+    init_accel(cpuid_cache);
+    return true;
+}
+
+static int select_accel_fn(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                           uint8_t *dst, int dlen)
+{
+    /* The vector encoders compare 64 bytes at a time */
+    if (likely(!(slen % 64))) {
+        return encode_accel(old_buf, new_buf, slen, dst, dlen);
+    }
+    return xbzrle_encode_int(old_buf, new_buf, slen, dst, dlen);
+}
+
+#else
+#define select_accel_fn  xbzrle_encode_int
+bool test_xbzrle_encode_next_accel(void)
+{
+    return false;
+}
+#endif
+
+int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                         uint8_t *dst, int dlen)
+{
+    g_assert(!(((uintptr_t)old_buf | (uintptr_t)new_buf | slen) %
+               sizeof(long)));
+
+    return select_accel_fn(old_buf, new_buf, slen, dst, dlen);
+}
+
 int xbzrle_decode_buffer(uint8_t *src, int slen, uint8_t *dst, int dlen)
 {
     int i = 0, d = 0;
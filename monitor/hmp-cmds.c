@@ -277,6 +277,10 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
             monitor_printf(mon, "dirty pages rate: %" PRIu64 " pages\n",
                            info->ram->dirty_pages_rate);
         }
+        if (info->ram->dirty_sync_missed_zero_copy) {
+            monitor_printf(mon, "zero-copy-send fallbacks: %" PRIu64 "\n",
+                           info->ram->dirty_sync_missed_zero_copy);
+        }
         if (info->ram->postcopy_requests) {
             monitor_printf(mon, "postcopy request count: %" PRIu64 "\n",
                            info->ram->postcopy_requests);
@@ -303,10 +307,14 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
                        info->xbzrle_cache->cache_miss);
         monitor_printf(mon, "xbzrle cache miss rate: %0.2f\n",
                        info->xbzrle_cache->cache_miss_rate);
+        monitor_printf(mon, "xbzrle cache hit rate: %0.2f\n",
+                       info->xbzrle_cache->cache_hit_rate);
         monitor_printf(mon, "xbzrle encoding rate: %0.2f\n",
                        info->xbzrle_cache->encoding_rate);
         monitor_printf(mon, "xbzrle overflow: %" PRIu64 "\n",
                        info->xbzrle_cache->overflow);
+        monitor_printf(mon, "xbzrle overflow rate: %0.2f\n",
+                       info->xbzrle_cache->overflow_rate);
     }
 
     if (info->has_compression) {
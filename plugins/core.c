@@ -266,7 +266,7 @@ static struct qemu_plugin_dyn_cb *plugin_get_dyn_cb(GArray **arr)
 void plugin_register_inline_op(GArray **arr,
                                enum qemu_plugin_mem_rw rw,
                                enum qemu_plugin_op op, void *ptr,
-                               uint64_t imm)
+                               size_t stride, uint64_t imm)
 {
     struct qemu_plugin_dyn_cb *dyn_cb;
 
@@ -276,6 +276,7 @@ void plugin_register_inline_op(GArray **arr,
     dyn_cb->rw = rw;
     dyn_cb->inline_insn.op = op;
     dyn_cb->inline_insn.imm = imm;
+    dyn_cb->inline_insn.stride = stride;
 }
 
 static inline uint32_t cb_to_tcg_flags(enum qemu_plugin_cb_flags flags)
@@ -309,6 +310,25 @@ plugin_register_dyn_cb__udata(GArray **arr,
     dyn_cb->type = PLUGIN_CB_REGULAR;
 }
 
+void plugin_register_dyn_cb__cond(GArray **arr,
+                                  qemu_plugin_vcpu_udata_cb_t cb,
+                                  enum qemu_plugin_cb_flags flags,
+                                  enum qemu_plugin_cond cond,
+                                  void *ptr, size_t stride, uint64_t imm,
+                                  void *udata)
+{
+    struct qemu_plugin_dyn_cb *dyn_cb = plugin_get_dyn_cb(arr);
+
+    dyn_cb->userp = udata;
+    dyn_cb->tcg_flags = cb_to_tcg_flags(flags);
+    dyn_cb->f.vcpu_udata = cb;
+    dyn_cb->type = PLUGIN_CB_COND;
+    dyn_cb->cond.cond = cond;
+    dyn_cb->cond.imm = imm;
+    dyn_cb->cond.ptr = ptr;
+    dyn_cb->cond.stride = stride;
+}
+
 void plugin_register_vcpu_mem_cb(GArray **arr,
                                  void *cb,
                                  enum qemu_plugin_cb_flags flags,
@@ -416,9 +436,10 @@ void qemu_plugin_flush_cb(void)
     plugin_cb__simple(QEMU_PLUGIN_EV_FLUSH);
 }
 
-void exec_inline_op(struct qemu_plugin_dyn_cb *cb)
+void exec_inline_op(struct qemu_plugin_dyn_cb *cb, unsigned int cpu_index)
 {
-    uint64_t *val = cb->userp;
+    uint64_t *val = (uint64_t *)((char *)cb->userp +
+                                 cpu_index * cb->inline_insn.stride);
 
     switch (cb->inline_insn.op) {
     case QEMU_PLUGIN_INLINE_ADD_U64:
@@ -450,7 +471,7 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr, uint32_t info)
             cb->f.vcpu_mem(cpu->cpu_index, info, vaddr, cb->userp);
             break;
         case PLUGIN_CB_INLINE:
-            exec_inline_op(cb);
+            exec_inline_op(cb, cpu->cpu_index);
             break;
         default:
             g_assert_not_reached();
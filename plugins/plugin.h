@@ -66,7 +66,7 @@ struct qemu_plugin_ctx *plugin_id_to_ctx_locked(qemu_plugin_id_t id);
 void plugin_register_inline_op(GArray **arr,
                                enum qemu_plugin_mem_rw rw,
                                enum qemu_plugin_op op, void *ptr,
-                               uint64_t imm);
+                               size_t stride, uint64_t imm);
 
 void plugin_reset_uninstall(qemu_plugin_id_t id,
                             qemu_plugin_simple_cb_t cb,
@@ -88,12 +88,19 @@ plugin_register_dyn_cb__udata(GArray **arr,
                               enum qemu_plugin_cb_flags flags, void *udata);
 
 
+void plugin_register_dyn_cb__cond(GArray **arr,
+                                  qemu_plugin_vcpu_udata_cb_t cb,
+                                  enum qemu_plugin_cb_flags flags,
+                                  enum qemu_plugin_cond cond,
+                                  void *ptr, size_t stride, uint64_t imm,
+                                  void *udata);
+
 void plugin_register_vcpu_mem_cb(GArray **arr,
                                  void *cb,
                                  enum qemu_plugin_cb_flags flags,
                                  enum qemu_plugin_mem_rw rw,
                                  void *udata);
 
-void exec_inline_op(struct qemu_plugin_dyn_cb *cb);
+void exec_inline_op(struct qemu_plugin_dyn_cb *cb, unsigned int cpu_index);
 
 #endif /* _PLUGIN_INTERNAL_H_ */
@@ -123,7 +123,9 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                igd-passthru=on|off (enable Xen integrated Intel graphics passthrough, default=off)\n"
     "                kernel-irqchip=on|off|split controls accelerated irqchip support (default=on)\n"
     "                kvm-shadow-mem=size of KVM shadow MMU in bytes\n"
+    "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                tb-jmp-cache-bits=n (log2 of TCG jump cache entries per vCPU)\n"
     "                thread=single|multi (enable multi-threaded TCG)\n", QEMU_ARCH_ALL)
 SRST
 ``-accel name[,prop=value[,...]]``
@@ -148,9 +150,25 @@ SRST
     ``kvm-shadow-mem=size``
         Defines the size of the KVM shadow MMU.
 
+    ``dirty-ring-size=n``
+        When the KVM accelerator is used, it controls the size of the
+        per-vCPU dirty page ring buffer (number of entries for each
+        vCPU).  It should be a power of two with a minimum value of
+        1024, and 4096 is a good starting point.  With the ring, the
+        cost of fetching the dirty log from KVM depends on the number
+        of pages dirtied instead of the size of the guest memory;
+        migration still scans its own dirty bitmap of the whole guest
+        memory at each sync.  Defaults to 0, which uses the dirty
+        bitmap.
+
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``tb-jmp-cache-bits=n``
+        Sets the per-vCPU TCG jump cache to 2^n entries (8 to 20,
+        default 12). Guests with a large hot code footprint may see
+        fewer jump cache misses in ``info jit`` with a bigger cache.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefor taking advantage of
@@ -18,6 +18,7 @@
 # define TARGET_VIRT_ADDR_SPACE_BITS 32 /* sv32 */
 #endif
 #define TARGET_PAGE_BITS 12 /* 4 KiB Pages */
-#define NB_MMU_MODES 4
+/* 4 privilege levels for each of the RISCV_TLB_ASID_SLOTS ASID slots */
+#define NB_MMU_MODES 16
 
 #endif
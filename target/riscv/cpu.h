@@ -21,6 +21,7 @@
 #define RISCV_CPU_H
 
 #include "hw/core/cpu.h"
+#include "hw/registerfields.h"
 #include "exec/cpu-defs.h"
 #include "fpu/softfloat-types.h"
 
@@ -63,6 +64,7 @@
 #define RVS RV('S')
 #define RVU RV('U')
 #define RVH RV('H')
+#define RVV RV('V')
 
 /* S extension denotes that Supervisor mode exists, however it is possible
    to have a core that support S mode but does not have an MMU and there
@@ -82,8 +84,39 @@ enum {
 #define TRANSLATE_SUCCESS 0
 #define MMU_USER_IDX 3
 
+/*
+ * The softmmu TLB is tagged by ASID: bits [1:0] of a mmu_idx hold the
+ * privilege level of the access and bits [3:2] the ASID slot that U- and
+ * S-mode translations were filled under.  M-mode always uses slot 0.
+ */
+#define RISCV_TLB_ASID_SLOTS 4
+#define MMU_IDX_PRIV_MASK    3
+#define MMU_IDX_SLOT_SHIFT   2
+
+/* Guest physical to host physical translations, see get_gstage_address() */
+#define RISCV_GSTAGE_CACHE_SIZE 64
+
+typedef struct RISCVGStageEntry {
+    target_ulong gpn;
+    target_ulong page_size;
+    hwaddr physical;
+    uint16_t vmid;
+    uint8_t prot;
+    bool mxr;
+    bool valid;
+} RISCVGStageEntry;
+
 #define MAX_RISCV_PMPS (16)
 
+#define RV_VLEN_MAX 256
+
+FIELD(VTYPE, VLMUL, 0, 3)
+FIELD(VTYPE, VSEW, 3, 3)
+FIELD(VTYPE, VTA, 6, 1)
+FIELD(VTYPE, VMA, 7, 1)
+FIELD(VTYPE, RESERVED, 8, sizeof(target_ulong) * 8 - 9)
+FIELD(VTYPE, VILL, sizeof(target_ulong) * 8 - 1, 1)
+
 typedef struct CPURISCVState CPURISCVState;
 
 #include "pmp.h"
@@ -91,6 +124,15 @@ typedef struct CPURISCVState CPURISCVState;
 struct CPURISCVState {
     target_ulong gpr[32];
     uint64_t fpr[32]; /* assume both F and D extensions */
+
+    /* vector coprocessor state. */
+    uint64_t vreg[32 * RV_VLEN_MAX / 64] QEMU_ALIGNED(16);
+    target_ulong vxrm;
+    target_ulong vxsat;
+    target_ulong vl;
+    target_ulong vstart;
+    target_ulong vtype;
+
     target_ulong pc;
     target_ulong load_res;
     target_ulong load_val;
@@ -185,6 +227,18 @@ struct CPURISCVState {
     target_ulong scounteren;
     target_ulong mcounteren;
 
+    /*
+     * Address space that owns each softmmu TLB slot, see
+     * riscv_cpu_switch_asid().  Virtualised address spaces are also tagged
+     * with the VMID so that V=0 and V=1 never share a slot.
+     */
+    uint64_t asid_slot_tag[RISCV_TLB_ASID_SLOTS];
+    uint32_t asid_slot_valid;
+    uint32_t asid_slot;
+    uint32_t asid_slot_next;
+
+    RISCVGStageEntry gstage_cache[RISCV_GSTAGE_CACHE_SIZE];
+
     target_ulong sscratch;
     target_ulong mscratch;
 
@@ -198,6 +252,13 @@ struct CPURISCVState {
 
     /* machine specific rdtime callback */
     uint64_t (*rdtime_fn)(void);
+    /*
+     * Lets translated code read time without calling rdtime_fn, see
+     * riscv_cpu_set_rdtime_scale().  Zero if the machine does not
+     * provide it.
+     */
+    uint32_t rdtime_ns_per_tick;
+    int64_t rdtime_offset;
 
     /* True if in debugger mode.  */
     bool debugger;
@@ -207,6 +268,17 @@ struct CPURISCVState {
 
     /* Fields from here on are preserved across CPU reset. */
     QEMUTimer *timer; /* Internal timer */
+
+    /* KVM guest entry, set up by the machine as there is no firmware */
+    target_ulong kernel_addr;
+    target_ulong fdt_addr;
+
+    /* KVM timer, saved while the VM is stopped */
+    bool kvm_timer_dirty;
+    uint64_t kvm_timer_time;
+    uint64_t kvm_timer_compare;
+    uint64_t kvm_timer_state;
+    uint64_t kvm_timer_frequency;
 };
 
 #define RISCV_CPU_CLASS(klass) \
@@ -257,12 +329,15 @@ typedef struct RISCVCPU {
         bool ext_s;
         bool ext_u;
         bool ext_h;
+        bool ext_v;
         bool ext_counters;
         bool ext_ifencei;
         bool ext_icsr;
 
         char *priv_spec;
         char *user_spec;
+        uint16_t vlen;
+        uint16_t elen;
         bool mmu;
         bool pmp;
     } cfg;
@@ -291,6 +366,7 @@ int riscv_cpu_gdb_read_register(CPUState *cpu, GByteArray *buf, int reg);
 int riscv_cpu_gdb_write_register(CPUState *cpu, uint8_t *buf, int reg);
 bool riscv_cpu_exec_interrupt(CPUState *cs, int interrupt_request);
 bool riscv_cpu_fp_enabled(CPURISCVState *env);
+bool riscv_cpu_vector_enabled(CPURISCVState *env);
 bool riscv_cpu_virt_enabled(CPURISCVState *env);
 void riscv_cpu_set_virt_enabled(CPURISCVState *env, bool enable);
 bool riscv_cpu_force_hs_excep_enabled(CPURISCVState *env);
@@ -321,6 +397,14 @@ int riscv_cpu_claim_interrupts(RISCVCPU *cpu, uint32_t interrupts);
 uint32_t riscv_cpu_update_mip(RISCVCPU *cpu, uint32_t mask, uint32_t value);
 #define BOOL_TO_MASK(x) (-!!(x)) /* helper for riscv_cpu_update_mip value */
 void riscv_cpu_set_rdtime_fn(CPURISCVState *env, uint64_t (*fn)(void));
+void riscv_cpu_set_rdtime_scale(CPURISCVState *env, uint32_t ns_per_tick,
+                                int64_t offset);
+void riscv_cpu_reset_asid_slots(CPURISCVState *env);
+void riscv_cpu_switch_asid(CPURISCVState *env, target_ulong asid);
+void riscv_cpu_flush_asid(CPURISCVState *env, target_ulong asid);
+void riscv_cpu_flush_page_asid(CPURISCVState *env, target_ulong addr,
+                               target_ulong asid);
+void riscv_cpu_flush_gstage_cache(CPURISCVState *env);
 #endif
 void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv);
 
@@ -331,23 +415,76 @@ void QEMU_NORETURN riscv_raise_exception(CPURISCVState *env,
 
 target_ulong riscv_cpu_get_fflags(CPURISCVState *env);
 void riscv_cpu_set_fflags(CPURISCVState *env, target_ulong);
+void riscv_cpu_set_frm(CPURISCVState *env, target_ulong frm);
+
+typedef CPURISCVState CPUArchState;
+typedef RISCVCPU ArchCPU;
+
+#include "exec/cpu-all.h"
 
-#define TB_FLAGS_MMU_MASK   3
+#define TB_FLAGS_MMU_MASK   15
+/* The privilege level is held in the low bits of the mmu index */
+#define TB_FLAGS_PRIV_MMU_MASK  3
+#define TB_FLAGS_MSTATUS_VS MSTATUS_VS
 #define TB_FLAGS_MSTATUS_FS MSTATUS_FS
 
+/* The vector configuration is constant for a TB, see vsetvl */
+FIELD(TB_FLAGS, VL_EQ_VLMAX, 16, 1)
+FIELD(TB_FLAGS, LMUL, 17, 2)
+FIELD(TB_FLAGS, SEW, 19, 3)
+FIELD(TB_FLAGS, VILL, 22, 1)
+/* The dynamic rounding mode, so that translation can resolve rm = dyn */
+FIELD(TB_FLAGS, FRM, 23, 3)
+
+/*
+ * Number of elements in a register group for the given vtype.  Only
+ * integral LMUL settings are accepted by vsetvl.
+ */
+static inline uint32_t vext_get_vlmax(RISCVCPU *cpu, target_ulong vtype)
+{
+    uint8_t sew = FIELD_EX64(vtype, VTYPE, VSEW);
+    uint8_t lmul = FIELD_EX64(vtype, VTYPE, VLMUL);
+
+    return cpu->cfg.vlen >> (sew + 3 - lmul);
+}
+
 static inline void cpu_get_tb_cpu_state(CPURISCVState *env, target_ulong *pc,
-                                        target_ulong *cs_base, uint32_t *flags)
+                                        target_ulong *cs_base, uint32_t *pflags)
 {
+    uint32_t flags = 0;
+
     *pc = env->pc;
     *cs_base = 0;
+
+    if (riscv_has_ext(env, RVV)) {
+        uint32_t vlmax = vext_get_vlmax(env_archcpu(env), env->vtype);
+        bool vl_eq_vlmax = (env->vstart == 0) && (vlmax == env->vl);
+
+        flags = FIELD_DP32(flags, TB_FLAGS, VILL,
+                           FIELD_EX64(env->vtype, VTYPE, VILL));
+        flags = FIELD_DP32(flags, TB_FLAGS, SEW,
+                           FIELD_EX64(env->vtype, VTYPE, VSEW));
+        flags = FIELD_DP32(flags, TB_FLAGS, LMUL,
+                           FIELD_EX64(env->vtype, VTYPE, VLMUL));
+        flags = FIELD_DP32(flags, TB_FLAGS, VL_EQ_VLMAX, vl_eq_vlmax);
+    } else {
+        flags = FIELD_DP32(flags, TB_FLAGS, VILL, 1);
+    }
+
 #ifdef CONFIG_USER_ONLY
-    *flags = TB_FLAGS_MSTATUS_FS;
+    flags |= TB_FLAGS_MSTATUS_FS | TB_FLAGS_MSTATUS_VS;
+    flags = FIELD_DP32(flags, TB_FLAGS, FRM, env->frm);
 #else
-    *flags = cpu_mmu_index(env, 0);
+    flags |= cpu_mmu_index(env, 0);
     if (riscv_cpu_fp_enabled(env)) {
-        *flags |= env->mstatus & MSTATUS_FS;
+        flags |= env->mstatus & MSTATUS_FS;
+        flags = FIELD_DP32(flags, TB_FLAGS, FRM, env->frm);
+    }
+    if (riscv_cpu_vector_enabled(env)) {
+        flags |= env->mstatus & MSTATUS_VS;
     }
 #endif
+    *pflags = flags;
 }
 
 int riscv_csrrw(CPURISCVState *env, int csrno, target_ulong *ret_value,
@@ -388,9 +525,4 @@ void riscv_set_csr_ops(int csrno, riscv_csr_operations *ops);
 
 void riscv_cpu_register_gdb_regs_for_features(CPUState *cs);
 
-typedef CPURISCVState CPUArchState;
-typedef RISCVCPU ArchCPU;
-
-#include "exec/cpu-all.h"
-
 #endif /* RISCV_CPU_H */
@@ -23,6 +23,8 @@
 #include "cpu.h"
 #include "exec/exec-all.h"
 #include "tcg/tcg-op.h"
+#include "sysemu/kvm.h"
+#include "kvm_riscv.h"
 #include "trace.h"
 
 int riscv_cpu_mmu_index(CPURISCVState *env, bool ifetch)
@@ -30,7 +32,10 @@ int riscv_cpu_mmu_index(CPURISCVState *env, bool ifetch)
 #ifdef CONFIG_USER_ONLY
     return 0;
 #else
-    return env->priv;
+    if (env->priv == PRV_M) {
+        return PRV_M;
+    }
+    return (env->asid_slot << MMU_IDX_SLOT_SHIFT) | env->priv;
 #endif
 }
 
@@ -108,9 +113,23 @@ bool riscv_cpu_fp_enabled(CPURISCVState *env)
     return false;
 }
 
+/* Return true is vector support is currently enabled */
+bool riscv_cpu_vector_enabled(CPURISCVState *env)
+{
+    if (env->mstatus & MSTATUS_VS) {
+        if (riscv_cpu_virt_enabled(env) && !(env->mstatus_hs & MSTATUS_VS)) {
+            return false;
+        }
+        return true;
+    }
+
+    return false;
+}
+
 void riscv_cpu_swap_hypervisor_regs(CPURISCVState *env)
 {
     target_ulong mstatus_mask = MSTATUS_MXR | MSTATUS_SUM | MSTATUS_FS |
+                                MSTATUS_VS |
                                 MSTATUS_SPP | MSTATUS_SPIE | MSTATUS_SIE;
     bool current_virt = riscv_cpu_virt_enabled(env);
 
@@ -194,12 +213,17 @@ void riscv_cpu_set_virt_enabled(CPURISCVState *env, bool enable)
         return;
     }
 
-    /* Flush the TLB on all virt mode changes. */
-    if (get_field(env->virt, VIRT_ONOFF) != enable) {
-        tlb_flush(env_cpu(env));
+    if (get_field(env->virt, VIRT_ONOFF) == enable) {
+        return;
     }
 
+    /*
+     * The hypervisor registers have already been swapped, so satp now
+     * holds the address space we are entering.  It is tagged with the
+     * virt mode, so this selects its TLB slot rather than flushing.
+     */
     env->virt = set_field(env->virt, VIRT_ONOFF, enable);
+    riscv_cpu_switch_asid(env, get_field(env->satp, SATP_ASID));
 }
 
 bool riscv_cpu_force_hs_excep_enabled(CPURISCVState *env)
@@ -245,6 +269,17 @@ uint32_t riscv_cpu_update_mip(RISCVCPU *cpu, uint32_t mask, uint32_t value)
 
     env->mip = (env->mip & ~mask) | (value & mask);
 
+    if (kvm_enabled()) {
+        /* The kernel owns everything but the external interrupt */
+        if (mask & MIP_SEIP) {
+            kvm_riscv_set_irq(cpu, IRQ_S_EXT, !!(value & MIP_SEIP));
+        }
+        if (locked) {
+            qemu_mutex_unlock_iothread();
+        }
+        return old;
+    }
+
     if (env->mip) {
         cpu_interrupt(cs, CPU_INTERRUPT_HARD);
     } else {
@@ -263,6 +298,152 @@ void riscv_cpu_set_rdtime_fn(CPURISCVState *env, uint64_t (*fn)(void))
     env->rdtime_fn = fn;
 }
 
+/*
+ * Like the vDSO data page of a Linux guest: while the VM runs, time is
+ * (get_clock() + offset) / ns_per_tick, which translated code computes
+ * with helper_rdtime() instead of calling rdtime_fn.  The machine has
+ * to update @offset whenever the VM is started, before the hart runs.
+ */
+void riscv_cpu_set_rdtime_scale(CPURISCVState *env, uint32_t ns_per_tick,
+                                int64_t offset)
+{
+    env->rdtime_ns_per_tick = ns_per_tick;
+    env->rdtime_offset = offset;
+}
+
+/*
+ * ASID-tagged TLB
+ *
+ * U- and S-mode translations are filled into one of RISCV_TLB_ASID_SLOTS
+ * groups of mmu indexes.  Each slot remembers the ASID it was allocated
+ * for, so switching satp back to an address space that still owns a slot
+ * just selects that slot instead of flushing the whole TLB.  M-mode
+ * accesses with MPRV set go through the current satp, so the M-mode index
+ * is flushed on every switch.
+ *
+ * With the H extension a VS-mode address space is identified by both its
+ * ASID and the VMID in hgatp, and entering or leaving virt mode is just
+ * another address space switch.
+ */
+#define RISCV_ASID_TAG_VIRT     (1ULL << 63)
+#define RISCV_ASID_TAG_VMID_SHIFT 32
+
+static uint64_t riscv_asid_tag(CPURISCVState *env, target_ulong asid)
+{
+    if (riscv_cpu_virt_enabled(env)) {
+        return RISCV_ASID_TAG_VIRT |
+               ((uint64_t)get_field(env->hgatp, HGATP_VMID) <<
+                RISCV_ASID_TAG_VMID_SHIFT) | asid;
+    }
+    return asid;
+}
+
+static uint16_t riscv_asid_slot_idxmap(int slot)
+{
+    return (1 << ((slot << MMU_IDX_SLOT_SHIFT) | PRV_U)) |
+           (1 << ((slot << MMU_IDX_SLOT_SHIFT) | PRV_S));
+}
+
+static int riscv_cpu_find_asid_slot(CPURISCVState *env, target_ulong asid)
+{
+    uint64_t tag = riscv_asid_tag(env, asid);
+    int slot;
+
+    for (slot = 0; slot < RISCV_TLB_ASID_SLOTS; slot++) {
+        if ((env->asid_slot_valid & (1 << slot)) &&
+            env->asid_slot_tag[slot] == tag) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+/* Forget all slot assignments; the caller must have flushed the TLB. */
+void riscv_cpu_reset_asid_slots(CPURISCVState *env)
+{
+    env->asid_slot = 0;
+    env->asid_slot_next = 1;
+    env->asid_slot_valid = 1;
+    env->asid_slot_tag[0] = riscv_asid_tag(env,
+                                           get_field(env->satp, SATP_ASID));
+    riscv_cpu_flush_gstage_cache(env);
+}
+
+void riscv_cpu_switch_asid(CPURISCVState *env, target_ulong asid)
+{
+    uint16_t idxmap = 1 << PRV_M;
+    int slot = riscv_cpu_find_asid_slot(env, asid);
+
+    if (slot < 0) {
+        /* Evict round-robin, but never the address space we are leaving */
+        slot = env->asid_slot_next;
+        if (slot == env->asid_slot) {
+            slot = (slot + 1) % RISCV_TLB_ASID_SLOTS;
+        }
+        env->asid_slot_next = (slot + 1) % RISCV_TLB_ASID_SLOTS;
+        env->asid_slot_tag[slot] = riscv_asid_tag(env, asid);
+        env->asid_slot_valid |= 1 << slot;
+        idxmap |= riscv_asid_slot_idxmap(slot);
+    }
+
+    env->asid_slot = slot;
+    tlb_flush_by_mmuidx(env_cpu(env), idxmap);
+}
+
+/* sfence.vma with rs1 == x0 and rs2 != x0 */
+void riscv_cpu_flush_asid(CPURISCVState *env, target_ulong asid)
+{
+    int slot = riscv_cpu_find_asid_slot(env, asid);
+
+    if (slot < 0) {
+        return;
+    }
+    if (slot == env->asid_slot) {
+        tlb_flush_by_mmuidx(env_cpu(env),
+                            riscv_asid_slot_idxmap(slot) | (1 << PRV_M));
+    } else {
+        tlb_flush_by_mmuidx(env_cpu(env), riscv_asid_slot_idxmap(slot));
+    }
+}
+
+/* sfence.vma with rs1 != x0 and rs2 != x0 */
+void riscv_cpu_flush_page_asid(CPURISCVState *env, target_ulong addr,
+                               target_ulong asid)
+{
+    int slot = riscv_cpu_find_asid_slot(env, asid);
+    uint16_t idxmap;
+
+    if (slot < 0) {
+        return;
+    }
+    idxmap = riscv_asid_slot_idxmap(slot);
+    if (slot == env->asid_slot) {
+        idxmap |= 1 << PRV_M;
+    }
+    tlb_flush_page_by_mmuidx(env_cpu(env), addr, idxmap);
+}
+
+/*
+ * G-stage translation cache
+ *
+ * A VS-stage walk needs a full G-stage walk for the guest physical address
+ * of every PTE it reads, and another for the final address.  Remember the
+ * result of recent G-stage walks, tagged by VMID, so that walks touching
+ * the same guest page tables only pay for the first-stage PTE loads.
+ * Entries are dropped by hfence.gvma, by PMP changes and by hgatp writes
+ * that change the mode or the root page table.
+ */
+void riscv_cpu_flush_gstage_cache(CPURISCVState *env)
+{
+    memset(env->gstage_cache, 0, sizeof(env->gstage_cache));
+}
+
+static RISCVGStageEntry *riscv_gstage_entry(CPURISCVState *env,
+                                            target_ulong gpn)
+{
+    return &env->gstage_cache[gpn % RISCV_GSTAGE_CACHE_SIZE];
+}
+
 void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv)
 {
     if (newpriv > PRV_M) {
@@ -285,6 +466,10 @@ void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv)
     env->load_res = -1;
 }
 
+static int get_gstage_address(CPURISCVState *env, hwaddr *physical,
+                              int *prot, target_ulong *page_size,
+                              hwaddr addr, int access_type, int mmu_idx);
+
 /* get_physical_address - get the physical address for this virtual address
  *
  * Do a page table walk to obtain the physical address corresponding to a
@@ -295,15 +480,17 @@ void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv)
  * @env: CPURISCVState
  * @physical: This will be set to the calculated physical address
  * @prot: The returned protection attributes
+ * @page_size: The size of the page mapping @addr
  * @addr: The virtual address to be translated
  * @access_type: The type of MMU access
- * @mmu_idx: Indicates current privilege level
+ * @mmu_idx: Indicates current privilege level and ASID slot
  * @first_stage: Are we in first stage translation?
  *               Second stage is used for hypervisor guest translation
  * @two_stage: Are we going to perform two stage translation
  */
 static int get_physical_address(CPURISCVState *env, hwaddr *physical,
-                                int *prot, target_ulong addr,
+                                int *prot, target_ulong *page_size,
+                                target_ulong addr,
                                 int access_type, int mmu_idx,
                                 bool first_stage, bool two_stage)
 {
@@ -312,9 +499,11 @@ static int get_physical_address(CPURISCVState *env, hwaddr *physical,
      * (riscv_cpu_do_interrupt) is correct */
     MemTxResult res;
     MemTxAttrs attrs = MEMTXATTRS_UNSPECIFIED;
-    int mode = mmu_idx;
+    int mode = mmu_idx & MMU_IDX_PRIV_MASK;
     bool use_background = false;
 
+    *page_size = TARGET_PAGE_SIZE;
+
     /*
      * Check if we should use the background registers for the two
      * stage translation. We don't need to check if we actually need
@@ -432,12 +621,13 @@ restart:
 
         if (two_stage && first_stage) {
             int vbase_prot;
+            target_ulong vbase_size;
             hwaddr vbase;
 
             /* Do the second stage translation on the base PTE address. */
-            int vbase_ret = get_physical_address(env, &vbase, &vbase_prot,
-                                                 base, MMU_DATA_LOAD,
-                                                 mmu_idx, false, true);
+            int vbase_ret = get_gstage_address(env, &vbase, &vbase_prot,
+                                               &vbase_size, base,
+                                               MMU_DATA_LOAD, mmu_idx);
 
             if (vbase_ret != TRANSLATE_SUCCESS) {
                 return vbase_ret;
@@ -544,6 +734,7 @@ restart:
                benefit. */
             target_ulong vpn = addr >> PGSHIFT;
             *physical = (ppn | (vpn & ((1L << ptshift) - 1))) << PGSHIFT;
+            *page_size = (target_ulong)1 << (PGSHIFT + ptshift);
 
             /* set permissions on the TLB entry */
             if ((pte & PTE_R) || ((pte & PTE_X) && mxr)) {
@@ -564,6 +755,47 @@ restart:
     return TRANSLATE_FAIL;
 }
 
+/*
+ * Second stage translation of a guest physical address, going through the
+ * G-stage translation cache.  The cached permissions were computed for the
+ * access that filled the entry, so an access they do not allow (e.g. a
+ * store before the page is dirty) does the walk again.
+ */
+static int get_gstage_address(CPURISCVState *env, hwaddr *physical,
+                              int *prot, target_ulong *page_size,
+                              hwaddr addr, int access_type, int mmu_idx)
+{
+    target_ulong gpn = addr >> PGSHIFT;
+    uint16_t vmid = get_field(env->hgatp, HGATP_VMID);
+    bool mxr = get_field(env->vsstatus, MSTATUS_MXR);
+    RISCVGStageEntry *e = riscv_gstage_entry(env, gpn);
+    int need = access_type == MMU_DATA_STORE ? PAGE_WRITE :
+               access_type == MMU_INST_FETCH ? PAGE_EXEC : PAGE_READ;
+    int ret;
+
+    if (e->valid && e->gpn == gpn && e->vmid == vmid && e->mxr == mxr &&
+        (e->prot & need)) {
+        *physical = e->physical;
+        *prot = e->prot;
+        *page_size = e->page_size;
+        return TRANSLATE_SUCCESS;
+    }
+
+    ret = get_physical_address(env, physical, prot, page_size, addr,
+                               access_type, mmu_idx, false, true);
+    if (ret == TRANSLATE_SUCCESS &&
+        get_field(env->hgatp, HGATP_MODE) != VM_1_10_MBARE) {
+        e->gpn = gpn;
+        e->vmid = vmid;
+        e->mxr = mxr;
+        e->physical = *physical;
+        e->prot = *prot;
+        e->page_size = *page_size;
+        e->valid = true;
+    }
+    return ret;
+}
+
 static void raise_mmu_exception(CPURISCVState *env, target_ulong address,
                                 MMUAccessType access_type, bool pmp_violation,
                                 bool first_stage)
@@ -615,17 +847,18 @@ hwaddr riscv_cpu_get_phys_page_debug(CPUState *cs, vaddr addr)
     RISCVCPU *cpu = RISCV_CPU(cs);
     CPURISCVState *env = &cpu->env;
     hwaddr phys_addr;
+    target_ulong page_size;
     int prot;
     int mmu_idx = cpu_mmu_index(&cpu->env, false);
 
-    if (get_physical_address(env, &phys_addr, &prot, addr, 0, mmu_idx,
-                             true, riscv_cpu_virt_enabled(env))) {
+    if (get_physical_address(env, &phys_addr, &prot, &page_size, addr, 0,
+                             mmu_idx, true, riscv_cpu_virt_enabled(env))) {
         return -1;
     }
 
     if (riscv_cpu_virt_enabled(env)) {
-        if (get_physical_address(env, &phys_addr, &prot, phys_addr,
-                                 0, mmu_idx, false, true)) {
+        if (get_physical_address(env, &phys_addr, &prot, &page_size,
+                                 phys_addr, 0, mmu_idx, false, true)) {
             return -1;
         }
     }
@@ -685,13 +918,14 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
 #ifndef CONFIG_USER_ONLY
     vaddr im_address;
     hwaddr pa = 0;
+    target_ulong page_size, page_size2;
     int prot, prot2;
     bool pmp_violation = false;
     bool m_mode_two_stage = false;
     bool hs_mode_two_stage = false;
     bool first_stage_error = true;
     int ret = TRANSLATE_FAIL;
-    int mode = mmu_idx;
+    int mode = mmu_idx & MMU_IDX_PRIV_MASK;
 
     env->guest_phys_fault_addr = 0;
 
@@ -723,8 +957,8 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
 
     if (riscv_cpu_virt_enabled(env) || m_mode_two_stage || hs_mode_two_stage) {
         /* Two stage lookup */
-        ret = get_physical_address(env, &pa, &prot, address, access_type,
-                                   mmu_idx, true, true);
+        ret = get_physical_address(env, &pa, &prot, &page_size, address,
+                                   access_type, mmu_idx, true, true);
 
         qemu_log_mask(CPU_LOG_MMU,
                       "%s 1st-stage address=%" VADDR_PRIx " ret %d physical "
@@ -735,8 +969,8 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
             /* Second stage lookup */
             im_address = pa;
 
-            ret = get_physical_address(env, &pa, &prot2, im_address,
-                                       access_type, mmu_idx, false, true);
+            ret = get_gstage_address(env, &pa, &prot2, &page_size2,
+                                     im_address, access_type, mmu_idx);
 
             qemu_log_mask(CPU_LOG_MMU,
                     "%s 2nd-stage address=%" VADDR_PRIx " ret %d physical "
@@ -744,6 +978,7 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
                     __func__, im_address, ret, pa, prot2);
 
             prot &= prot2;
+            page_size = MIN(page_size, page_size2);
 
             if (riscv_feature(env, RISCV_FEATURE_PMP) &&
                 (ret == TRANSLATE_SUCCESS) &&
@@ -764,8 +999,8 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
         }
     } else {
         /* Single stage lookup */
-        ret = get_physical_address(env, &pa, &prot, address, access_type,
-                                   mmu_idx, true, false);
+        ret = get_physical_address(env, &pa, &prot, &page_size, address,
+                                   access_type, mmu_idx, true, false);
 
         qemu_log_mask(CPU_LOG_MMU,
                       "%s address=%" VADDR_PRIx " ret %d physical "
@@ -783,8 +1018,22 @@ bool riscv_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
     }
 
     if (ret == TRANSLATE_SUCCESS) {
+        /*
+         * Cache the PMP permissions with the entry so that later accesses
+         * skip the check.  If they are not uniform across the page, the
+         * entry is only good for this one access.
+         */
+        if (riscv_feature(env, RISCV_FEATURE_PMP)) {
+            prot &= pmp_get_tlb_privs(env, pa, mode, &page_size);
+        }
+
+        /*
+         * Superpages are still entered one TARGET_PAGE at a time, but the
+         * real size lets sfence.vma on any address inside one flush them,
+         * and lets the other pages be filled without another walk.
+         */
         tlb_set_page(cs, address & TARGET_PAGE_MASK, pa & TARGET_PAGE_MASK,
-                     prot, mmu_idx, TARGET_PAGE_SIZE);
+                     prot, mmu_idx, page_size);
         return true;
     } else if (probe) {
         return false;
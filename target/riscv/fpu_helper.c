@@ -50,36 +50,65 @@ void riscv_cpu_set_fflags(CPURISCVState *env, target_ulong hard)
     set_float_exception_flags(soft, &env->fp_status);
 }
 
-void helper_set_rounding_mode(CPURISCVState *env, uint32_t rm)
+/* Return the softfloat rounding mode for RM, or -1 if it is reserved */
+static int riscv_softfloat_rm(uint32_t rm)
 {
-    int softrm;
-
-    if (rm == 7) {
-        rm = env->frm;
-    }
     switch (rm) {
     case 0:
-        softrm = float_round_nearest_even;
-        break;
+        return float_round_nearest_even;
     case 1:
-        softrm = float_round_to_zero;
-        break;
+        return float_round_to_zero;
     case 2:
-        softrm = float_round_down;
-        break;
+        return float_round_down;
     case 3:
-        softrm = float_round_up;
-        break;
+        return float_round_up;
     case 4:
-        softrm = float_round_ties_away;
-        break;
+        return float_round_ties_away;
     default:
+        return -1;
+    }
+}
+
+/*
+ * Write frm.  fp_status holds the dynamic rounding mode whenever a TB
+ * is entered, so that translated code does not have to install it, see
+ * gen_set_rm() and gen_restore_rm().
+ */
+void riscv_cpu_set_frm(CPURISCVState *env, target_ulong frm)
+{
+    int softrm = riscv_softfloat_rm(frm);
+
+    env->frm = frm;
+    if (softrm >= 0) {
+        set_float_rounding_mode(softrm, &env->fp_status);
+    }
+}
+
+void helper_set_rounding_mode(CPURISCVState *env, uint32_t rm)
+{
+    int softrm;
+
+    if (rm == RISCV_FRM_DYN) {
+        rm = env->frm;
+    }
+    softrm = riscv_softfloat_rm(rm);
+    if (softrm < 0) {
         riscv_raise_exception(env, RISCV_EXCP_ILLEGAL_INST, GETPC());
     }
 
     set_float_rounding_mode(softrm, &env->fp_status);
 }
 
+/*
+ * Put back the dynamic rounding mode after instructions with a static
+ * one, before leaving the TB.  Unlike set_rounding_mode this must not
+ * raise: frm may have just been written with a reserved value.
+ */
+void helper_restore_rounding_mode(CPURISCVState *env)
+{
+    riscv_cpu_set_frm(env, env->frm);
+}
+
 uint64_t helper_fmadd_s(CPURISCVState *env, uint64_t frs1, uint64_t frs2,
                         uint64_t frs3)
 {
@@ -3,6 +3,7 @@ DEF_HELPER_2(raise_exception, noreturn, env, i32)
 
 /* Floating Point - rounding mode */
 DEF_HELPER_FLAGS_2(set_rounding_mode, TCG_CALL_NO_WG, void, env, i32)
+DEF_HELPER_FLAGS_1(restore_rounding_mode, TCG_CALL_NO_RWG, void, env)
 
 /* Floating Point - fused */
 DEF_HELPER_FLAGS_4(fmadd_s, TCG_CALL_NO_RWG, i64, env, i64, i64, i64)
@@ -66,18 +67,439 @@ DEF_HELPER_FLAGS_2(fcvt_d_lu, TCG_CALL_NO_RWG, i64, env, tl)
 #endif
 DEF_HELPER_FLAGS_1(fclass_d, TCG_CALL_NO_RWG_SE, tl, i64)
 
-/* Special functions */
-DEF_HELPER_3(csrrw, tl, env, tl, tl)
-DEF_HELPER_4(csrrs, tl, env, tl, tl, tl)
-DEF_HELPER_4(csrrc, tl, env, tl, tl, tl)
+/* Special functions; CSR accesses can raise illegal instruction */
+DEF_HELPER_FLAGS_3(csrrw, TCG_CALL_NO_WG, tl, env, tl, tl)
+DEF_HELPER_FLAGS_4(csrrs, TCG_CALL_NO_WG, tl, env, tl, tl, tl)
+DEF_HELPER_FLAGS_4(csrrc, TCG_CALL_NO_WG, tl, env, tl, tl, tl)
 #ifndef CONFIG_USER_ONLY
+/* Only used for reads of time that cannot trap */
+DEF_HELPER_FLAGS_1(rdtime, TCG_CALL_NO_RWG_SE, i64, env)
+/* sret and mret change the privilege level, which clears load_res */
 DEF_HELPER_2(sret, tl, env, tl)
 DEF_HELPER_2(mret, tl, env, tl)
-DEF_HELPER_1(wfi, void, env)
-DEF_HELPER_1(tlb_flush, void, env)
+/* The others can trap too, but none writes a TCG global */
+DEF_HELPER_FLAGS_1(wfi, TCG_CALL_NO_WG, void, env)
+DEF_HELPER_FLAGS_1(tlb_flush, TCG_CALL_NO_WG, void, env)
+DEF_HELPER_FLAGS_2(tlb_flush_asid, TCG_CALL_NO_WG, void, env, tl)
+DEF_HELPER_FLAGS_2(tlb_flush_page, TCG_CALL_NO_WG, void, env, tl)
+DEF_HELPER_FLAGS_3(tlb_flush_page_asid, TCG_CALL_NO_WG, void, env, tl, tl)
 #endif
 
 /* Hypervisor functions */
 #ifndef CONFIG_USER_ONLY
-DEF_HELPER_1(hyp_tlb_flush, void, env)
+DEF_HELPER_FLAGS_1(hyp_tlb_flush, TCG_CALL_NO_WG, void, env)
 #endif
+
+/*
+ * Vector functions
+ *
+ * None of these touch the TCG globals (gpr, fpr, pc, load_res/val).
+ * Loads and stores can fault, so the globals must be in sync for them.
+ */
+DEF_HELPER_FLAGS_3(vsetvl, TCG_CALL_NO_RWG, tl, env, tl, tl)
+DEF_HELPER_FLAGS_5(vle8_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vle16_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vle32_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vle64_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vse8_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vse16_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vse32_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_5(vse64_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_6(vlse8_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vlse16_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vlse32_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vlse64_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vsse8_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vsse16_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vsse32_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+DEF_HELPER_FLAGS_6(vsse64_v, TCG_CALL_NO_WG, void, ptr, ptr, tl, tl, env, i32)
+
+DEF_HELPER_FLAGS_6(vadd_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vadd_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vadd_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vadd_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsub_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vand_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vor_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vxor_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vminu_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmin_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmaxu_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmax_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmul_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsll_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsrl_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsra_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmseq_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsne_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsltu_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmslt_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsleu_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsle_vv_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vv_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vv_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vv_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vadd_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vadd_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vadd_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vadd_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsub_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsub_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vrsub_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vrsub_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vrsub_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vrsub_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vand_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vand_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vor_vx_b, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vx_h, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vx_w, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vor_vx_d, TCG_CALL_NO_RWG, void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vxor_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vxor_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vminu_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vminu_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmin_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmin_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmaxu_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmaxu_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmax_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmax_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmul_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmul_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsll_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsll_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsrl_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsrl_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vsra_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vsra_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmseq_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmseq_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsne_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsne_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsltu_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsltu_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmslt_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmslt_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsleu_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsleu_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsle_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsle_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsgtu_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgtu_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgtu_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgtu_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmsgt_vx_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgt_vx_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgt_vx_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmsgt_vx_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+
+DEF_HELPER_FLAGS_6(vmerge_vvm_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vvm_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vvm_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vvm_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vxm_b, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vxm_h, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vxm_w, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_6(vmerge_vxm_d, TCG_CALL_NO_RWG,
+                   void, ptr, ptr, tl, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_v_b, TCG_CALL_NO_RWG, void, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_v_h, TCG_CALL_NO_RWG, void, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_v_w, TCG_CALL_NO_RWG, void, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_v_d, TCG_CALL_NO_RWG, void, ptr, ptr, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_x_b, TCG_CALL_NO_RWG, void, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_x_h, TCG_CALL_NO_RWG, void, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_x_w, TCG_CALL_NO_RWG, void, ptr, tl, env, i32)
+DEF_HELPER_FLAGS_4(vmv_v_x_d, TCG_CALL_NO_RWG, void, ptr, tl, env, i32)
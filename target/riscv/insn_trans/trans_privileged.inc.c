@@ -75,6 +75,8 @@ static bool trans_wfi(DisasContext *ctx, arg_wfi *a)
 {
 #ifndef CONFIG_USER_ONLY
     tcg_gen_movi_tl(cpu_pc, ctx->pc_succ_insn);
+    /* helper_wfi leaves the TB without unwinding */
+    gen_restore_rm(ctx);
     gen_helper_wfi(cpu_env);
     return true;
 #else
@@ -85,7 +87,26 @@ static bool trans_wfi(DisasContext *ctx, arg_wfi *a)
 static bool trans_sfence_vma(DisasContext *ctx, arg_sfence_vma *a)
 {
 #ifndef CONFIG_USER_ONLY
-    gen_helper_tlb_flush(cpu_env);
+    TCGv addr, asid;
+
+    if (a->rs1 == 0 && a->rs2 == 0) {
+        gen_helper_tlb_flush(cpu_env);
+        return true;
+    }
+
+    addr = tcg_temp_new();
+    asid = tcg_temp_new();
+    gen_get_gpr(addr, a->rs1);
+    gen_get_gpr(asid, a->rs2);
+    if (a->rs1 == 0) {
+        gen_helper_tlb_flush_asid(cpu_env, asid);
+    } else if (a->rs2 == 0) {
+        gen_helper_tlb_flush_page(cpu_env, addr);
+    } else {
+        gen_helper_tlb_flush_page_asid(cpu_env, addr, asid);
+    }
+    tcg_temp_free(addr);
+    tcg_temp_free(asid);
     return true;
 #endif
     return false;
@@ -66,7 +66,10 @@ static bool trans_jalr(DisasContext *ctx, arg_jalr *a)
     if (a->rd != 0) {
         tcg_gen_movi_tl(cpu_gpr[a->rd], ctx->pc_succ_insn);
     }
-    lookup_and_goto_ptr(ctx);
+    if (is_link_reg(a->rd)) {
+        tcg_gen_push_return();
+    }
+    lookup_and_goto_ptr_jalr(ctx, a->rd, a->rs1);
 
     if (misaligned) {
         gen_set_label(misaligned);
@@ -498,6 +501,178 @@ static bool trans_fence_i(DisasContext *ctx, arg_fence_i *a)
     return true;
 }
 
+/*
+ * CSRs that are plain fields of CPURISCVState: reading and writing them
+ * has no side effects, and the only checks are the privilege level in
+ * the CSR number and the presence of the extension.  The privilege level
+ * is fixed for the TB, so accesses to these are emitted inline instead
+ * of going through riscv_csrrw().  Everything else, including the
+ * counters (icount, rdtime callback), stays in the helper.
+ */
+typedef struct {
+    int csrno;
+    uint32_t ext;
+    size_t offset;
+} RISCVPlainCSR;
+
+static const RISCVPlainCSR plain_csrs[] = {
+    { CSR_MSCRATCH, 0,   offsetof(CPURISCVState, mscratch) },
+    { CSR_MEPC,     0,   offsetof(CPURISCVState, mepc) },
+    { CSR_MCAUSE,   0,   offsetof(CPURISCVState, mcause) },
+    { CSR_MTVAL,    0,   offsetof(CPURISCVState, mbadaddr) },
+    { CSR_SSCRATCH, RVS, offsetof(CPURISCVState, sscratch) },
+    { CSR_SEPC,     RVS, offsetof(CPURISCVState, sepc) },
+    { CSR_SCAUSE,   RVS, offsetof(CPURISCVState, scause) },
+    { CSR_STVAL,    RVS, offsetof(CPURISCVState, sbadaddr) },
+};
+
+/*
+ * Emit an access to a plain CSR, returning false if CSRNO is not one or
+ * the access must be checked at run time.  OP combines the old value and
+ * SRC into the new one, with NULL meaning a plain write.
+ */
+static bool gen_csr_plain(DisasContext *ctx, int rd, int csrno, TCGv src,
+                          bool do_write,
+                          void (*op)(TCGv, TCGv, TCGv))
+{
+#ifdef CONFIG_USER_ONLY
+    return false;
+#else
+    const RISCVPlainCSR *csr = NULL;
+    TCGv old;
+    int i;
+
+    /*
+     * With the hypervisor extension the S-mode registers are swapped on
+     * virtualisation changes and HS-mode sees extra CSRs, so leave those
+     * checks to the helper.
+     */
+    if (!ctx->ext_icsr || has_ext(ctx, RVH)) {
+        return false;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(plain_csrs); i++) {
+        if (plain_csrs[i].csrno == csrno) {
+            csr = &plain_csrs[i];
+            break;
+        }
+    }
+    if (!csr || ctx->priv < get_field(csrno, 0x300) ||
+        (csr->ext && !has_ext(ctx, csr->ext))) {
+        return false;
+    }
+
+    old = tcg_temp_new();
+    tcg_gen_ld_tl(old, cpu_env, csr->offset);
+    if (do_write) {
+        if (op) {
+            TCGv val = tcg_temp_new();
+            op(val, old, src);
+            tcg_gen_st_tl(val, cpu_env, csr->offset);
+            tcg_temp_free(val);
+        } else {
+            tcg_gen_st_tl(src, cpu_env, csr->offset);
+        }
+    }
+    gen_set_gpr(rd, old);
+    tcg_temp_free(old);
+    return true;
+#endif
+}
+
+static bool gen_csr_plain_reg(DisasContext *ctx, int rd, int csrno, int rs1,
+                              bool do_write, void (*op)(TCGv, TCGv, TCGv))
+{
+    TCGv src = tcg_temp_new();
+    bool ret;
+
+    gen_get_gpr(src, rs1);
+    ret = gen_csr_plain(ctx, rd, csrno, src, do_write, op);
+    tcg_temp_free(src);
+    return ret;
+}
+
+static bool gen_csr_plain_imm(DisasContext *ctx, int rd, int csrno,
+                              target_ulong imm, bool do_write,
+                              void (*op)(TCGv, TCGv, TCGv))
+{
+    TCGv src = tcg_const_tl(imm);
+    bool ret;
+
+    ret = gen_csr_plain(ctx, rd, csrno, src, do_write, op);
+    tcg_temp_free(src);
+    return ret;
+}
+
+#ifndef CONFIG_USER_ONLY
+/* Read time with helper_rdtime(), which does not go through rdtime_fn */
+static void gen_rdtime(DisasContext *ctx, int rd, int csrno)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+    TCGv dest = tcg_temp_new();
+
+    gen_helper_rdtime(t, cpu_env);
+#if defined(TARGET_RISCV32)
+    if (csrno == CSR_TIMEH) {
+        tcg_gen_extrh_i64_i32(dest, t);
+    } else
+#endif
+    {
+        tcg_gen_trunc_i64_tl(dest, t);
+    }
+    gen_set_gpr(rd, dest);
+    tcg_temp_free_i64(t);
+    tcg_temp_free(dest);
+}
+#endif
+
+/*
+ * Reading a counter has no side effects, so unless icount needs the read
+ * to be at the end of the TB, call the helper without ending the TB.
+ * The helper still does the counteren checks, which depend on state that
+ * is not part of the TB flags.  Time is computed by a leaf helper from a
+ * scaled offset of the host clock if the machine provides one.
+ */
+static bool gen_csr_counter_read(DisasContext *ctx, int rd, int csrno)
+{
+    TCGv dest, csr, zero;
+
+    switch (csrno) {
+    case CSR_TIME:
+    case CSR_CYCLE:
+    case CSR_INSTRET:
+#if defined(TARGET_RISCV32)
+    case CSR_TIMEH:
+    case CSR_CYCLEH:
+    case CSR_INSTRETH:
+#endif
+        break;
+    default:
+        return false;
+    }
+
+    if (tb_cflags(ctx->base.tb) & CF_USE_ICOUNT) {
+        return false;
+    }
+
+#ifndef CONFIG_USER_ONLY
+    if (ctx->fast_rdtime && (csrno == CSR_TIME || csrno == CSR_TIMEH)) {
+        gen_rdtime(ctx, rd, csrno);
+        return true;
+    }
+#endif
+
+    dest = tcg_temp_new();
+    csr = tcg_const_tl(csrno);
+    zero = tcg_const_tl(0);
+    gen_helper_csrrs(dest, cpu_env, zero, csr, zero);
+    gen_set_gpr(rd, dest);
+    tcg_temp_free(dest);
+    tcg_temp_free(csr);
+    tcg_temp_free(zero);
+    return true;
+}
+
 #define RISCV_OP_CSR_PRE do {\
     source1 = tcg_temp_new(); \
     csr_store = tcg_temp_new(); \
@@ -525,6 +700,9 @@ static bool trans_fence_i(DisasContext *ctx, arg_fence_i *a)
 static bool trans_csrrw(DisasContext *ctx, arg_csrrw *a)
 {
     TCGv source1, csr_store, dest, rs1_pass;
+    if (gen_csr_plain_reg(ctx, a->rd, a->csr, a->rs1, true, NULL)) {
+        return true;
+    }
     RISCV_OP_CSR_PRE;
     gen_helper_csrrw(dest, cpu_env, source1, csr_store);
     RISCV_OP_CSR_POST;
@@ -534,6 +712,13 @@ static bool trans_csrrw(DisasContext *ctx, arg_csrrw *a)
 static bool trans_csrrs(DisasContext *ctx, arg_csrrs *a)
 {
     TCGv source1, csr_store, dest, rs1_pass;
+    if (a->rs1 == 0 && gen_csr_counter_read(ctx, a->rd, a->csr)) {
+        return true;
+    }
+    if (gen_csr_plain_reg(ctx, a->rd, a->csr, a->rs1, a->rs1 != 0,
+                          tcg_gen_or_tl)) {
+        return true;
+    }
     RISCV_OP_CSR_PRE;
     gen_helper_csrrs(dest, cpu_env, source1, csr_store, rs1_pass);
     RISCV_OP_CSR_POST;
@@ -543,6 +728,13 @@ static bool trans_csrrs(DisasContext *ctx, arg_csrrs *a)
 static bool trans_csrrc(DisasContext *ctx, arg_csrrc *a)
 {
     TCGv source1, csr_store, dest, rs1_pass;
+    if (a->rs1 == 0 && gen_csr_counter_read(ctx, a->rd, a->csr)) {
+        return true;
+    }
+    if (gen_csr_plain_reg(ctx, a->rd, a->csr, a->rs1, a->rs1 != 0,
+                          tcg_gen_andc_tl)) {
+        return true;
+    }
     RISCV_OP_CSR_PRE;
     gen_helper_csrrc(dest, cpu_env, source1, csr_store, rs1_pass);
     RISCV_OP_CSR_POST;
@@ -552,6 +744,9 @@ static bool trans_csrrc(DisasContext *ctx, arg_csrrc *a)
 static bool trans_csrrwi(DisasContext *ctx, arg_csrrwi *a)
 {
     TCGv source1, csr_store, dest, rs1_pass;
+    if (gen_csr_plain_imm(ctx, a->rd, a->csr, a->rs1, true, NULL)) {
+        return true;
+    }
     RISCV_OP_CSR_PRE;
     gen_helper_csrrw(dest, cpu_env, rs1_pass, csr_store);
     RISCV_OP_CSR_POST;
@@ -561,6 +756,13 @@ static bool trans_csrrwi(DisasContext *ctx, arg_csrrwi *a)
 static bool trans_csrrsi(DisasContext *ctx, arg_csrrsi *a)
 {
     TCGv source1, csr_store, dest, rs1_pass;
+    if (a->rs1 == 0 && gen_csr_counter_read(ctx, a->rd, a->csr)) {
+        return true;
+    }
+    if (gen_csr_plain_imm(ctx, a->rd, a->csr, a->rs1, a->rs1 != 0,
+                          tcg_gen_or_tl)) {
+        return true;
+    }
     RISCV_OP_CSR_PRE;
     gen_helper_csrrs(dest, cpu_env, rs1_pass, csr_store, rs1_pass);
     RISCV_OP_CSR_POST;
@@ -570,6 +772,13 @@ static bool trans_csrrsi(DisasContext *ctx, arg_csrrsi *a)
 static bool trans_csrrci(DisasContext *ctx, arg_csrrci *a)
 {
     TCGv source1, csr_store, dest, rs1_pass;
+    if (a->rs1 == 0 && gen_csr_counter_read(ctx, a->rd, a->csr)) {
+        return true;
+    }
+    if (gen_csr_plain_imm(ctx, a->rd, a->csr, a->rs1, a->rs1 != 0,
+                          tcg_gen_andc_tl)) {
+        return true;
+    }
     RISCV_OP_CSR_PRE;
     gen_helper_csrrc(dest, cpu_env, rs1_pass, csr_store, rs1_pass);
     RISCV_OP_CSR_POST;
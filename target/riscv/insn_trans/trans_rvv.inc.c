@@ -0,0 +1,769 @@
+/*
+ * RISC-V translation routines for the RVV Standard Extension.
+ *
+ * Copyright (c) 2020 SiFive, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 or later, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "tcg/tcg-op-gvec.h"
+#include "tcg/tcg-gvec-desc.h"
+
+/* Vector instructions require the V extension and mstatus.VS != Off */
+static bool require_rvv(DisasContext *s)
+{
+    return has_ext(s, RVV) && s->mstatus_vs != 0;
+}
+
+/* All but the vset{i}vl{i} instructions also require a legal vtype */
+static bool vext_check_isa_ill(DisasContext *s)
+{
+    return require_rvv(s) && !s->vill;
+}
+
+/* A register group of 1 << lmul registers must be aligned to its size */
+static bool vext_check_reg(uint32_t reg, uint32_t lmul)
+{
+    return extract32(reg, 0, lmul) == 0;
+}
+
+/*
+ * The destination of a masked instruction may not overlap the mask
+ * register v0, unless the destination itself is a mask.
+ */
+static bool vext_check_overlap_mask(uint32_t vd, bool vm)
+{
+    return vm || vd != 0;
+}
+
+/*
+ * A mask destination may only overlap the lowest-numbered register of
+ * a source register group.
+ */
+static bool vext_check_mask_dest(DisasContext *s, uint32_t vd, uint32_t vs)
+{
+    return vd <= vs || vd >= vs + (1 << s->lmul);
+}
+
+static uint32_t vreg_ofs(DisasContext *s, int reg)
+{
+    return offsetof(CPURISCVState, vreg) + reg * s->vlen / 8;
+}
+
+/* Offset of element IDX of the current SEW within register REG */
+static uint32_t endian_ofs(DisasContext *s, int reg, int idx)
+{
+#ifdef HOST_WORDS_BIGENDIAN
+    return vreg_ofs(s, reg) + ((idx ^ (7 >> s->sew)) << s->sew);
+#else
+    return vreg_ofs(s, reg) + (idx << s->sew);
+#endif
+}
+
+/* Size in bytes of a register group at the current LMUL */
+static uint32_t vext_maxsz(DisasContext *s)
+{
+    return (s->vlen / 8) << s->lmul;
+}
+
+static uint32_t vext_desc(DisasContext *s, bool vm)
+{
+    return simd_desc(s->vlen / 8, s->vlen / 8, FIELD_DP32(0, VDATA, VM, vm));
+}
+
+static void vext_clear_vstart(void)
+{
+    TCGv zero = tcg_const_tl(0);
+    tcg_gen_st_tl(zero, cpu_env, offsetof(CPURISCVState, vstart));
+    tcg_temp_free(zero);
+}
+
+/*
+ *** Configuration-Setting Instructions
+ */
+static bool do_vsetvl(DisasContext *ctx, int rd, TCGv s1, TCGv s2)
+{
+    TCGv dst = tcg_temp_new();
+
+    gen_helper_vsetvl(dst, cpu_env, s1, s2);
+    gen_set_gpr(rd, dst);
+    tcg_temp_free(dst);
+    mark_vs_dirty(ctx);
+
+    /* vl and vtype are part of the tb flags, so this TB must end here */
+    tcg_gen_movi_tl(cpu_pc, ctx->pc_succ_insn);
+    lookup_and_goto_ptr(ctx);
+    ctx->base.is_jmp = DISAS_NORETURN;
+    return true;
+}
+
+static void gen_get_avl(TCGv s1, int rd, int rs1)
+{
+    if (rs1 != 0) {
+        gen_get_gpr(s1, rs1);
+    } else if (rd != 0) {
+        /* Using x0 as the rs1 register specifier encodes an infinite AVL */
+        tcg_gen_movi_tl(s1, -1);
+    } else {
+        /* With rd also x0, the current vector length is kept */
+        tcg_gen_ld_tl(s1, cpu_env, offsetof(CPURISCVState, vl));
+    }
+}
+
+static bool trans_vsetvl(DisasContext *ctx, arg_vsetvl *a)
+{
+    TCGv s1, s2;
+
+    if (!require_rvv(ctx)) {
+        return false;
+    }
+
+    s1 = tcg_temp_new();
+    s2 = tcg_temp_new();
+    gen_get_avl(s1, a->rd, a->rs1);
+    gen_get_gpr(s2, a->rs2);
+    do_vsetvl(ctx, a->rd, s1, s2);
+    tcg_temp_free(s1);
+    tcg_temp_free(s2);
+    return true;
+}
+
+static bool trans_vsetvli(DisasContext *ctx, arg_vsetvli *a)
+{
+    TCGv s1, s2;
+
+    if (!require_rvv(ctx)) {
+        return false;
+    }
+
+    s1 = tcg_temp_new();
+    s2 = tcg_const_tl(a->zimm);
+    gen_get_avl(s1, a->rd, a->rs1);
+    do_vsetvl(ctx, a->rd, s1, s2);
+    tcg_temp_free(s1);
+    tcg_temp_free(s2);
+    return true;
+}
+
+static bool trans_vsetivli(DisasContext *ctx, arg_vsetivli *a)
+{
+    TCGv s1, s2;
+
+    if (!require_rvv(ctx)) {
+        return false;
+    }
+
+    /* The rs1 field holds the AVL as a 5-bit unsigned immediate */
+    s1 = tcg_const_tl(a->rs1);
+    s2 = tcg_const_tl(a->zimm);
+    do_vsetvl(ctx, a->rd, s1, s2);
+    tcg_temp_free(s1);
+    tcg_temp_free(s2);
+    return true;
+}
+
+/*
+ *** Vector Loads and Stores
+ *
+ * An access of EEW bits uses a register group of EMUL = EEW / SEW * LMUL
+ * registers; only whole register groups are supported.
+ */
+static bool vext_check_ldst(DisasContext *s, uint32_t vd, bool vm, int eew)
+{
+    int emul = eew - s->sew + s->lmul;
+
+    return vext_check_isa_ill(s) &&
+           (8 << eew) <= s->elen &&
+           emul >= 0 && emul <= 3 &&
+           vext_check_overlap_mask(vd, vm) &&
+           vext_check_reg(vd, emul);
+}
+
+typedef void gen_helper_ldst_us(TCGv_ptr, TCGv_ptr, TCGv,
+                                TCGv_env, TCGv_i32);
+typedef void gen_helper_ldst_stride(TCGv_ptr, TCGv_ptr, TCGv,
+                                    TCGv, TCGv_env, TCGv_i32);
+
+static bool ldst_us_trans(DisasContext *s, arg_r2vm *a, int eew,
+                          gen_helper_ldst_us *fn, bool is_store)
+{
+    TCGv_ptr dest, mask;
+    TCGv base;
+    TCGv_i32 desc;
+
+    if (!vext_check_ldst(s, a->rd, a->vm, eew)) {
+        return false;
+    }
+
+    dest = tcg_temp_new_ptr();
+    mask = tcg_temp_new_ptr();
+    base = tcg_temp_new();
+    desc = tcg_const_i32(vext_desc(s, a->vm));
+
+    gen_get_gpr(base, a->rs1);
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(s, a->rd));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(s, 0));
+
+    fn(dest, mask, base, cpu_env, desc);
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free(base);
+    tcg_temp_free_i32(desc);
+    if (!is_store) {
+        mark_vs_dirty(s);
+    }
+    return true;
+}
+
+static bool ldst_stride_trans(DisasContext *s, arg_rmrr *a, int eew,
+                              gen_helper_ldst_stride *fn, bool is_store)
+{
+    TCGv_ptr dest, mask;
+    TCGv base, stride;
+    TCGv_i32 desc;
+
+    if (!vext_check_ldst(s, a->rd, a->vm, eew)) {
+        return false;
+    }
+
+    dest = tcg_temp_new_ptr();
+    mask = tcg_temp_new_ptr();
+    base = tcg_temp_new();
+    stride = tcg_temp_new();
+    desc = tcg_const_i32(vext_desc(s, a->vm));
+
+    gen_get_gpr(base, a->rs1);
+    gen_get_gpr(stride, a->rs2);
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(s, a->rd));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(s, 0));
+
+    fn(dest, mask, base, stride, cpu_env, desc);
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free(base);
+    tcg_temp_free(stride);
+    tcg_temp_free_i32(desc);
+    if (!is_store) {
+        mark_vs_dirty(s);
+    }
+    return true;
+}
+
+#define GEN_VEXT_LDST_US_TRANS(NAME, EEW, IS_STORE)                   \
+static bool trans_##NAME(DisasContext *s, arg_r2vm *a)               \
+{                                                                    \
+    return ldst_us_trans(s, a, EEW, gen_helper_##NAME, IS_STORE);    \
+}
+
+GEN_VEXT_LDST_US_TRANS(vle8_v,  MO_8,  false)
+GEN_VEXT_LDST_US_TRANS(vle16_v, MO_16, false)
+GEN_VEXT_LDST_US_TRANS(vle32_v, MO_32, false)
+GEN_VEXT_LDST_US_TRANS(vle64_v, MO_64, false)
+GEN_VEXT_LDST_US_TRANS(vse8_v,  MO_8,  true)
+GEN_VEXT_LDST_US_TRANS(vse16_v, MO_16, true)
+GEN_VEXT_LDST_US_TRANS(vse32_v, MO_32, true)
+GEN_VEXT_LDST_US_TRANS(vse64_v, MO_64, true)
+
+#define GEN_VEXT_LDST_STRIDE_TRANS(NAME, EEW, IS_STORE)               \
+static bool trans_##NAME(DisasContext *s, arg_rmrr *a)               \
+{                                                                    \
+    return ldst_stride_trans(s, a, EEW, gen_helper_##NAME, IS_STORE);\
+}
+
+GEN_VEXT_LDST_STRIDE_TRANS(vlse8_v,  MO_8,  false)
+GEN_VEXT_LDST_STRIDE_TRANS(vlse16_v, MO_16, false)
+GEN_VEXT_LDST_STRIDE_TRANS(vlse32_v, MO_32, false)
+GEN_VEXT_LDST_STRIDE_TRANS(vlse64_v, MO_64, false)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse8_v,  MO_8,  true)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse16_v, MO_16, true)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse32_v, MO_32, true)
+GEN_VEXT_LDST_STRIDE_TRANS(vsse64_v, MO_64, true)
+
+/*
+ *** Vector Integer Arithmetic Instructions
+ *
+ * When the operation is unmasked and vl == VLMAX with vstart == 0 (as
+ * recorded in the tb flags), the whole register group is operated on
+ * and the operation is expanded inline with tcg-op-gvec, so that it is
+ * performed with host vector instructions.  Otherwise fall back to the
+ * out-of-line helpers, which handle masking, vstart and the tail.
+ */
+typedef void GVecGen3Fn(unsigned, uint32_t, uint32_t,
+                        uint32_t, uint32_t, uint32_t);
+typedef void GVecGen2sFn(unsigned, uint32_t, uint32_t,
+                         TCGv_i64, uint32_t, uint32_t);
+typedef void GVecGen2iFn(unsigned, uint32_t, uint32_t,
+                         int64_t, uint32_t, uint32_t);
+typedef void gen_helper_opivx(TCGv_ptr, TCGv_ptr, TCGv, TCGv_ptr,
+                              TCGv_env, TCGv_i32);
+
+static bool opivv_check(DisasContext *s, arg_rmrr *a)
+{
+    return vext_check_isa_ill(s) &&
+           vext_check_overlap_mask(a->rd, a->vm) &&
+           vext_check_reg(a->rd, s->lmul) &&
+           vext_check_reg(a->rs2, s->lmul) &&
+           vext_check_reg(a->rs1, s->lmul);
+}
+
+static bool opivx_check(DisasContext *s, arg_rmrr *a)
+{
+    return vext_check_isa_ill(s) &&
+           vext_check_overlap_mask(a->rd, a->vm) &&
+           vext_check_reg(a->rd, s->lmul) &&
+           vext_check_reg(a->rs2, s->lmul);
+}
+
+static bool opivv_cmp_check(DisasContext *s, arg_rmrr *a)
+{
+    return vext_check_isa_ill(s) &&
+           vext_check_reg(a->rs2, s->lmul) &&
+           vext_check_reg(a->rs1, s->lmul) &&
+           vext_check_mask_dest(s, a->rd, a->rs2) &&
+           vext_check_mask_dest(s, a->rd, a->rs1);
+}
+
+static bool opivx_cmp_check(DisasContext *s, arg_rmrr *a)
+{
+    return vext_check_isa_ill(s) &&
+           vext_check_reg(a->rs2, s->lmul) &&
+           vext_check_mask_dest(s, a->rd, a->rs2);
+}
+
+static bool do_opivv(DisasContext *s, arg_rmrr *a, GVecGen3Fn *gvec_fn,
+                     gen_helper_gvec_4_ptr *fn)
+{
+    if (gvec_fn && a->vm && s->vl_eq_vlmax) {
+        gvec_fn(s->sew, vreg_ofs(s, a->rd), vreg_ofs(s, a->rs2),
+                vreg_ofs(s, a->rs1), vext_maxsz(s), vext_maxsz(s));
+    } else {
+        tcg_gen_gvec_4_ptr(vreg_ofs(s, a->rd), vreg_ofs(s, 0),
+                           vreg_ofs(s, a->rs1), vreg_ofs(s, a->rs2),
+                           cpu_env, s->vlen / 8, s->vlen / 8,
+                           FIELD_DP32(0, VDATA, VM, a->vm), fn);
+    }
+    mark_vs_dirty(s);
+    return true;
+}
+
+static void opivx_trans(DisasContext *s, uint32_t vd, TCGv s1, uint32_t vs2,
+                        bool vm, gen_helper_opivx *fn)
+{
+    TCGv_ptr dest, src2, mask;
+    TCGv_i32 desc;
+
+    dest = tcg_temp_new_ptr();
+    mask = tcg_temp_new_ptr();
+    src2 = tcg_temp_new_ptr();
+    desc = tcg_const_i32(vext_desc(s, vm));
+
+    tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(s, vd));
+    tcg_gen_addi_ptr(src2, cpu_env, vreg_ofs(s, vs2));
+    tcg_gen_addi_ptr(mask, cpu_env, vreg_ofs(s, 0));
+
+    fn(dest, mask, s1, src2, cpu_env, desc);
+
+    tcg_temp_free_ptr(dest);
+    tcg_temp_free_ptr(mask);
+    tcg_temp_free_ptr(src2);
+    tcg_temp_free_i32(desc);
+    mark_vs_dirty(s);
+}
+
+static bool do_opivx(DisasContext *s, arg_rmrr *a, GVecGen2sFn *gvec_fn,
+                     gen_helper_opivx *fn)
+{
+    TCGv src1 = tcg_temp_new();
+
+    gen_get_gpr(src1, a->rs1);
+    if (gvec_fn && a->vm && s->vl_eq_vlmax) {
+        TCGv_i64 t1 = tcg_temp_new_i64();
+
+        tcg_gen_ext_tl_i64(t1, src1);
+        gvec_fn(s->sew, vreg_ofs(s, a->rd), vreg_ofs(s, a->rs2), t1,
+                vext_maxsz(s), vext_maxsz(s));
+        tcg_temp_free_i64(t1);
+        mark_vs_dirty(s);
+    } else {
+        opivx_trans(s, a->rd, src1, a->rs2, a->vm, fn);
+    }
+    tcg_temp_free(src1);
+    return true;
+}
+
+typedef enum {
+    IMM_ZX,         /* Zero-extended */
+    IMM_SX,         /* Sign-extended */
+    IMM_TRUNC_SEW,  /* Truncate to log(SEW) bits */
+} imm_mode_t;
+
+static int64_t extract_imm(DisasContext *s, uint32_t imm, imm_mode_t mode)
+{
+    switch (mode) {
+    case IMM_ZX:
+        return extract64(imm, 0, 5);
+    case IMM_SX:
+        return sextract64(imm, 0, 5);
+    case IMM_TRUNC_SEW:
+        return extract64(imm, 0, s->sew + 3);
+    default:
+        g_assert_not_reached();
+    }
+}
+
+static bool do_opivi(DisasContext *s, arg_rmrr *a, imm_mode_t imm_mode,
+                     GVecGen2iFn *gvec_fn, gen_helper_opivx *fn)
+{
+    int64_t imm = extract_imm(s, a->rs1, imm_mode);
+
+    if (gvec_fn && a->vm && s->vl_eq_vlmax) {
+        gvec_fn(s->sew, vreg_ofs(s, a->rd), vreg_ofs(s, a->rs2), imm,
+                vext_maxsz(s), vext_maxsz(s));
+        mark_vs_dirty(s);
+    } else {
+        TCGv src1 = tcg_const_tl(imm);
+
+        opivx_trans(s, a->rd, src1, a->rs2, a->vm, fn);
+        tcg_temp_free(src1);
+    }
+    return true;
+}
+
+#define GEN_OPIVV_TRANS(NAME, GVEC_FN, CHECK)                         \
+static bool trans_##NAME(DisasContext *s, arg_rmrr *a)               \
+{                                                                    \
+    static gen_helper_gvec_4_ptr * const fns[4] = {                  \
+        gen_helper_##NAME##_b, gen_helper_##NAME##_h,                \
+        gen_helper_##NAME##_w, gen_helper_##NAME##_d,                \
+    };                                                               \
+    if (!CHECK(s, a)) {                                              \
+        return false;                                                \
+    }                                                                \
+    return do_opivv(s, a, GVEC_FN, fns[s->sew]);                     \
+}
+
+#define GEN_OPIVX_TRANS(NAME, GVEC_FN, CHECK)                         \
+static bool trans_##NAME(DisasContext *s, arg_rmrr *a)               \
+{                                                                    \
+    static gen_helper_opivx * const fns[4] = {                       \
+        gen_helper_##NAME##_b, gen_helper_##NAME##_h,                \
+        gen_helper_##NAME##_w, gen_helper_##NAME##_d,                \
+    };                                                               \
+    if (!CHECK(s, a)) {                                              \
+        return false;                                                \
+    }                                                                \
+    return do_opivx(s, a, GVEC_FN, fns[s->sew]);                     \
+}
+
+/* The immediate forms share the helpers of the scalar forms */
+#define GEN_OPIVI_TRANS(NAME, IMM_MODE, OPIVX, GVEC_FN, CHECK)        \
+static bool trans_##NAME(DisasContext *s, arg_rmrr *a)               \
+{                                                                    \
+    static gen_helper_opivx * const fns[4] = {                       \
+        gen_helper_##OPIVX##_b, gen_helper_##OPIVX##_h,              \
+        gen_helper_##OPIVX##_w, gen_helper_##OPIVX##_d,              \
+    };                                                               \
+    if (!CHECK(s, a)) {                                              \
+        return false;                                                \
+    }                                                                \
+    return do_opivi(s, a, IMM_MODE, GVEC_FN, fns[s->sew]);           \
+}
+
+/* Reverse subtract: vd = x - vs2, as a negate followed by an add */
+static void gen_vec_rsubs(unsigned vece, uint32_t dofs, uint32_t aofs,
+                          TCGv_i64 c, uint32_t oprsz, uint32_t maxsz)
+{
+    tcg_gen_gvec_neg(vece, dofs, aofs, oprsz, maxsz);
+    tcg_gen_gvec_adds(vece, dofs, dofs, c, oprsz, maxsz);
+}
+
+static void gen_vec_rsubi(unsigned vece, uint32_t dofs, uint32_t aofs,
+                          int64_t c, uint32_t oprsz, uint32_t maxsz)
+{
+    tcg_gen_gvec_neg(vece, dofs, aofs, oprsz, maxsz);
+    tcg_gen_gvec_addi(vece, dofs, dofs, c, oprsz, maxsz);
+}
+
+/* Scalar shift amounts only use the low log2(SEW) bits */
+#define GEN_VEC_SHIFTS(NAME, GVEC_FN)                                 \
+static void NAME(unsigned vece, uint32_t dofs, uint32_t aofs,        \
+                 TCGv_i64 c, uint32_t oprsz, uint32_t maxsz)         \
+{                                                                    \
+    TCGv_i32 t = tcg_temp_new_i32();                                 \
+                                                                     \
+    tcg_gen_extrl_i64_i32(t, c);                                     \
+    tcg_gen_andi_i32(t, t, (8 << vece) - 1);                         \
+    GVEC_FN(vece, dofs, aofs, t, oprsz, maxsz);                      \
+    tcg_temp_free_i32(t);                                            \
+}
+
+GEN_VEC_SHIFTS(gen_vec_shls, tcg_gen_gvec_shls)
+GEN_VEC_SHIFTS(gen_vec_shrs, tcg_gen_gvec_shrs)
+GEN_VEC_SHIFTS(gen_vec_sars, tcg_gen_gvec_sars)
+
+/* Vector Single-Width Integer Add and Subtract */
+GEN_OPIVV_TRANS(vadd_vv, tcg_gen_gvec_add, opivv_check)
+GEN_OPIVV_TRANS(vsub_vv, tcg_gen_gvec_sub, opivv_check)
+GEN_OPIVX_TRANS(vadd_vx, tcg_gen_gvec_adds, opivx_check)
+GEN_OPIVX_TRANS(vsub_vx, tcg_gen_gvec_subs, opivx_check)
+GEN_OPIVX_TRANS(vrsub_vx, gen_vec_rsubs, opivx_check)
+GEN_OPIVI_TRANS(vadd_vi, IMM_SX, vadd_vx, tcg_gen_gvec_addi, opivx_check)
+GEN_OPIVI_TRANS(vrsub_vi, IMM_SX, vrsub_vx, gen_vec_rsubi, opivx_check)
+
+/* Vector Bitwise Logical Instructions */
+GEN_OPIVV_TRANS(vand_vv, tcg_gen_gvec_and, opivv_check)
+GEN_OPIVV_TRANS(vor_vv,  tcg_gen_gvec_or,  opivv_check)
+GEN_OPIVV_TRANS(vxor_vv, tcg_gen_gvec_xor, opivv_check)
+GEN_OPIVX_TRANS(vand_vx, tcg_gen_gvec_ands, opivx_check)
+GEN_OPIVX_TRANS(vor_vx,  tcg_gen_gvec_ors,  opivx_check)
+GEN_OPIVX_TRANS(vxor_vx, tcg_gen_gvec_xors, opivx_check)
+GEN_OPIVI_TRANS(vand_vi, IMM_SX, vand_vx, tcg_gen_gvec_andi, opivx_check)
+GEN_OPIVI_TRANS(vor_vi,  IMM_SX, vor_vx,  tcg_gen_gvec_ori,  opivx_check)
+GEN_OPIVI_TRANS(vxor_vi, IMM_SX, vxor_vx, tcg_gen_gvec_xori, opivx_check)
+
+/* Vector Single-Width Bit Shift Instructions */
+GEN_OPIVV_TRANS(vsll_vv, tcg_gen_gvec_shlv, opivv_check)
+GEN_OPIVV_TRANS(vsrl_vv, tcg_gen_gvec_shrv, opivv_check)
+GEN_OPIVV_TRANS(vsra_vv, tcg_gen_gvec_sarv, opivv_check)
+GEN_OPIVX_TRANS(vsll_vx, gen_vec_shls, opivx_check)
+GEN_OPIVX_TRANS(vsrl_vx, gen_vec_shrs, opivx_check)
+GEN_OPIVX_TRANS(vsra_vx, gen_vec_sars, opivx_check)
+GEN_OPIVI_TRANS(vsll_vi, IMM_TRUNC_SEW, vsll_vx, tcg_gen_gvec_shli,
+                opivx_check)
+GEN_OPIVI_TRANS(vsrl_vi, IMM_TRUNC_SEW, vsrl_vx, tcg_gen_gvec_shri,
+                opivx_check)
+GEN_OPIVI_TRANS(vsra_vi, IMM_TRUNC_SEW, vsra_vx, tcg_gen_gvec_sari,
+                opivx_check)
+
+/* Vector Integer Min/Max Instructions */
+GEN_OPIVV_TRANS(vminu_vv, tcg_gen_gvec_umin, opivv_check)
+GEN_OPIVV_TRANS(vmin_vv,  tcg_gen_gvec_smin, opivv_check)
+GEN_OPIVV_TRANS(vmaxu_vv, tcg_gen_gvec_umax, opivv_check)
+GEN_OPIVV_TRANS(vmax_vv,  tcg_gen_gvec_smax, opivv_check)
+GEN_OPIVX_TRANS(vminu_vx, NULL, opivx_check)
+GEN_OPIVX_TRANS(vmin_vx,  NULL, opivx_check)
+GEN_OPIVX_TRANS(vmaxu_vx, NULL, opivx_check)
+GEN_OPIVX_TRANS(vmax_vx,  NULL, opivx_check)
+
+/* Vector Single-Width Integer Multiply Instructions */
+GEN_OPIVV_TRANS(vmul_vv, tcg_gen_gvec_mul, opivv_check)
+GEN_OPIVX_TRANS(vmul_vx, tcg_gen_gvec_muls, opivx_check)
+
+/* Vector Integer Comparison Instructions */
+GEN_OPIVV_TRANS(vmseq_vv, NULL, opivv_cmp_check)
+GEN_OPIVV_TRANS(vmsne_vv, NULL, opivv_cmp_check)
+GEN_OPIVV_TRANS(vmsltu_vv, NULL, opivv_cmp_check)
+GEN_OPIVV_TRANS(vmslt_vv, NULL, opivv_cmp_check)
+GEN_OPIVV_TRANS(vmsleu_vv, NULL, opivv_cmp_check)
+GEN_OPIVV_TRANS(vmsle_vv, NULL, opivv_cmp_check)
+GEN_OPIVX_TRANS(vmseq_vx, NULL, opivx_cmp_check)
+GEN_OPIVX_TRANS(vmsne_vx, NULL, opivx_cmp_check)
+GEN_OPIVX_TRANS(vmsltu_vx, NULL, opivx_cmp_check)
+GEN_OPIVX_TRANS(vmslt_vx, NULL, opivx_cmp_check)
+GEN_OPIVX_TRANS(vmsleu_vx, NULL, opivx_cmp_check)
+GEN_OPIVX_TRANS(vmsle_vx, NULL, opivx_cmp_check)
+GEN_OPIVX_TRANS(vmsgtu_vx, NULL, opivx_cmp_check)
+GEN_OPIVX_TRANS(vmsgt_vx, NULL, opivx_cmp_check)
+GEN_OPIVI_TRANS(vmseq_vi, IMM_SX, vmseq_vx, NULL, opivx_cmp_check)
+GEN_OPIVI_TRANS(vmsne_vi, IMM_SX, vmsne_vx, NULL, opivx_cmp_check)
+GEN_OPIVI_TRANS(vmsleu_vi, IMM_SX, vmsleu_vx, NULL, opivx_cmp_check)
+GEN_OPIVI_TRANS(vmsle_vi, IMM_SX, vmsle_vx, NULL, opivx_cmp_check)
+GEN_OPIVI_TRANS(vmsgtu_vi, IMM_SX, vmsgtu_vx, NULL, opivx_cmp_check)
+GEN_OPIVI_TRANS(vmsgt_vi, IMM_SX, vmsgt_vx, NULL, opivx_cmp_check)
+
+/* Vector Integer Merge and Move Instructions */
+GEN_OPIVV_TRANS(vmerge_vvm, NULL, opivv_check)
+GEN_OPIVX_TRANS(vmerge_vxm, NULL, opivx_check)
+GEN_OPIVI_TRANS(vmerge_vim, IMM_SX, vmerge_vxm, NULL, opivx_check)
+
+static bool trans_vmv_v_v(DisasContext *s, arg_vmv_v_v *a)
+{
+    static gen_helper_gvec_2_ptr * const fns[4] = {
+        gen_helper_vmv_v_v_b, gen_helper_vmv_v_v_h,
+        gen_helper_vmv_v_v_w, gen_helper_vmv_v_v_d,
+    };
+
+    if (!vext_check_isa_ill(s) ||
+        !vext_check_reg(a->rd, s->lmul) ||
+        !vext_check_reg(a->rs1, s->lmul)) {
+        return false;
+    }
+
+    if (s->vl_eq_vlmax) {
+        tcg_gen_gvec_mov(s->sew, vreg_ofs(s, a->rd), vreg_ofs(s, a->rs1),
+                         vext_maxsz(s), vext_maxsz(s));
+    } else {
+        tcg_gen_gvec_2_ptr(vreg_ofs(s, a->rd), vreg_ofs(s, a->rs1),
+                           cpu_env, s->vlen / 8, s->vlen / 8, 0,
+                           fns[s->sew]);
+    }
+    mark_vs_dirty(s);
+    return true;
+}
+
+typedef void gen_helper_vmv_vx(TCGv_ptr, TCGv, TCGv_env, TCGv_i32);
+
+static void do_vmv_v_x(DisasContext *s, uint32_t vd, TCGv s1)
+{
+    static gen_helper_vmv_vx * const fns[4] = {
+        gen_helper_vmv_v_x_b, gen_helper_vmv_v_x_h,
+        gen_helper_vmv_v_x_w, gen_helper_vmv_v_x_d,
+    };
+
+    if (s->vl_eq_vlmax) {
+        TCGv_i64 t1 = tcg_temp_new_i64();
+
+        tcg_gen_ext_tl_i64(t1, s1);
+        tcg_gen_gvec_dup_i64(s->sew, vreg_ofs(s, vd),
+                             vext_maxsz(s), vext_maxsz(s), t1);
+        tcg_temp_free_i64(t1);
+    } else {
+        TCGv_ptr dest = tcg_temp_new_ptr();
+        TCGv_i32 desc = tcg_const_i32(vext_desc(s, true));
+
+        tcg_gen_addi_ptr(dest, cpu_env, vreg_ofs(s, vd));
+        fns[s->sew](dest, s1, cpu_env, desc);
+        tcg_temp_free_ptr(dest);
+        tcg_temp_free_i32(desc);
+    }
+    mark_vs_dirty(s);
+}
+
+static bool trans_vmv_v_x(DisasContext *s, arg_vmv_v_x *a)
+{
+    TCGv s1;
+
+    if (!vext_check_isa_ill(s) || !vext_check_reg(a->rd, s->lmul)) {
+        return false;
+    }
+
+    s1 = tcg_temp_new();
+    gen_get_gpr(s1, a->rs1);
+    do_vmv_v_x(s, a->rd, s1);
+    tcg_temp_free(s1);
+    return true;
+}
+
+static bool trans_vmv_v_i(DisasContext *s, arg_vmv_v_i *a)
+{
+    int64_t simm = sextract64(a->rs1, 0, 5);
+    TCGv s1;
+
+    if (!vext_check_isa_ill(s) || !vext_check_reg(a->rd, s->lmul)) {
+        return false;
+    }
+
+    if (s->vl_eq_vlmax) {
+        tcg_gen_gvec_dup_imm(s->sew, vreg_ofs(s, a->rd),
+                             vext_maxsz(s), vext_maxsz(s), simm);
+        mark_vs_dirty(s);
+        return true;
+    }
+
+    s1 = tcg_const_tl(simm);
+    do_vmv_v_x(s, a->rd, s1);
+    tcg_temp_free(s1);
+    return true;
+}
+
+/*
+ *** Vector Permutation Instructions
+ */
+
+/* Integer Scalar Move: x[rd] = sext(vs2[0]), regardless of vl */
+static bool trans_vmv_x_s(DisasContext *s, arg_vmv_x_s *a)
+{
+    TCGv_i64 t1;
+    TCGv dest;
+
+    if (!vext_check_isa_ill(s)) {
+        return false;
+    }
+
+    t1 = tcg_temp_new_i64();
+    dest = tcg_temp_new();
+    switch (s->sew) {
+    case MO_8:
+        tcg_gen_ld8s_i64(t1, cpu_env, endian_ofs(s, a->rs2, 0));
+        break;
+    case MO_16:
+        tcg_gen_ld16s_i64(t1, cpu_env, endian_ofs(s, a->rs2, 0));
+        break;
+    case MO_32:
+        tcg_gen_ld32s_i64(t1, cpu_env, endian_ofs(s, a->rs2, 0));
+        break;
+    case MO_64:
+        tcg_gen_ld_i64(t1, cpu_env, endian_ofs(s, a->rs2, 0));
+        break;
+    default:
+        g_assert_not_reached();
+    }
+    tcg_gen_trunc_i64_tl(dest, t1);
+    gen_set_gpr(a->rd, dest);
+    vext_clear_vstart();
+
+    tcg_temp_free_i64(t1);
+    tcg_temp_free(dest);
+    return true;
+}
+
+/* Integer Scalar Move: vd[0] = x[rs1], if vstart < vl */
+static bool trans_vmv_s_x(DisasContext *s, arg_vmv_s_x *a)
+{
+    TCGLabel *over;
+    TCGv vl, vstart;
+    TCGv_i64 t1;
+
+    if (!vext_check_isa_ill(s)) {
+        return false;
+    }
+
+    over = gen_new_label();
+    vl = tcg_temp_new();
+    vstart = tcg_temp_new();
+    tcg_gen_ld_tl(vl, cpu_env, offsetof(CPURISCVState, vl));
+    tcg_gen_ld_tl(vstart, cpu_env, offsetof(CPURISCVState, vstart));
+    tcg_gen_brcond_tl(TCG_COND_GEU, vstart, vl, over);
+    tcg_temp_free(vl);
+    tcg_temp_free(vstart);
+
+    t1 = tcg_temp_new_i64();
+    if (a->rs1 == 0) {
+        tcg_gen_movi_i64(t1, 0);
+    } else {
+        tcg_gen_ext_tl_i64(t1, cpu_gpr[a->rs1]);
+    }
+    switch (s->sew) {
+    case MO_8:
+        tcg_gen_st8_i64(t1, cpu_env, endian_ofs(s, a->rd, 0));
+        break;
+    case MO_16:
+        tcg_gen_st16_i64(t1, cpu_env, endian_ofs(s, a->rd, 0));
+        break;
+    case MO_32:
+        tcg_gen_st32_i64(t1, cpu_env, endian_ofs(s, a->rd, 0));
+        break;
+    case MO_64:
+        tcg_gen_st_i64(t1, cpu_env, endian_ofs(s, a->rd, 0));
+        break;
+    default:
+        g_assert_not_reached();
+    }
+    tcg_temp_free_i64(t1);
+
+    gen_set_label(over);
+    vext_clear_vstart();
+    mark_vs_dirty(s);
+    return true;
+}
@@ -0,0 +1,539 @@
+/*
+ * RISC-V implementation of KVM hooks
+ *
+ * Copyright (c) 2020 SiFive, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 or later, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include <sys/ioctl.h>
+
+#include <linux/kvm.h>
+
+#include "qemu-common.h"
+#include "qemu/timer.h"
+#include "qemu/error-report.h"
+#include "qemu/log.h"
+#include "qemu/main-loop.h"
+#include "sysemu/sysemu.h"
+#include "sysemu/kvm.h"
+#include "sysemu/kvm_int.h"
+#include "sysemu/runstate.h"
+#include "cpu.h"
+#include "chardev/char.h"
+#include "exec/memattrs.h"
+#include "kvm_riscv.h"
+#include "trace.h"
+
+/* Legacy SBI extensions that are forwarded to userspace */
+#define SBI_EXT_0_1_CONSOLE_PUTCHAR 0x1
+#define SBI_EXT_0_1_CONSOLE_GETCHAR 0x2
+
+#if defined(TARGET_RISCV32)
+#define KVM_REG_SIZE_ULONG KVM_REG_SIZE_U32
+#else
+#define KVM_REG_SIZE_ULONG KVM_REG_SIZE_U64
+#endif
+
+#define RISCV_CONFIG_REG(name) \
+    (KVM_REG_RISCV | KVM_REG_SIZE_ULONG | KVM_REG_RISCV_CONFIG | \
+     KVM_REG_RISCV_CONFIG_REG(name))
+
+#define RISCV_CORE_REG(idx) \
+    (KVM_REG_RISCV | KVM_REG_SIZE_ULONG | KVM_REG_RISCV_CORE | (idx))
+
+#define RISCV_CSR_REG(name) \
+    (KVM_REG_RISCV | KVM_REG_SIZE_ULONG | KVM_REG_RISCV_CSR | \
+     KVM_REG_RISCV_CSR_REG(name))
+
+#define RISCV_TIMER_REG(name) \
+    (KVM_REG_RISCV | KVM_REG_SIZE_U64 | KVM_REG_RISCV_TIMER | \
+     KVM_REG_RISCV_TIMER_REG(name))
+
+#define RISCV_FP_F_REG(idx) \
+    (KVM_REG_RISCV | KVM_REG_SIZE_U32 | KVM_REG_RISCV_FP_F | (idx))
+
+#define RISCV_FP_D_REG(idx) \
+    (KVM_REG_RISCV | KVM_REG_SIZE_U64 | KVM_REG_RISCV_FP_D | (idx))
+
+/* fcsr follows the 32 data registers in both the F and D register sets */
+#define RISCV_FP_F_FCSR     (RISCV_FP_F_REG(32))
+#define RISCV_FP_D_FCSR     \
+    (KVM_REG_RISCV | KVM_REG_SIZE_U32 | KVM_REG_RISCV_FP_D | 32)
+
+#define KVM_RISCV_GET_REG(cs, id, field) \
+    do { \
+        int _ret = kvm_get_one_reg(cs, id, &(field)); \
+        if (_ret) { \
+            return _ret; \
+        } \
+    } while (0)
+
+#define KVM_RISCV_SET_REG(cs, id, field) \
+    do { \
+        int _ret = kvm_set_one_reg(cs, id, &(field)); \
+        if (_ret) { \
+            return _ret; \
+        } \
+    } while (0)
+
+const KVMCapabilityInfo kvm_arch_required_capabilities[] = {
+    KVM_CAP_LAST_INFO
+};
+
+static int kvm_riscv_get_regs_core(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+    target_ulong reg;
+    int i;
+
+    KVM_RISCV_GET_REG(cs, RISCV_CORE_REG(KVM_REG_RISCV_CORE_REG(regs.pc)),
+                      env->pc);
+
+    /* The register file follows pc in the order x1..x31 */
+    for (i = 1; i < 32; i++) {
+        KVM_RISCV_GET_REG(cs, RISCV_CORE_REG(i), env->gpr[i]);
+    }
+
+    KVM_RISCV_GET_REG(cs, RISCV_CORE_REG(KVM_REG_RISCV_CORE_REG(mode)), reg);
+    env->priv = reg == KVM_RISCV_MODE_S ? PRV_S : PRV_U;
+
+    return 0;
+}
+
+static int kvm_riscv_put_regs_core(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+    target_ulong reg;
+    int i;
+
+    KVM_RISCV_SET_REG(cs, RISCV_CORE_REG(KVM_REG_RISCV_CORE_REG(regs.pc)),
+                      env->pc);
+
+    for (i = 1; i < 32; i++) {
+        KVM_RISCV_SET_REG(cs, RISCV_CORE_REG(i), env->gpr[i]);
+    }
+
+    reg = env->priv == PRV_U ? KVM_RISCV_MODE_U : KVM_RISCV_MODE_S;
+    KVM_RISCV_SET_REG(cs, RISCV_CORE_REG(KVM_REG_RISCV_CORE_REG(mode)), reg);
+
+    return 0;
+}
+
+/*
+ * The guest runs in VS-mode and only has the supervisor CSRs, which are
+ * kept in the fields of the machine mode registers they are views of.
+ */
+static int kvm_riscv_get_regs_csr(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(sstatus), env->mstatus);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(sie), env->mie);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(sip), env->mip);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(stvec), env->stvec);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(sscratch), env->sscratch);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(sepc), env->sepc);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(scause), env->scause);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(stval), env->sbadaddr);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(satp), env->satp);
+    KVM_RISCV_GET_REG(cs, RISCV_CSR_REG(scounteren), env->scounteren);
+
+    return 0;
+}
+
+static int kvm_riscv_put_regs_csr(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(sstatus), env->mstatus);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(sie), env->mie);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(sip), env->mip);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(stvec), env->stvec);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(sscratch), env->sscratch);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(sepc), env->sepc);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(scause), env->scause);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(stval), env->sbadaddr);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(satp), env->satp);
+    KVM_RISCV_SET_REG(cs, RISCV_CSR_REG(scounteren), env->scounteren);
+
+    return 0;
+}
+
+static int kvm_riscv_get_regs_fp(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+    uint32_t fcsr;
+    int i;
+
+    if (riscv_has_ext(env, RVD)) {
+        for (i = 0; i < 32; i++) {
+            KVM_RISCV_GET_REG(cs, RISCV_FP_D_REG(i), env->fpr[i]);
+        }
+        KVM_RISCV_GET_REG(cs, RISCV_FP_D_FCSR, fcsr);
+    } else if (riscv_has_ext(env, RVF)) {
+        for (i = 0; i < 32; i++) {
+            uint32_t reg;
+
+            KVM_RISCV_GET_REG(cs, RISCV_FP_F_REG(i), reg);
+            /* Single precision values are NaN-boxed in the register file */
+            env->fpr[i] = reg | MAKE_64BIT_MASK(32, 32);
+        }
+        KVM_RISCV_GET_REG(cs, RISCV_FP_F_FCSR, fcsr);
+    } else {
+        return 0;
+    }
+
+    riscv_cpu_set_frm(env, (fcsr & FSR_RD) >> FSR_RD_SHIFT);
+    riscv_cpu_set_fflags(env, (fcsr & FSR_AEXC) >> FSR_AEXC_SHIFT);
+
+    return 0;
+}
+
+static int kvm_riscv_put_regs_fp(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+    uint32_t fcsr = (riscv_cpu_get_fflags(env) << FSR_AEXC_SHIFT) |
+                    (env->frm << FSR_RD_SHIFT);
+    int i;
+
+    if (riscv_has_ext(env, RVD)) {
+        for (i = 0; i < 32; i++) {
+            KVM_RISCV_SET_REG(cs, RISCV_FP_D_REG(i), env->fpr[i]);
+        }
+        KVM_RISCV_SET_REG(cs, RISCV_FP_D_FCSR, fcsr);
+    } else if (riscv_has_ext(env, RVF)) {
+        for (i = 0; i < 32; i++) {
+            uint32_t reg = env->fpr[i];
+
+            KVM_RISCV_SET_REG(cs, RISCV_FP_F_REG(i), reg);
+        }
+        KVM_RISCV_SET_REG(cs, RISCV_FP_F_FCSR, fcsr);
+    }
+
+    return 0;
+}
+
+/*
+ * The timer keeps running in the kernel while QEMU looks at the other
+ * registers, so it is only saved when the VM stops and only restored
+ * when it runs again, like the MIPS count register.
+ */
+static void kvm_riscv_get_regs_timer(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+
+    if (env->kvm_timer_dirty) {
+        return;
+    }
+
+    if (kvm_get_one_reg(cs, RISCV_TIMER_REG(time), &env->kvm_timer_time) ||
+        kvm_get_one_reg(cs, RISCV_TIMER_REG(compare),
+                        &env->kvm_timer_compare) ||
+        kvm_get_one_reg(cs, RISCV_TIMER_REG(state), &env->kvm_timer_state) ||
+        kvm_get_one_reg(cs, RISCV_TIMER_REG(frequency),
+                        &env->kvm_timer_frequency)) {
+        warn_report("Failed saving the KVM timer");
+        return;
+    }
+
+    env->kvm_timer_dirty = true;
+}
+
+static void kvm_riscv_put_regs_timer(CPUState *cs)
+{
+    CPURISCVState *env = &RISCV_CPU(cs)->env;
+    uint64_t reg;
+
+    if (!env->kvm_timer_dirty) {
+        return;
+    }
+
+    if (kvm_set_one_reg(cs, RISCV_TIMER_REG(time), &env->kvm_timer_time) ||
+        kvm_set_one_reg(cs, RISCV_TIMER_REG(compare),
+                        &env->kvm_timer_compare)) {
+        warn_report("Failed restoring the KVM timer");
+        return;
+    }
+
+    /*
+     * Setting the state to on with a compare value in the past raises the
+     * timer interrupt, so only do it when the timer was running.
+     */
+    if (env->kvm_timer_state &&
+        kvm_set_one_reg(cs, RISCV_TIMER_REG(state), &env->kvm_timer_state)) {
+        warn_report("Failed restoring the KVM timer state");
+        return;
+    }
+
+    /* The frequency is read only; a VM migrated across hosts must agree */
+    if (!kvm_get_one_reg(cs, RISCV_TIMER_REG(frequency), &reg) &&
+        reg != env->kvm_timer_frequency) {
+        error_report("Host timer frequency %" PRIu64 " differs from the "
+                     "saved %" PRIu64, reg, env->kvm_timer_frequency);
+    }
+
+    env->kvm_timer_dirty = false;
+}
+
+static void kvm_riscv_vm_state_change(void *opaque, int running,
+                                      RunState state)
+{
+    CPUState *cs = opaque;
+
+    if (running) {
+        kvm_riscv_put_regs_timer(cs);
+    } else {
+        kvm_riscv_get_regs_timer(cs);
+    }
+}
+
+uint64_t kvm_riscv_get_timebase_frequency(RISCVCPU *cpu)
+{
+    uint64_t reg = 0;
+
+    if (kvm_get_one_reg(CPU(cpu), RISCV_TIMER_REG(frequency), &reg)) {
+        error_report("Unable to read the KVM timer frequency");
+        exit(1);
+    }
+    return reg;
+}
+
+int kvm_arch_get_registers(CPUState *cs)
+{
+    int ret;
+
+    ret = kvm_riscv_get_regs_core(cs);
+    if (ret) {
+        return ret;
+    }
+
+    ret = kvm_riscv_get_regs_csr(cs);
+    if (ret) {
+        return ret;
+    }
+
+    return kvm_riscv_get_regs_fp(cs);
+}
+
+int kvm_arch_put_registers(CPUState *cs, int level)
+{
+    int ret;
+
+    ret = kvm_riscv_put_regs_core(cs);
+    if (ret) {
+        return ret;
+    }
+
+    ret = kvm_riscv_put_regs_csr(cs);
+    if (ret) {
+        return ret;
+    }
+
+    return kvm_riscv_put_regs_fp(cs);
+}
+
+int kvm_arch_release_virq_post(int virq)
+{
+    return 0;
+}
+
+int kvm_arch_fixup_msi_route(struct kvm_irq_routing_entry *route,
+                             uint64_t address, uint32_t data, PCIDevice *dev)
+{
+    return 0;
+}
+
+int kvm_arch_add_msi_route_post(struct kvm_irq_routing_entry *route,
+                                int vector, PCIDevice *dev)
+{
+    return 0;
+}
+
+int kvm_arch_msi_data_to_gsi(uint32_t data)
+{
+    abort();
+}
+
+int kvm_arch_destroy_vcpu(CPUState *cs)
+{
+    return 0;
+}
+
+unsigned long kvm_arch_vcpu_id(CPUState *cs)
+{
+    return cs->cpu_index;
+}
+
+void kvm_arch_init_irq_routing(KVMState *s)
+{
+}
+
+int kvm_arch_init_vcpu(CPUState *cs)
+{
+    RISCVCPU *cpu = RISCV_CPU(cs);
+    CPURISCVState *env = &cpu->env;
+    target_ulong isa;
+    int ret;
+
+    qemu_add_vm_change_state_handler(kvm_riscv_vm_state_change, cs);
+
+    /* The kernel decides which extensions the guest gets */
+    ret = kvm_get_one_reg(cs, RISCV_CONFIG_REG(isa), &isa);
+    if (ret) {
+        return ret;
+    }
+    env->misa = (env->misa & ~(RV('Z') * 2 - 1)) | isa;
+    env->misa_mask = env->misa;
+
+    return 0;
+}
+
+int kvm_arch_init(MachineState *ms, KVMState *s)
+{
+    return 0;
+}
+
+int kvm_arch_irqchip_create(KVMState *s)
+{
+    return 0;
+}
+
+int kvm_arch_insert_sw_breakpoint(CPUState *cs, struct kvm_sw_breakpoint *bp)
+{
+    return -EINVAL;
+}
+
+int kvm_arch_remove_sw_breakpoint(CPUState *cs, struct kvm_sw_breakpoint *bp)
+{
+    return -EINVAL;
+}
+
+int kvm_arch_insert_hw_breakpoint(target_ulong addr,
+                                  target_ulong len, int type)
+{
+    return -EINVAL;
+}
+
+int kvm_arch_remove_hw_breakpoint(target_ulong addr,
+                                  target_ulong len, int type)
+{
+    return -EINVAL;
+}
+
+void kvm_arch_remove_all_hw_breakpoints(void)
+{
+}
+
+void kvm_arch_update_guest_debug(CPUState *cs, struct kvm_guest_debug *dbg)
+{
+}
+
+int kvm_arch_process_async_events(CPUState *cs)
+{
+    return 0;
+}
+
+void kvm_arch_pre_run(CPUState *cs, struct kvm_run *run)
+{
+}
+
+MemTxAttrs kvm_arch_post_run(CPUState *cs, struct kvm_run *run)
+{
+    return MEMTXATTRS_UNSPECIFIED;
+}
+
+bool kvm_arch_stop_on_emulation_error(CPUState *cs)
+{
+    return true;
+}
+
+static int kvm_riscv_handle_sbi(CPUState *cs, struct kvm_run *run)
+{
+    Chardev *chr = serial_hd(0);
+    uint8_t ch;
+
+    switch (run->riscv_sbi.extension_id) {
+    case SBI_EXT_0_1_CONSOLE_PUTCHAR:
+        ch = run->riscv_sbi.args[0];
+        if (chr) {
+            qemu_chr_write_all(chr, &ch, sizeof(ch));
+        }
+        break;
+    case SBI_EXT_0_1_CONSOLE_GETCHAR:
+        /* The serial port owns console input, so report nothing */
+        run->riscv_sbi.ret[0] = -1;
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP,
+                      "%s: unhandled SBI extension %lu function %lu\n",
+                      __func__, run->riscv_sbi.extension_id,
+                      run->riscv_sbi.function_id);
+        run->riscv_sbi.ret[0] = -1;
+        break;
+    }
+
+    return 0;
+}
+
+int kvm_arch_handle_exit(CPUState *cs, struct kvm_run *run)
+{
+    int ret;
+
+    trace_kvm_riscv_handle_exit(run->exit_reason);
+    switch (run->exit_reason) {
+    case KVM_EXIT_RISCV_SBI:
+        ret = kvm_riscv_handle_sbi(cs, run);
+        break;
+    default:
+        error_report("%s: unknown exit reason %d",
+                     __func__, run->exit_reason);
+        ret = -1;
+        break;
+    }
+
+    return ret;
+}
+
+void kvm_riscv_reset_vcpu(RISCVCPU *cpu)
+{
+    CPURISCVState *env = &cpu->env;
+
+    /*
+     * There is no M-mode firmware: the hart enters the kernel directly
+     * in S-mode with the hart id in a0 and the device tree in a1.
+     */
+    env->priv = PRV_S;
+    env->pc = env->kernel_addr;
+    env->gpr[10] = kvm_arch_vcpu_id(CPU(cpu));
+    env->gpr[11] = env->fdt_addr;
+    env->satp = 0;
+}
+
+void kvm_riscv_set_irq(RISCVCPU *cpu, int irq, int level)
+{
+    unsigned virq = level ? KVM_INTERRUPT_SET : KVM_INTERRUPT_UNSET;
+    int ret;
+
+    /* Only the external interrupt is injected, the kernel owns the rest */
+    if (irq != IRQ_S_EXT) {
+        return;
+    }
+
+    ret = kvm_vcpu_ioctl(CPU(cpu), KVM_INTERRUPT, &virq);
+    if (ret < 0) {
+        error_report("%s: cpu %d: failed to set IRQ %d",
+                     __func__, CPU(cpu)->cpu_index, irq);
+    }
+}
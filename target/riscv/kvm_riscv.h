@@ -0,0 +1,47 @@
+/*
+ * QEMU KVM support -- RISC-V specific functions.
+ *
+ * Copyright (c) 2020 SiFive, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 or later, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QEMU_KVM_RISCV_H
+#define QEMU_KVM_RISCV_H
+
+/**
+ * kvm_riscv_reset_vcpu:
+ * @cpu: RISCVCPU
+ *
+ * Called at reset time to start the hart in the kernel set up by the
+ * machine, as there is no firmware under KVM.
+ */
+void kvm_riscv_reset_vcpu(RISCVCPU *cpu);
+
+/**
+ * kvm_riscv_set_irq:
+ * @cpu: RISCVCPU
+ * @irq: interrupt number, only IRQ_S_EXT is injected
+ * @level: new level of the line
+ */
+void kvm_riscv_set_irq(RISCVCPU *cpu, int irq, int level);
+
+/**
+ * kvm_riscv_get_timebase_frequency:
+ * @cpu: RISCVCPU
+ *
+ * Returns the frequency of the time CSR as seen by the guest.
+ */
+uint64_t kvm_riscv_get_timebase_frequency(RISCVCPU *cpu);
+
+#endif
@@ -21,6 +21,7 @@
 #include "qemu/log.h"
 #include "cpu.h"
 #include "qemu/main-loop.h"
+#include "qemu/timer.h"
 #include "exec/exec-all.h"
 #include "exec/helper-proto.h"
 
@@ -167,6 +168,19 @@ target_ulong helper_mret(CPURISCVState *env, target_ulong cpu_pc_deb)
     return retpc;
 }
 
+/*
+ * Read time without riscv_csrrw() and the virtual clock's seqlock; the
+ * translator only uses this if reading the CSR cannot fail, see
+ * riscv_tr_init_disas_context().
+ */
+uint64_t helper_rdtime(CPURISCVState *env)
+{
+    uint64_t delta = riscv_cpu_virt_enabled(env) ? env->htimedelta : 0;
+
+    return (get_clock() + env->rdtime_offset) / env->rdtime_ns_per_tick +
+           delta;
+}
+
 void helper_wfi(CPURISCVState *env)
 {
     CPUState *cs = env_cpu(env);
@@ -182,18 +196,42 @@ void helper_wfi(CPURISCVState *env)
     }
 }
 
-void helper_tlb_flush(CPURISCVState *env)
+static void check_sfence_vma(CPURISCVState *env, uintptr_t ra)
 {
-    CPUState *cs = env_cpu(env);
     if (!(env->priv >= PRV_S) ||
         (env->priv == PRV_S &&
          get_field(env->mstatus, MSTATUS_TVM))) {
-        riscv_raise_exception(env, RISCV_EXCP_ILLEGAL_INST, GETPC());
-    } else {
-        tlb_flush(cs);
+        riscv_raise_exception(env, RISCV_EXCP_ILLEGAL_INST, ra);
     }
 }
 
+void helper_tlb_flush(CPURISCVState *env)
+{
+    check_sfence_vma(env, GETPC());
+    tlb_flush(env_cpu(env));
+}
+
+void helper_tlb_flush_asid(CPURISCVState *env, target_ulong asid)
+{
+    check_sfence_vma(env, GETPC());
+    /* rs2 holds the ASID in its low ASIDLEN bits */
+    riscv_cpu_flush_asid(env, asid & get_field(SATP_ASID, SATP_ASID));
+}
+
+void helper_tlb_flush_page(CPURISCVState *env, target_ulong addr)
+{
+    check_sfence_vma(env, GETPC());
+    tlb_flush_page(env_cpu(env), addr);
+}
+
+void helper_tlb_flush_page_asid(CPURISCVState *env, target_ulong addr,
+                                target_ulong asid)
+{
+    check_sfence_vma(env, GETPC());
+    riscv_cpu_flush_page_asid(env, addr,
+                              asid & get_field(SATP_ASID, SATP_ASID));
+}
+
 void helper_hyp_tlb_flush(CPURISCVState *env)
 {
     CPUState *cs = env_cpu(env);
@@ -201,6 +239,7 @@ void helper_hyp_tlb_flush(CPURISCVState *env)
     if (env->priv == PRV_M ||
         (env->priv == PRV_S && !riscv_cpu_virt_enabled(env))) {
         tlb_flush(cs);
+        riscv_cpu_flush_gstage_cache(env);
         return;
     }
 
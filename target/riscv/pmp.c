@@ -27,12 +27,14 @@
 #include "qemu/log.h"
 #include "qapi/error.h"
 #include "cpu.h"
+#include "exec/exec-all.h"
 #include "trace.h"
 
 static void pmp_write_cfg(CPURISCVState *env, uint32_t addr_index,
     uint8_t val);
 static uint8_t pmp_read_cfg(CPURISCVState *env, uint32_t addr_index);
 static void pmp_update_rule(CPURISCVState *env, uint32_t pmp_index);
+static void pmp_update_regions(CPURISCVState *env);
 
 /*
  * Accessor method to extract address matching type 'a field' from cfg reg
@@ -144,10 +146,6 @@ static void pmp_decode_napot(target_ulong a, target_ulong *sa, target_ulong *ea)
  */
 static void pmp_update_rule(CPURISCVState *env, uint32_t pmp_index)
 {
-    int i;
-
-    env->pmp_state.num_rules = 0;
-
     uint8_t this_cfg = env->pmp_state.pmp[pmp_index].cfg_reg;
     target_ulong this_addr = env->pmp_state.pmp[pmp_index].addr_reg;
     target_ulong prev_addr = 0u;
@@ -167,11 +165,16 @@ static void pmp_update_rule(CPURISCVState *env, uint32_t pmp_index)
     case PMP_AMATCH_TOR:
         sa = prev_addr << 2; /* shift up from [xx:0] to [xx+2:2] */
         ea = (this_addr << 2) - 1u;
+        if (this_addr <= prev_addr) {
+            /* An empty range, which never matches */
+            sa = 1u;
+            ea = 0u;
+        }
         break;
 
     case PMP_AMATCH_NA4:
         sa = this_addr << 2; /* shift up from [xx:0] to [xx+2:2] */
-        ea = (this_addr + 4u) - 1u;
+        ea = sa + 3u;
         break;
 
     case PMP_AMATCH_NAPOT:
@@ -186,28 +189,124 @@ static void pmp_update_rule(CPURISCVState *env, uint32_t pmp_index)
 
     env->pmp_state.addr[pmp_index].sa = sa;
     env->pmp_state.addr[pmp_index].ea = ea;
+}
+
+static int pmp_bound_cmp(const void *a, const void *b)
+{
+    target_ulong x = *(const target_ulong *)a;
+    target_ulong y = *(const target_ulong *)b;
+
+    return x < y ? -1 : x > y;
+}
 
+/*
+ * Flatten the rules into a sorted table of disjoint regions, each tagged
+ * with the highest priority (lowest numbered) rule matching it, so that a
+ * lookup is a binary search rather than a walk over every rule.  Called
+ * after any change to the cfg or addr registers.
+ */
+static void pmp_update_regions(CPURISCVState *env)
+{
+    pmp_table_t *t = &env->pmp_state;
+    target_ulong bound[2 * MAX_RISCV_PMPS + 1];
+    uint32_t nb = 0, nu = 0;
+    uint32_t i, k;
+
+    t->num_rules = 0;
+    bound[nb++] = 0;
     for (i = 0; i < MAX_RISCV_PMPS; i++) {
-        const uint8_t a_field =
-            pmp_get_a_field(env->pmp_state.pmp[i].cfg_reg);
-        if (PMP_AMATCH_OFF != a_field) {
-            env->pmp_state.num_rules++;
+        if (pmp_get_a_field(t->pmp[i].cfg_reg) == PMP_AMATCH_OFF) {
+            continue;
+        }
+        t->num_rules++;
+        if (t->addr[i].sa > t->addr[i].ea) {
+            continue;
+        }
+        bound[nb++] = t->addr[i].sa;
+        if (t->addr[i].ea != (target_ulong)-1) {
+            bound[nb++] = t->addr[i].ea + 1;
+        }
+    }
+
+    qsort(bound, nb, sizeof(target_ulong), pmp_bound_cmp);
+    for (i = 0; i < nb; i++) {
+        if (nu == 0 || bound[i] != bound[nu - 1]) {
+            bound[nu++] = bound[i];
         }
     }
+
+    /*
+     * No rule starts or ends inside a region, so each region is either
+     * wholly inside or wholly outside of every rule.
+     */
+    t->num_regions = 0;
+    for (k = 0; k < nu; k++) {
+        target_ulong sa = bound[k];
+        target_ulong ea = k + 1 < nu ? bound[k + 1] - 1 : (target_ulong)-1;
+        uint8_t rule = PMP_NO_RULE;
+
+        for (i = 0; i < MAX_RISCV_PMPS; i++) {
+            if (pmp_get_a_field(t->pmp[i].cfg_reg) != PMP_AMATCH_OFF &&
+                t->addr[i].sa <= sa && ea <= t->addr[i].ea) {
+                rule = i;
+                break;
+            }
+        }
+
+        if (t->num_regions && t->region[t->num_regions - 1].rule == rule) {
+            t->region[t->num_regions - 1].ea = ea;
+        } else {
+            t->region[t->num_regions].sa = sa;
+            t->region[t->num_regions].ea = ea;
+            t->region[t->num_regions].rule = rule;
+            t->num_regions++;
+        }
+    }
+
+    /* The TLB caches permissions derived from the old rules */
+    tlb_flush(env_cpu(env));
+    riscv_cpu_flush_gstage_cache(env);
 }
 
-static int pmp_is_in_range(CPURISCVState *env, int pmp_index, target_ulong addr)
+static const pmp_region_t *pmp_find_region(CPURISCVState *env,
+                                           target_ulong addr)
 {
-    int result = 0;
+    const pmp_table_t *t = &env->pmp_state;
+    uint32_t lo = 0, hi = t->num_regions - 1;
 
-    if ((addr >= env->pmp_state.addr[pmp_index].sa)
-        && (addr <= env->pmp_state.addr[pmp_index].ea)) {
-        result = 1;
-    } else {
-        result = 0;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi + 1) / 2;
+
+        if (t->region[mid].sa <= addr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return &t->region[lo];
+}
+
+/*
+ * The RWX privileges that MODE has within a region.
+ */
+static pmp_priv_t pmp_region_privs(CPURISCVState *env,
+                                   const pmp_region_t *r, target_ulong mode)
+{
+    pmp_priv_t allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
+
+    if (r->rule == PMP_NO_RULE) {
+        /*
+         * Privileged spec v1.10 states if no PMP entry matches an M-Mode
+         * access, the access succeeds.  Other modes are not allowed to
+         * succeed if they don't match a rule, but there are rules.
+         */
+        return mode == PRV_M ? allowed_privs : 0;
     }
 
-    return result;
+    if ((mode != PRV_M) || pmp_is_locked(env, r->rule)) {
+        allowed_privs &= env->pmp_state.pmp[r->rule].cfg_reg;
+    }
+    return allowed_privs;
 }
 
 
@@ -221,12 +320,8 @@ static int pmp_is_in_range(CPURISCVState *env, int pmp_index, target_ulong addr)
 bool pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
     target_ulong size, pmp_priv_t privs, target_ulong mode)
 {
-    int i = 0;
-    int ret = -1;
-    int pmp_size = 0;
-    target_ulong s = 0;
-    target_ulong e = 0;
-    pmp_priv_t allowed_privs = 0;
+    const pmp_region_t *r;
+    target_ulong pmp_size = 0;
 
     /* Short cut if no rules */
     if (0 == pmp_get_num_rules(env)) {
@@ -247,60 +342,50 @@ bool pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
         pmp_size = size;
     }
 
-    /* 1.10 draft priv spec states there is an implicit order
-         from low to high */
-    for (i = 0; i < MAX_RISCV_PMPS; i++) {
-        s = pmp_is_in_range(env, i, addr);
-        e = pmp_is_in_range(env, i, addr + pmp_size - 1);
-
-        /* partially inside */
-        if ((s + e) == 1) {
-            qemu_log_mask(LOG_GUEST_ERROR,
-                          "pmp violation - access is partially inside\n");
-            ret = 0;
-            break;
-        }
+    /*
+     * 1.10 draft priv spec states there is an implicit order from low to
+     * high.  An access that is not wholly inside the region holding its
+     * first byte is partially inside the highest priority rule that
+     * matches any of it.
+     */
+    r = pmp_find_region(env, addr);
+    if (pmp_size - 1 > r->ea - addr) {
+        qemu_log_mask(LOG_GUEST_ERROR,
+                      "pmp violation - access is partially inside\n");
+        return false;
+    }
 
-        /* fully inside */
-        const uint8_t a_field =
-            pmp_get_a_field(env->pmp_state.pmp[i].cfg_reg);
+    return (privs & pmp_region_privs(env, r, mode)) == privs;
+}
 
-        /*
-         * If the PMP entry is not off and the address is in range, do the priv
-         * check
-         */
-        if (((s + e) == 2) && (PMP_AMATCH_OFF != a_field)) {
-            allowed_privs = PMP_READ | PMP_WRITE | PMP_EXEC;
-            if ((mode != PRV_M) || pmp_is_locked(env, i)) {
-                allowed_privs &= env->pmp_state.pmp[i].cfg_reg;
-            }
+/*
+ * Return the privileges MODE has at ADDR, and shrink *TLB_SIZE (a power
+ * of two) to the largest naturally aligned block around ADDR over which
+ * they are uniform.  If that is smaller than a page, *TLB_SIZE is set to
+ * 1 so that the TLB entry is only used for a single access.
+ */
+pmp_priv_t pmp_get_tlb_privs(CPURISCVState *env, target_ulong addr,
+    target_ulong mode, target_ulong *tlb_size)
+{
+    const pmp_region_t *r;
+    target_ulong size, base;
 
-            if ((privs & allowed_privs) == privs) {
-                ret = 1;
-                break;
-            } else {
-                ret = 0;
-                break;
-            }
-        }
+    if (0 == pmp_get_num_rules(env)) {
+        return PMP_READ | PMP_WRITE | PMP_EXEC;
     }
 
-    /* No rule matched */
-    if (ret == -1) {
-        if (mode == PRV_M) {
-            ret = 1; /* Privileged spec v1.10 states if no PMP entry matches an
-                      * M-Mode access, the access succeeds */
-        } else {
-            ret = 0; /* Other modes are not allowed to succeed if they don't
-                      * match a rule, but there are rules.  We've checked for
-                      * no rule earlier in this function. */
+    r = pmp_find_region(env, addr);
+    for (size = *tlb_size; size >= TARGET_PAGE_SIZE; size >>= 1) {
+        base = addr & ~(size - 1);
+        if (base >= r->sa && size - 1 <= r->ea - base) {
+            break;
         }
     }
+    *tlb_size = size >= TARGET_PAGE_SIZE ? size : 1;
 
-    return ret == 1 ? true : false;
+    return pmp_region_privs(env, r, mode);
 }
 
-
 /*
  * Handle a write to a pmpcfg CSP
  */
@@ -323,6 +408,7 @@ void pmpcfg_csr_write(CPURISCVState *env, uint32_t reg_index,
         pmp_write_cfg(env, (reg_index * sizeof(target_ulong)) + i,
             cfg_val);
     }
+    pmp_update_regions(env);
 }
 
 
@@ -356,6 +442,11 @@ void pmpaddr_csr_write(CPURISCVState *env, uint32_t addr_index,
         if (!pmp_is_locked(env, addr_index)) {
             env->pmp_state.pmp[addr_index].addr_reg = val;
             pmp_update_rule(env, addr_index);
+            /* The next rule may use this address as the bottom of a TOR */
+            if (addr_index + 1 < MAX_RISCV_PMPS) {
+                pmp_update_rule(env, addr_index + 1);
+            }
+            pmp_update_regions(env);
         } else {
             qemu_log_mask(LOG_GUEST_ERROR,
                           "ignoring pmpaddr write - locked\n");
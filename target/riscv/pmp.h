@@ -46,10 +46,25 @@ typedef struct {
     target_ulong ea;
 } pmp_addr_t;
 
+/*
+ * A range of addresses that is matched by the same highest priority rule,
+ * or by none when rule is PMP_NO_RULE.
+ */
+#define PMP_NO_RULE 0xff
+
+typedef struct {
+    target_ulong sa;
+    target_ulong ea;
+    uint8_t rule;
+} pmp_region_t;
+
 typedef struct {
     pmp_entry_t pmp[MAX_RISCV_PMPS];
     pmp_addr_t  addr[MAX_RISCV_PMPS];
     uint32_t num_rules;
+    /* Sorted, disjoint regions covering the whole address space */
+    pmp_region_t region[2 * MAX_RISCV_PMPS + 1];
+    uint32_t num_regions;
 } pmp_table_t;
 
 void pmpcfg_csr_write(CPURISCVState *env, uint32_t reg_index,
@@ -60,5 +75,7 @@ void pmpaddr_csr_write(CPURISCVState *env, uint32_t addr_index,
 target_ulong pmpaddr_csr_read(CPURISCVState *env, uint32_t addr_index);
 bool pmp_hart_has_privs(CPURISCVState *env, target_ulong addr,
     target_ulong size, pmp_priv_t priv, target_ulong mode);
+pmp_priv_t pmp_get_tlb_privs(CPURISCVState *env, target_ulong addr,
+    target_ulong mode, target_ulong *tlb_size);
 
 #endif
@@ -30,6 +30,7 @@
 #include "exec/log.h"
 
 #include "instmap.h"
+#include "internals.h"
 
 /* global register indices */
 static TCGv cpu_gpr[32], cpu_pc;
@@ -49,13 +50,28 @@ typedef struct DisasContext {
     uint32_t mstatus_fs;
     uint32_t misa;
     uint32_t mem_idx;
-    /* Remember the rounding mode encoded in the previous fp instruction,
-       which we have already installed into env->fp_status.  Or -1 for
-       no previous fp instruction.  Note that we exit the TB when writing
-       to any system register, which includes CSR_FRM, so we do not have
-       to reset this known value.  */
+    target_ulong priv;
+    /* Remember the rounding mode installed into env->fp_status, or -1 if
+       unknown.  The TB starts with the dynamic rounding mode installed,
+       see riscv_cpu_set_frm(), and has to put it back on the way out if
+       it installed a static one, see gen_restore_rm().  Note that we
+       exit the TB when writing to any system register, which includes
+       CSR_FRM, so the dynamic rounding mode frm_dyn is constant for the
+       TB.  */
     int frm;
+    int frm_dyn;
     bool ext_ifencei;
+    bool ext_icsr;
+    /* time can be read with helper_rdtime() */
+    bool fast_rdtime;
+    /* vector extension */
+    uint32_t mstatus_vs;
+    bool vill;
+    uint8_t lmul;
+    uint8_t sew;
+    uint16_t vlen;
+    uint16_t elen;
+    bool vl_eq_vlmax;
 } DisasContext;
 
 #ifdef TARGET_RISCV64
@@ -83,8 +99,23 @@ static inline bool has_ext(DisasContext *ctx, uint32_t ext)
     return ctx->misa & ext;
 }
 
+/*
+ * Put back the dynamic rounding mode on a path out of the TB, if an
+ * instruction installed a static one.  ctx->frm is left alone because
+ * this may be only one of the paths out, e.g. of a conditional branch.
+ * Exceptions raised by helpers unwind through restore_state_to_opc(),
+ * which does the same.
+ */
+static void gen_restore_rm(DisasContext *ctx)
+{
+    if (ctx->frm != ctx->frm_dyn && ctx->frm_dyn <= RISCV_FRM_RMM) {
+        gen_helper_restore_rounding_mode(cpu_env);
+    }
+}
+
 static void generate_exception(DisasContext *ctx, int excp)
 {
+    gen_restore_rm(ctx);
     tcg_gen_movi_tl(cpu_pc, ctx->base.pc_next);
     TCGv_i32 helper_tmp = tcg_const_i32(excp);
     gen_helper_raise_exception(cpu_env, helper_tmp);
@@ -94,6 +125,7 @@ static void generate_exception(DisasContext *ctx, int excp)
 
 static void generate_exception_mbadaddr(DisasContext *ctx, int excp)
 {
+    gen_restore_rm(ctx);
     tcg_gen_movi_tl(cpu_pc, ctx->base.pc_next);
     tcg_gen_st_tl(cpu_pc, cpu_env, offsetof(CPURISCVState, badaddr));
     TCGv_i32 helper_tmp = tcg_const_i32(excp);
@@ -112,6 +144,7 @@ static void gen_exception_debug(void)
 /* Wrapper around tcg_gen_exit_tb that handles single stepping */
 static void exit_tb(DisasContext *ctx)
 {
+    gen_restore_rm(ctx);
     if (ctx->base.singlestep_enabled) {
         gen_exception_debug();
     } else {
@@ -122,6 +155,7 @@ static void exit_tb(DisasContext *ctx)
 /* Wrapper around tcg_gen_lookup_and_goto_ptr that handles single stepping */
 static void lookup_and_goto_ptr(DisasContext *ctx)
 {
+    gen_restore_rm(ctx);
     if (ctx->base.singlestep_enabled) {
         gen_exception_debug();
     } else {
@@ -129,6 +163,29 @@ static void lookup_and_goto_ptr(DisasContext *ctx)
     }
 }
 
+/* x1 and x5 are the link registers of the calling convention */
+static inline bool is_link_reg(int reg)
+{
+    return reg == 1 || reg == 5;
+}
+
+/*
+ * As lookup_and_goto_ptr, for JALR.  Use the return-address stack hints
+ * of the ISA: it is a return if it jumps through a link register without
+ * writing one.
+ */
+static void lookup_and_goto_ptr_jalr(DisasContext *ctx, int rd, int rs1)
+{
+    gen_restore_rm(ctx);
+    if (ctx->base.singlestep_enabled) {
+        gen_exception_debug();
+    } else if (is_link_reg(rs1) && !is_link_reg(rd)) {
+        tcg_gen_lookup_and_goto_ptr_return();
+    } else {
+        tcg_gen_lookup_and_goto_ptr_site();
+    }
+}
+
 static void gen_exception_illegal(DisasContext *ctx)
 {
     generate_exception(ctx, RISCV_EXCP_ILLEGAL_INST);
@@ -156,6 +213,7 @@ static void gen_goto_tb(DisasContext *ctx, int n, target_ulong dest)
 {
     if (use_goto_tb(ctx, dest)) {
         /* chaining is only allowed when the jump is to the same page */
+        gen_restore_rm(ctx);
         tcg_gen_goto_tb(n);
         tcg_gen_movi_tl(cpu_pc, dest);
 
@@ -331,6 +389,9 @@ static void gen_jal(DisasContext *ctx, int rd, target_ulong imm)
     if (rd != 0) {
         tcg_gen_movi_tl(cpu_gpr[rd], ctx->pc_succ_insn);
     }
+    if (is_link_reg(rd)) {
+        tcg_gen_push_return();
+    }
 
     gen_goto_tb(ctx, 0, ctx->base.pc_next + imm); /* must use this for safety */
     ctx->base.is_jmp = DISAS_NORETURN;
@@ -409,6 +470,33 @@ static void mark_fs_dirty(DisasContext *ctx)
 static inline void mark_fs_dirty(DisasContext *ctx) { }
 #endif
 
+#ifndef CONFIG_USER_ONLY
+/* The states of mstatus_vs follow those of mstatus_fs above. */
+static void mark_vs_dirty(DisasContext *ctx)
+{
+    TCGv tmp;
+    if (ctx->mstatus_vs == MSTATUS_VS) {
+        return;
+    }
+    /* Remember the state change for the rest of the TB.  */
+    ctx->mstatus_vs = MSTATUS_VS;
+
+    tmp = tcg_temp_new();
+    tcg_gen_ld_tl(tmp, cpu_env, offsetof(CPURISCVState, mstatus));
+    tcg_gen_ori_tl(tmp, tmp, MSTATUS_VS | MSTATUS_SD);
+    tcg_gen_st_tl(tmp, cpu_env, offsetof(CPURISCVState, mstatus));
+
+    if (ctx->virt_enabled) {
+        tcg_gen_ld_tl(tmp, cpu_env, offsetof(CPURISCVState, mstatus_hs));
+        tcg_gen_ori_tl(tmp, tmp, MSTATUS_VS | MSTATUS_SD);
+        tcg_gen_st_tl(tmp, cpu_env, offsetof(CPURISCVState, mstatus_hs));
+    }
+    tcg_temp_free(tmp);
+}
+#else
+static inline void mark_vs_dirty(DisasContext *ctx) { }
+#endif
+
 #if !defined(TARGET_RISCV64)
 static void gen_fp_load(DisasContext *ctx, uint32_t opc, int rd,
         int rs1, target_long imm)
@@ -490,6 +578,9 @@ static void gen_set_rm(DisasContext *ctx, int rm)
 {
     TCGv_i32 t0;
 
+    if (rm == RISCV_FRM_DYN) {
+        rm = ctx->frm_dyn;
+    }
     if (ctx->frm == rm) {
         return;
     }
@@ -712,6 +803,7 @@ static bool gen_shift(DisasContext *ctx, arg_r *a,
 #include "insn_trans/trans_rvf.inc.c"
 #include "insn_trans/trans_rvd.inc.c"
 #include "insn_trans/trans_rvh.inc.c"
+#include "insn_trans/trans_rvv.inc.c"
 #include "insn_trans/trans_privileged.inc.c"
 
 /* Include the auto-generated decoder for 16 bit insn */
@@ -749,6 +841,7 @@ static void riscv_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
 
     ctx->pc_succ_insn = ctx->base.pc_first;
     ctx->mem_idx = ctx->base.tb->flags & TB_FLAGS_MMU_MASK;
+    ctx->priv = ctx->mem_idx & TB_FLAGS_PRIV_MMU_MASK;
     ctx->mstatus_fs = ctx->base.tb->flags & TB_FLAGS_MSTATUS_FS;
     ctx->priv_ver = env->priv_ver;
 #if !defined(CONFIG_USER_ONLY)
@@ -771,8 +864,26 @@ static void riscv_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     ctx->virt_enabled = false;
 #endif
     ctx->misa = env->misa;
-    ctx->frm = -1;  /* unknown rounding mode */
+    ctx->frm_dyn = FIELD_EX32(ctx->base.tb->flags, TB_FLAGS, FRM);
+    /* reserved rounding modes have to raise on the first use */
+    ctx->frm = ctx->frm_dyn <= RISCV_FRM_RMM ? ctx->frm_dyn : -1;
     ctx->ext_ifencei = cpu->cfg.ext_ifencei;
+    ctx->ext_icsr = cpu->cfg.ext_icsr;
+#ifndef CONFIG_USER_ONLY
+    /* These are all the checks riscv_csrrw() does for reading time */
+    ctx->fast_rdtime = cpu->cfg.ext_icsr && cpu->cfg.ext_counters &&
+                       env->rdtime_ns_per_tick &&
+                       !(tb_cflags(ctx->base.tb) & CF_USE_ICOUNT);
+#else
+    ctx->fast_rdtime = false;
+#endif
+    ctx->mstatus_vs = ctx->base.tb->flags & TB_FLAGS_MSTATUS_VS;
+    ctx->vlen = cpu->cfg.vlen;
+    ctx->elen = cpu->cfg.elen;
+    ctx->vill = FIELD_EX32(ctx->base.tb->flags, TB_FLAGS, VILL);
+    ctx->sew = FIELD_EX32(ctx->base.tb->flags, TB_FLAGS, SEW);
+    ctx->lmul = FIELD_EX32(ctx->base.tb->flags, TB_FLAGS, LMUL);
+    ctx->vl_eq_vlmax = FIELD_EX32(ctx->base.tb->flags, TB_FLAGS, VL_EQ_VLMAX);
 }
 
 static void riscv_tr_tb_start(DisasContextBase *db, CPUState *cpu)
@@ -791,6 +902,7 @@ static bool riscv_tr_breakpoint_check(DisasContextBase *dcbase, CPUState *cpu,
 {
     DisasContext *ctx = container_of(dcbase, DisasContext, base);
 
+    gen_restore_rm(ctx);
     tcg_gen_movi_tl(cpu_pc, ctx->base.pc_next);
     ctx->base.is_jmp = DISAS_NORETURN;
     gen_exception_debug();
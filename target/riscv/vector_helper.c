@@ -0,0 +1,451 @@
+/*
+ * RISC-V Vector Extension Helpers for QEMU.
+ *
+ * Copyright (c) 2020 SiFive, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2 or later, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+#include "exec/memop.h"
+#include "exec/exec-all.h"
+#include "exec/helper-proto.h"
+#include "exec/cpu_ldst.h"
+#include "tcg/tcg-gvec-desc.h"
+#include "internals.h"
+
+target_ulong HELPER(vsetvl)(CPURISCVState *env, target_ulong s1,
+                            target_ulong s2)
+{
+    RISCVCPU *cpu = env_archcpu(env);
+    uint64_t lmul = FIELD_EX64(s2, VTYPE, VLMUL);
+    uint16_t sew = 8 << FIELD_EX64(s2, VTYPE, VSEW);
+    target_ulong vlmax, vl;
+
+    /* Fractional LMUL settings are not supported */
+    if (lmul > 3 || sew > cpu->cfg.elen ||
+        FIELD_EX64(s2, VTYPE, VILL) ||
+        FIELD_EX64(s2, VTYPE, RESERVED) != 0) {
+        env->vtype = FIELD_DP64(0, VTYPE, VILL, 1);
+        env->vl = 0;
+        env->vstart = 0;
+        return 0;
+    }
+
+    vlmax = vext_get_vlmax(cpu, s2);
+    vl = MIN(s1, vlmax);
+
+    env->vl = vl;
+    env->vtype = s2;
+    env->vstart = 0;
+    return vl;
+}
+
+/*
+ * Note that vector data is stored in host-endian 64-bit chunks,
+ * so addressing units smaller than that needs a host-endian fixup.
+ */
+#ifdef HOST_WORDS_BIGENDIAN
+#define H1(x)   ((x) ^ 7)
+#define H2(x)   ((x) ^ 3)
+#define H4(x)   ((x) ^ 1)
+#define H8(x)   ((x))
+#else
+#define H1(x)   (x)
+#define H2(x)   (x)
+#define H4(x)   (x)
+#define H8(x)   (x)
+#endif
+
+static inline uint32_t vext_vm(uint32_t desc)
+{
+    return FIELD_EX32(simd_data(desc), VDATA, VM);
+}
+
+/* Mask element i is bit i of v0, regardless of SEW and LMUL */
+static inline int vext_elem_mask(void *v0, int index)
+{
+    int idx = index / 64;
+    int pos = index % 64;
+    return (((uint64_t *)v0)[idx] >> pos) & 1;
+}
+
+static inline void vext_set_elem_mask(void *vd, int index, uint8_t value)
+{
+    int idx = index / 64;
+    int pos = index % 64;
+    uint64_t old = ((uint64_t *)vd)[idx];
+    ((uint64_t *)vd)[idx] = deposit64(old, pos, 1, value);
+}
+
+/*
+ *** Vector loads and stores
+ *
+ * Elements are accessed in order and vstart tracks the element being
+ * accessed, so a trap leaves vstart at the faulting element as the
+ * specification requires.  Tail and masked-off elements are left
+ * undisturbed, which satisfies both the agnostic and undisturbed policies.
+ */
+typedef void vext_ldst_elem_fn(CPURISCVState *env, target_ulong addr,
+                               void *vd, uint32_t idx, uintptr_t retaddr);
+typedef void vext_ldst_host_fn(void *vd, uint32_t idx, void *host);
+
+#define GEN_VEXT_LD_ELEM(NAME, ETYPE, H, LDSUF)              \
+static void NAME(CPURISCVState *env, target_ulong addr,      \
+                 void *vd, uint32_t idx, uintptr_t retaddr)  \
+{                                                            \
+    *((ETYPE *)vd + H(idx)) =                                \
+        cpu_##LDSUF##_data_ra(env, addr, retaddr);           \
+}                                                            \
+static void NAME##_host(void *vd, uint32_t idx, void *host)  \
+{                                                            \
+    *((ETYPE *)vd + H(idx)) = LDSUF##_p(host);               \
+}
+
+GEN_VEXT_LD_ELEM(lde_b, uint8_t,  H1, ldub)
+GEN_VEXT_LD_ELEM(lde_h, uint16_t, H2, lduw_le)
+GEN_VEXT_LD_ELEM(lde_w, uint32_t, H4, ldl_le)
+GEN_VEXT_LD_ELEM(lde_d, uint64_t, H8, ldq_le)
+
+#define GEN_VEXT_ST_ELEM(NAME, ETYPE, H, STSUF)              \
+static void NAME(CPURISCVState *env, target_ulong addr,      \
+                 void *vd, uint32_t idx, uintptr_t retaddr)  \
+{                                                            \
+    cpu_##STSUF##_data_ra(env, addr,                         \
+                          *((ETYPE *)vd + H(idx)), retaddr); \
+}                                                            \
+static void NAME##_host(void *vd, uint32_t idx, void *host)  \
+{                                                            \
+    STSUF##_p(host, *((ETYPE *)vd + H(idx)));                \
+}
+
+GEN_VEXT_ST_ELEM(ste_b, uint8_t,  H1, stb)
+GEN_VEXT_ST_ELEM(ste_h, uint16_t, H2, stw_le)
+GEN_VEXT_ST_ELEM(ste_w, uint32_t, H4, stl_le)
+GEN_VEXT_ST_ELEM(ste_d, uint64_t, H8, stq_le)
+
+static void vext_ldst_stride(void *vd, void *v0, target_ulong base,
+                             target_ulong stride, CPURISCVState *env,
+                             uint32_t desc, vext_ldst_elem_fn *ldst_elem,
+                             uintptr_t ra)
+{
+    uint32_t vm = vext_vm(desc);
+    uint32_t i;
+
+    for (i = env->vstart; i < env->vl; i++) {
+        if (!vm && !vext_elem_mask(v0, i)) {
+            continue;
+        }
+        env->vstart = i;
+        ldst_elem(env, base + stride * i, vd, i, ra);
+    }
+    env->vstart = 0;
+}
+
+static void vext_ldst_us(void *vd, void *v0, target_ulong base,
+                         CPURISCVState *env, uint32_t desc, uint32_t esz,
+                         vext_ldst_elem_fn *ldst_elem,
+                         vext_ldst_host_fn *ldst_host,
+                         MMUAccessType access_type, uintptr_t ra)
+{
+    uint32_t vstart = env->vstart;
+    uint32_t vl = env->vl;
+    target_ulong addr = base + vstart * esz;
+    uint32_t len = (vl - vstart) * esz;
+    uint32_t i;
+    void *host;
+
+    /*
+     * An unmasked access that does not cross a page can be checked
+     * with a single probe and then performed on host memory directly.
+     */
+    if (vext_vm(desc) && vstart < vl &&
+        -(addr | TARGET_PAGE_MASK) >= len) {
+        host = probe_access(env, addr, len, access_type,
+                            cpu_mmu_index(env, false), ra);
+        if (host) {
+            for (i = vstart; i < vl; i++) {
+                ldst_host(vd, i, host + (i - vstart) * esz);
+            }
+            env->vstart = 0;
+            return;
+        }
+    }
+
+    vext_ldst_stride(vd, v0, base, esz, env, desc, ldst_elem, ra);
+}
+
+#define GEN_VEXT_LD_US(NAME, ESZ, LOAD_FN)                            \
+void HELPER(NAME)(void *vd, void *v0, target_ulong base,              \
+                  CPURISCVState *env, uint32_t desc)                  \
+{                                                                     \
+    vext_ldst_us(vd, v0, base, env, desc, ESZ, LOAD_FN,               \
+                 LOAD_FN##_host, MMU_DATA_LOAD, GETPC());             \
+}
+
+GEN_VEXT_LD_US(vle8_v,  1, lde_b)
+GEN_VEXT_LD_US(vle16_v, 2, lde_h)
+GEN_VEXT_LD_US(vle32_v, 4, lde_w)
+GEN_VEXT_LD_US(vle64_v, 8, lde_d)
+
+#define GEN_VEXT_ST_US(NAME, ESZ, STORE_FN)                           \
+void HELPER(NAME)(void *vd, void *v0, target_ulong base,              \
+                  CPURISCVState *env, uint32_t desc)                  \
+{                                                                     \
+    vext_ldst_us(vd, v0, base, env, desc, ESZ, STORE_FN,              \
+                 STORE_FN##_host, MMU_DATA_STORE, GETPC());           \
+}
+
+GEN_VEXT_ST_US(vse8_v,  1, ste_b)
+GEN_VEXT_ST_US(vse16_v, 2, ste_h)
+GEN_VEXT_ST_US(vse32_v, 4, ste_w)
+GEN_VEXT_ST_US(vse64_v, 8, ste_d)
+
+#define GEN_VEXT_LDST_STRIDE(NAME, LDST_FN)                           \
+void HELPER(NAME)(void *vd, void *v0, target_ulong base,              \
+                  target_ulong stride, CPURISCVState *env,            \
+                  uint32_t desc)                                      \
+{                                                                     \
+    vext_ldst_stride(vd, v0, base, stride, env, desc, LDST_FN,        \
+                     GETPC());                                        \
+}
+
+GEN_VEXT_LDST_STRIDE(vlse8_v,  lde_b)
+GEN_VEXT_LDST_STRIDE(vlse16_v, lde_h)
+GEN_VEXT_LDST_STRIDE(vlse32_v, lde_w)
+GEN_VEXT_LDST_STRIDE(vlse64_v, lde_d)
+GEN_VEXT_LDST_STRIDE(vsse8_v,  ste_b)
+GEN_VEXT_LDST_STRIDE(vsse16_v, ste_h)
+GEN_VEXT_LDST_STRIDE(vsse32_v, ste_w)
+GEN_VEXT_LDST_STRIDE(vsse64_v, ste_d)
+
+/*
+ *** Vector Integer Arithmetic Instructions
+ *
+ * These out-of-line versions handle masking and vl < VLMAX; the unmasked
+ * full-length cases are expanded inline with tcg-op-gvec.
+ */
+typedef void opivv2_fn(void *vd, void *vs1, void *vs2, int i);
+typedef void opivx2_fn(void *vd, target_long s1, void *vs2, int i);
+
+#define DO_ADD(N, M)  (N + M)
+#define DO_SUB(N, M)  (N - M)
+#define DO_RSUB(N, M) (M - N)
+#define DO_AND(N, M)  (N & M)
+#define DO_OR(N, M)   (N | M)
+#define DO_XOR(N, M)  (N ^ M)
+#define DO_MAX(N, M)  ((N) >= (M) ? (N) : (M))
+#define DO_MIN(N, M)  ((N) >= (M) ? (M) : (N))
+#define DO_MUL(N, M)  ((uint64_t)(N) * (M))
+#define DO_SLL(N, M)  ((uint64_t)(N) << ((M) & (sizeof(N) * 8 - 1)))
+#define DO_SR(N, M)   ((N) >> ((M) & (sizeof(N) * 8 - 1)))
+#define DO_MSEQ(N, M) (N == M)
+#define DO_MSNE(N, M) (N != M)
+#define DO_MSLT(N, M) (N < M)
+#define DO_MSLE(N, M) (N <= M)
+#define DO_MSGT(N, M) (N > M)
+
+static void do_vext_vv(void *vd, void *v0, void *vs1, void *vs2,
+                       CPURISCVState *env, uint32_t desc, opivv2_fn *fn)
+{
+    uint32_t vm = vext_vm(desc);
+    uint32_t i;
+
+    for (i = env->vstart; i < env->vl; i++) {
+        if (!vm && !vext_elem_mask(v0, i)) {
+            continue;
+        }
+        fn(vd, vs1, vs2, i);
+    }
+    env->vstart = 0;
+}
+
+static void do_vext_vx(void *vd, void *v0, target_long s1, void *vs2,
+                       CPURISCVState *env, uint32_t desc, opivx2_fn *fn)
+{
+    uint32_t vm = vext_vm(desc);
+    uint32_t i;
+
+    for (i = env->vstart; i < env->vl; i++) {
+        if (!vm && !vext_elem_mask(v0, i)) {
+            continue;
+        }
+        fn(vd, s1, vs2, i);
+    }
+    env->vstart = 0;
+}
+
+/* Element-wise operations producing an element of the same width */
+#define OPIVV2(NAME, ETYPE, H, OP)                                    \
+static void do_##NAME(void *vd, void *vs1, void *vs2, int i)         \
+{                                                                    \
+    ETYPE s1 = *((ETYPE *)vs1 + H(i));                               \
+    ETYPE s2 = *((ETYPE *)vs2 + H(i));                               \
+    *((ETYPE *)vd + H(i)) = OP(s2, s1);                              \
+}                                                                    \
+void HELPER(NAME)(void *vd, void *v0, void *vs1, void *vs2,          \
+                  CPURISCVState *env, uint32_t desc)                 \
+{                                                                    \
+    do_vext_vv(vd, v0, vs1, vs2, env, desc, do_##NAME);              \
+}
+
+#define OPIVX2(NAME, ETYPE, H, OP)                                    \
+static void do_##NAME(void *vd, target_long s1, void *vs2, int i)    \
+{                                                                    \
+    ETYPE s2 = *((ETYPE *)vs2 + H(i));                               \
+    *((ETYPE *)vd + H(i)) = OP(s2, (ETYPE)s1);                       \
+}                                                                    \
+void HELPER(NAME)(void *vd, void *v0, target_ulong s1, void *vs2,    \
+                  CPURISCVState *env, uint32_t desc)                 \
+{                                                                    \
+    do_vext_vx(vd, v0, s1, vs2, env, desc, do_##NAME);               \
+}
+
+/* Integer compares writing one bit of the destination mask per element */
+#define OPIVV_CMP(NAME, ETYPE, H, OP)                                 \
+static void do_##NAME(void *vd, void *vs1, void *vs2, int i)         \
+{                                                                    \
+    ETYPE s1 = *((ETYPE *)vs1 + H(i));                               \
+    ETYPE s2 = *((ETYPE *)vs2 + H(i));                               \
+    vext_set_elem_mask(vd, i, OP(s2, s1));                           \
+}                                                                    \
+void HELPER(NAME)(void *vd, void *v0, void *vs1, void *vs2,          \
+                  CPURISCVState *env, uint32_t desc)                 \
+{                                                                    \
+    do_vext_vv(vd, v0, vs1, vs2, env, desc, do_##NAME);              \
+}
+
+#define OPIVX_CMP(NAME, ETYPE, H, OP)                                 \
+static void do_##NAME(void *vd, target_long s1, void *vs2, int i)    \
+{                                                                    \
+    ETYPE s2 = *((ETYPE *)vs2 + H(i));                               \
+    vext_set_elem_mask(vd, i, OP(s2, (ETYPE)s1));                    \
+}                                                                    \
+void HELPER(NAME)(void *vd, void *v0, target_ulong s1, void *vs2,    \
+                  CPURISCVState *env, uint32_t desc)                 \
+{                                                                    \
+    do_vext_vx(vd, v0, s1, vs2, env, desc, do_##NAME);               \
+}
+
+#define GEN_VEXT_BHWD(GEN, NAME, SIGN, OP)                      \
+GEN(NAME##_b, SIGN##int8_t,  H1, OP)                                 \
+GEN(NAME##_h, SIGN##int16_t, H2, OP)                                 \
+GEN(NAME##_w, SIGN##int32_t, H4, OP)                                 \
+GEN(NAME##_d, SIGN##int64_t, H8, OP)
+
+/* Vector Single-Width Integer Add and Subtract */
+GEN_VEXT_BHWD(OPIVV2, vadd_vv, u, DO_ADD)
+GEN_VEXT_BHWD(OPIVV2, vsub_vv, u, DO_SUB)
+GEN_VEXT_BHWD(OPIVX2, vadd_vx, u, DO_ADD)
+GEN_VEXT_BHWD(OPIVX2, vsub_vx, u, DO_SUB)
+GEN_VEXT_BHWD(OPIVX2, vrsub_vx, u, DO_RSUB)
+
+/* Vector Bitwise Logical Instructions */
+GEN_VEXT_BHWD(OPIVV2, vand_vv, u, DO_AND)
+GEN_VEXT_BHWD(OPIVV2, vor_vv, u, DO_OR)
+GEN_VEXT_BHWD(OPIVV2, vxor_vv, u, DO_XOR)
+GEN_VEXT_BHWD(OPIVX2, vand_vx, u, DO_AND)
+GEN_VEXT_BHWD(OPIVX2, vor_vx, u, DO_OR)
+GEN_VEXT_BHWD(OPIVX2, vxor_vx, u, DO_XOR)
+
+/* Vector Single-Width Bit Shift Instructions */
+GEN_VEXT_BHWD(OPIVV2, vsll_vv, u, DO_SLL)
+GEN_VEXT_BHWD(OPIVV2, vsrl_vv, u, DO_SR)
+GEN_VEXT_BHWD(OPIVV2, vsra_vv, , DO_SR)
+GEN_VEXT_BHWD(OPIVX2, vsll_vx, u, DO_SLL)
+GEN_VEXT_BHWD(OPIVX2, vsrl_vx, u, DO_SR)
+GEN_VEXT_BHWD(OPIVX2, vsra_vx, , DO_SR)
+
+/* Vector Integer Min/Max Instructions */
+GEN_VEXT_BHWD(OPIVV2, vminu_vv, u, DO_MIN)
+GEN_VEXT_BHWD(OPIVV2, vmin_vv, , DO_MIN)
+GEN_VEXT_BHWD(OPIVV2, vmaxu_vv, u, DO_MAX)
+GEN_VEXT_BHWD(OPIVV2, vmax_vv, , DO_MAX)
+GEN_VEXT_BHWD(OPIVX2, vminu_vx, u, DO_MIN)
+GEN_VEXT_BHWD(OPIVX2, vmin_vx, , DO_MIN)
+GEN_VEXT_BHWD(OPIVX2, vmaxu_vx, u, DO_MAX)
+GEN_VEXT_BHWD(OPIVX2, vmax_vx, , DO_MAX)
+
+/* Vector Single-Width Integer Multiply Instructions */
+GEN_VEXT_BHWD(OPIVV2, vmul_vv, u, DO_MUL)
+GEN_VEXT_BHWD(OPIVX2, vmul_vx, u, DO_MUL)
+
+/* Vector Integer Comparison Instructions */
+GEN_VEXT_BHWD(OPIVV_CMP, vmseq_vv, u, DO_MSEQ)
+GEN_VEXT_BHWD(OPIVV_CMP, vmsne_vv, u, DO_MSNE)
+GEN_VEXT_BHWD(OPIVV_CMP, vmsltu_vv, u, DO_MSLT)
+GEN_VEXT_BHWD(OPIVV_CMP, vmslt_vv, , DO_MSLT)
+GEN_VEXT_BHWD(OPIVV_CMP, vmsleu_vv, u, DO_MSLE)
+GEN_VEXT_BHWD(OPIVV_CMP, vmsle_vv, , DO_MSLE)
+GEN_VEXT_BHWD(OPIVX_CMP, vmseq_vx, u, DO_MSEQ)
+GEN_VEXT_BHWD(OPIVX_CMP, vmsne_vx, u, DO_MSNE)
+GEN_VEXT_BHWD(OPIVX_CMP, vmsltu_vx, u, DO_MSLT)
+GEN_VEXT_BHWD(OPIVX_CMP, vmslt_vx, , DO_MSLT)
+GEN_VEXT_BHWD(OPIVX_CMP, vmsleu_vx, u, DO_MSLE)
+GEN_VEXT_BHWD(OPIVX_CMP, vmsle_vx, , DO_MSLE)
+GEN_VEXT_BHWD(OPIVX_CMP, vmsgtu_vx, u, DO_MSGT)
+GEN_VEXT_BHWD(OPIVX_CMP, vmsgt_vx, , DO_MSGT)
+
+/* Vector Integer Merge and Move Instructions */
+#define GEN_VEXT_VMERGE(NAME, ETYPE, H)                               \
+void HELPER(vmerge_vvm_##NAME)(void *vd, void *v0, void *vs1,        \
+                               void *vs2, CPURISCVState *env,        \
+                               uint32_t desc)                        \
+{                                                                    \
+    uint32_t i;                                                      \
+                                                                     \
+    for (i = env->vstart; i < env->vl; i++) {                        \
+        ETYPE *vt = (!vext_elem_mask(v0, i) ? vs2 : vs1);            \
+        *((ETYPE *)vd + H(i)) = *(vt + H(i));                        \
+    }                                                                \
+    env->vstart = 0;                                                 \
+}                                                                    \
+void HELPER(vmerge_vxm_##NAME)(void *vd, void *v0, target_ulong s1,  \
+                               void *vs2, CPURISCVState *env,        \
+                               uint32_t desc)                        \
+{                                                                    \
+    uint32_t i;                                                      \
+                                                                     \
+    for (i = env->vstart; i < env->vl; i++) {                        \
+        ETYPE s2 = *((ETYPE *)vs2 + H(i));                           \
+        *((ETYPE *)vd + H(i)) =                                      \
+            (!vext_elem_mask(v0, i) ? s2 : (ETYPE)s1);               \
+    }                                                                \
+    env->vstart = 0;                                                 \
+}                                                                    \
+void HELPER(vmv_v_v_##NAME)(void *vd, void *vs1,                     \
+                            CPURISCVState *env, uint32_t desc)       \
+{                                                                    \
+    uint32_t i;                                                      \
+                                                                     \
+    for (i = env->vstart; i < env->vl; i++) {                        \
+        *((ETYPE *)vd + H(i)) = *((ETYPE *)vs1 + H(i));              \
+    }                                                                \
+    env->vstart = 0;                                                 \
+}                                                                    \
+void HELPER(vmv_v_x_##NAME)(void *vd, target_ulong s1,               \
+                            CPURISCVState *env, uint32_t desc)       \
+{                                                                    \
+    uint32_t i;                                                      \
+                                                                     \
+    for (i = env->vstart; i < env->vl; i++) {                        \
+        *((ETYPE *)vd + H(i)) = (ETYPE)s1;                           \
+    }                                                                \
+    env->vstart = 0;                                                 \
+}
+
+GEN_VEXT_VMERGE(b, uint8_t,  H1)
+GEN_VEXT_VMERGE(h, uint16_t, H2)
+GEN_VEXT_VMERGE(w, uint32_t, H4)
+GEN_VEXT_VMERGE(d, uint64_t, H8)
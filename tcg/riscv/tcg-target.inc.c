@@ -27,6 +27,7 @@
  * THE SOFTWARE.
  */
 
+#include "elf.h"
 #include "../tcg-pool.inc.c"
 
 #ifdef CONFIG_DEBUG_TCG
@@ -62,7 +63,12 @@ static const char * const tcg_target_reg_names[TCG_TARGET_NB_REGS] = {
     "t3",
     "t4",
     "t5",
-    "t6"
+    "t6",
+
+    "v0",  "v1",  "v2",  "v3",  "v4",  "v5",  "v6",  "v7",
+    "v8",  "v9",  "v10", "v11", "v12", "v13", "v14", "v15",
+    "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23",
+    "v24", "v25", "v26", "v27", "v28", "v29", "v30", "v31",
 };
 #endif
 
@@ -99,6 +105,40 @@ static const int tcg_target_reg_alloc_order[] = {
     TCG_REG_A5,
     TCG_REG_A6,
     TCG_REG_A7,
+
+    /* Vector registers, all call clobbered */
+    /* TCG_REG_V0 reserved for comparison masks */
+    TCG_REG_V1,
+    TCG_REG_V2,
+    TCG_REG_V3,
+    TCG_REG_V4,
+    TCG_REG_V5,
+    TCG_REG_V6,
+    TCG_REG_V7,
+    TCG_REG_V8,
+    TCG_REG_V9,
+    TCG_REG_V10,
+    TCG_REG_V11,
+    TCG_REG_V12,
+    TCG_REG_V13,
+    TCG_REG_V14,
+    TCG_REG_V15,
+    TCG_REG_V16,
+    TCG_REG_V17,
+    TCG_REG_V18,
+    TCG_REG_V19,
+    TCG_REG_V20,
+    TCG_REG_V21,
+    TCG_REG_V22,
+    TCG_REG_V23,
+    TCG_REG_V24,
+    TCG_REG_V25,
+    TCG_REG_V26,
+    TCG_REG_V27,
+    TCG_REG_V28,
+    TCG_REG_V29,
+    TCG_REG_V30,
+    TCG_REG_V31,
 };
 
 static const int tcg_target_call_iarg_regs[] = {
@@ -122,6 +162,11 @@ static const int tcg_target_call_oarg_regs[] = {
 #define TCG_CT_CONST_N12   0x400
 #define TCG_CT_CONST_M12   0x800
 
+#define ALL_GENERAL_REGS   0x00000000ffffffffull
+#define ALL_VECTOR_REGS    0xffffffff00000000ull
+
+bool have_rvv;
+
 static inline tcg_target_long sextreg(tcg_target_long val, int pos, int len)
 {
     if (TCG_TARGET_REG_BITS == 32) {
@@ -138,12 +183,16 @@ static const char *target_parse_constraint(TCGArgConstraint *ct,
     switch (*ct_str++) {
     case 'r':
         ct->ct |= TCG_CT_REG;
-        ct->u.regs = 0xffffffff;
+        ct->u.regs |= ALL_GENERAL_REGS;
+        break;
+    case 'v':
+        ct->ct |= TCG_CT_REG;
+        ct->u.regs |= ALL_VECTOR_REGS;
         break;
     case 'L':
         /* qemu_ld/qemu_st constraint */
         ct->ct |= TCG_CT_REG;
-        ct->u.regs = 0xffffffff;
+        ct->u.regs = ALL_GENERAL_REGS;
         /* qemu_ld/qemu_st uses TCG_REG_TMP0 */
 #if defined(CONFIG_SOFTMMU)
         tcg_regset_reset_reg(ct->u.regs, tcg_target_call_iarg_regs[0]);
@@ -283,6 +332,50 @@ typedef enum {
 #endif
 
     OPC_FENCE = 0x0000000f,
+
+    /* Vector extension (RVV 1.0), all unmasked unless noted */
+    OPC_VSETIVLI = 0xc0007057,
+    OPC_VLE8_V = 0x02000007,
+    OPC_VSE8_V = 0x02000027,
+    OPC_VMV1R_V = 0x9e003057,
+    OPC_VMV_X_S = 0x42002057,
+    OPC_VMV_V_X = 0x5e004057,
+    OPC_VMV_V_I = 0x5e003057,
+    OPC_VMERGE_VIM = 0x5c003057, /* masked by v0 */
+
+    OPC_VADD_VV = 0x02000057,
+    OPC_VSUB_VV = 0x0a000057,
+    OPC_VRSUB_VI = 0x0e003057,
+    OPC_VMUL_VV = 0x96002057,
+    OPC_VAND_VV = 0x26000057,
+    OPC_VOR_VV = 0x2a000057,
+    OPC_VXOR_VV = 0x2e000057,
+    OPC_VXOR_VI = 0x2e003057,
+    OPC_VMINU_VV = 0x12000057,
+    OPC_VMIN_VV = 0x16000057,
+    OPC_VMAXU_VV = 0x1a000057,
+    OPC_VMAX_VV = 0x1e000057,
+    OPC_VSADDU_VV = 0x82000057,
+    OPC_VSADD_VV = 0x86000057,
+    OPC_VSSUBU_VV = 0x8a000057,
+    OPC_VSSUB_VV = 0x8e000057,
+
+    OPC_VSLL_VV = 0x96000057,
+    OPC_VSLL_VX = 0x96004057,
+    OPC_VSLL_VI = 0x96003057,
+    OPC_VSRL_VV = 0xa2000057,
+    OPC_VSRL_VX = 0xa2004057,
+    OPC_VSRL_VI = 0xa2003057,
+    OPC_VSRA_VV = 0xa6000057,
+    OPC_VSRA_VX = 0xa6004057,
+    OPC_VSRA_VI = 0xa6003057,
+
+    OPC_VMSEQ_VV = 0x62000057,
+    OPC_VMSNE_VV = 0x66000057,
+    OPC_VMSLTU_VV = 0x6a000057,
+    OPC_VMSLT_VV = 0x6e000057,
+    OPC_VMSLEU_VV = 0x72000057,
+    OPC_VMSLE_VV = 0x76000057,
 } RISCVInsn;
 
 /*
@@ -415,6 +508,27 @@ static void tcg_out_opc_jump(TCGContext *s, RISCVInsn opc,
     tcg_out32(s, encode_uj(opc, rd, imm));
 }
 
+/* Type-V: vd, vs2, and vs1, rs1 or a 5-bit immediate */
+
+static void tcg_out_opc_vec(TCGContext *s, RISCVInsn opc,
+                            TCGReg vd, TCGReg vs2, uint32_t vs1)
+{
+    tcg_out32(s, opc | (vd & 0x1f) << 7 | (vs1 & 0x1f) << 15 |
+              (vs2 & 0x1f) << 20);
+}
+
+/*
+ * Set vl to cover BYTES bytes of VECE-sized elements, with LMUL=1 and
+ * tail/mask agnostic policy.  vl and vtype do not survive calls, so
+ * this is emitted in front of every vector operation.
+ */
+static void tcg_out_vsetivli(TCGContext *s, unsigned bytes, unsigned vece)
+{
+    uint32_t vtype = 0xc0 | vece << 3;
+
+    tcg_out32(s, OPC_VSETIVLI | (bytes >> vece) << 15 | vtype << 20);
+}
+
 static void tcg_out_nop_fill(tcg_insn_unit *p, int count)
 {
     int i;
@@ -455,7 +569,7 @@ static bool reloc_call(tcg_insn_unit *code_ptr, tcg_insn_unit *target)
 {
     intptr_t offset = (intptr_t)target - (intptr_t)code_ptr;
     int32_t lo = sextreg(offset, 0, 12);
-    int32_t hi = offset - lo;
+    ptrdiff_t hi = offset - lo;
 
     if (offset == hi + lo) {
         code_ptr[0] |= encode_uimm20(hi);
@@ -523,8 +637,17 @@ static bool tcg_out_mov(TCGContext *s, TCGType type, TCGReg ret, TCGReg arg)
     switch (type) {
     case TCG_TYPE_I32:
     case TCG_TYPE_I64:
+        if (ret >= TCG_REG_V0 || arg >= TCG_REG_V0) {
+            /* Cross register class moves go through memory */
+            return false;
+        }
         tcg_out_opc_imm(s, OPC_ADDI, ret, arg, 0);
         break;
+    case TCG_TYPE_V64:
+    case TCG_TYPE_V128:
+        tcg_debug_assert(ret >= TCG_REG_V0 && arg >= TCG_REG_V0);
+        tcg_out_opc_vec(s, OPC_VMV1R_V, ret, arg, 0);
+        break;
     default:
         g_assert_not_reached();
     }
@@ -537,6 +660,11 @@ static void tcg_out_movi(TCGContext *s, TCGType type, TCGReg rd,
     tcg_target_long lo, hi, tmp;
     int shift, ret;
 
+    if (type == TCG_TYPE_V64 || type == TCG_TYPE_V128) {
+        tcg_out_dupi_vec(s, type, rd, val);
+        return;
+    }
+
     if (TCG_TARGET_REG_BITS == 64 && type == TCG_TYPE_I32) {
         val = (int32_t)val;
     }
@@ -673,10 +801,40 @@ static void tcg_out_ldst(TCGContext *s, RISCVInsn opc, TCGReg data,
     }
 }
 
+static void tcg_out_vec_ldst(TCGContext *s, RISCVInsn opc, TCGReg data,
+                             TCGReg addr, intptr_t offset, TCGType type)
+{
+    static const uint8_t type_bytes[] = {
+        [TCG_TYPE_I32] = 4,
+        [TCG_TYPE_I64] = 8,
+        [TCG_TYPE_V64] = 8,
+        [TCG_TYPE_V128] = 16,
+    };
+
+    if (offset != 0) {
+        if (offset == sextreg(offset, 0, 12)) {
+            tcg_out_opc_imm(s, OPC_ADDI, TCG_REG_TMP0, addr, offset);
+        } else {
+            tcg_out_movi(s, TCG_TYPE_PTR, TCG_REG_TMP0, offset);
+            tcg_out_opc_reg(s, OPC_ADD, TCG_REG_TMP0, TCG_REG_TMP0, addr);
+        }
+        addr = TCG_REG_TMP0;
+    }
+
+    /* Byte elements make the access size independent of the element size */
+    tcg_out_vsetivli(s, type_bytes[type], MO_8);
+    tcg_out_opc_vec(s, opc, data, TCG_REG_ZERO, addr);
+}
+
 static void tcg_out_ld(TCGContext *s, TCGType type, TCGReg arg,
                        TCGReg arg1, intptr_t arg2)
 {
     bool is32bit = (TCG_TARGET_REG_BITS == 32 || type == TCG_TYPE_I32);
+
+    if (arg >= TCG_REG_V0) {
+        tcg_out_vec_ldst(s, OPC_VLE8_V, arg, arg1, arg2, type);
+        return;
+    }
     tcg_out_ldst(s, is32bit ? OPC_LW : OPC_LD, arg, arg1, arg2);
 }
 
@@ -684,13 +842,18 @@ static void tcg_out_st(TCGContext *s, TCGType type, TCGReg arg,
                        TCGReg arg1, intptr_t arg2)
 {
     bool is32bit = (TCG_TARGET_REG_BITS == 32 || type == TCG_TYPE_I32);
+
+    if (arg >= TCG_REG_V0) {
+        tcg_out_vec_ldst(s, OPC_VSE8_V, arg, arg1, arg2, type);
+        return;
+    }
     tcg_out_ldst(s, is32bit ? OPC_SW : OPC_SD, arg, arg1, arg2);
 }
 
 static bool tcg_out_sti(TCGContext *s, TCGType type, TCGArg val,
                         TCGReg base, intptr_t ofs)
 {
-    if (val == 0) {
+    if (val == 0 && (type == TCG_TYPE_I32 || type == TCG_TYPE_I64)) {
         tcg_out_st(s, type, TCG_REG_ZERO, base, ofs);
         return true;
     }
@@ -865,6 +1028,34 @@ static inline void tcg_out_goto(TCGContext *s, tcg_insn_unit *target)
     tcg_out_opc_jump(s, OPC_JAL, TCG_REG_ZERO, offset);
 }
 
+void tb_target_set_jmp_target(uintptr_t tc_ptr, uintptr_t jmp_addr,
+                              uintptr_t addr)
+{
+    ptrdiff_t offset = addr - jmp_addr;
+    int32_t lo = sextreg(offset, 0, 12);
+    ptrdiff_t hi = offset - lo;
+    tcg_insn_unit i1, i2;
+
+    if (offset == sextreg(offset, 1, 20) << 1) {
+        /* short jump: JAL followed by a NOP */
+        i1 = encode_uj(OPC_JAL, TCG_REG_ZERO, offset);
+        i2 = encode_i(OPC_ADDI, TCG_REG_ZERO, TCG_REG_ZERO, 0);
+    } else {
+        /* long jump: MAX_CODE_GEN_BUFFER_SIZE keeps the whole code buffer
+           within the reach of AUIPC+JALR */
+        tcg_debug_assert(hi == (int32_t)hi);
+        i1 = encode_u(OPC_AUIPC, TCG_REG_TMP0, hi);
+        i2 = encode_i(OPC_JALR, TCG_REG_ZERO, TCG_REG_TMP0, lo);
+    }
+#if TCG_TARGET_REG_BITS == 64
+    atomic_set((uint64_t *)jmp_addr, (uint64_t)i2 << 32 | i1);
+    flush_icache_range(jmp_addr, jmp_addr + 8);
+#else
+    /* TCG_TARGET_HAS_direct_jump is only set for 64-bit hosts */
+    g_assert_not_reached();
+#endif
+}
+
 static void tcg_out_call_int(TCGContext *s, tcg_insn_unit *arg, bool tail)
 {
     TCGReg link = tail ? TCG_REG_ZERO : TCG_REG_RA;
@@ -1300,11 +1491,25 @@ static void tcg_out_op(TCGContext *s, TCGOpcode opc,
         break;
 
     case INDEX_op_goto_tb:
-        assert(s->tb_jmp_insn_offset == 0);
-        /* indirect jump method */
-        tcg_out_ld(s, TCG_TYPE_PTR, TCG_REG_TMP0, TCG_REG_ZERO,
-                   (uintptr_t)(s->tb_jmp_target_addr + a0));
-        tcg_out_opc_imm(s, OPC_JALR, TCG_REG_ZERO, TCG_REG_TMP0, 0);
+        if (s->tb_jmp_insn_offset != NULL) {
+            /* TCG_TARGET_HAS_direct_jump */
+            /* Ensure that AUIPC+JALR are 8-byte aligned so that an atomic
+               write can be used to patch the target address. */
+            if ((uintptr_t)s->code_ptr & 7) {
+                tcg_out_opc_imm(s, OPC_ADDI, TCG_REG_ZERO, TCG_REG_ZERO, 0);
+            }
+            s->tb_jmp_insn_offset[a0] = tcg_current_code_size(s);
+            /* actual branch destination will be patched by
+               tb_target_set_jmp_target later. */
+            tcg_out_opc_upper(s, OPC_AUIPC, TCG_REG_TMP0, 0);
+            tcg_out_opc_imm(s, OPC_JALR, TCG_REG_ZERO, TCG_REG_TMP0, 0);
+        } else {
+            /* indirect jump method */
+            tcg_debug_assert(s->tb_jmp_target_addr != NULL);
+            tcg_out_ld(s, TCG_TYPE_PTR, TCG_REG_TMP0, TCG_REG_ZERO,
+                       (uintptr_t)(s->tb_jmp_target_addr + a0));
+            tcg_out_opc_imm(s, OPC_JALR, TCG_REG_ZERO, TCG_REG_TMP0, 0);
+        }
         set_jmp_reset_offset(s, a0);
         break;
 
@@ -1614,6 +1819,253 @@ static void tcg_out_op(TCGContext *s, TCGOpcode opc,
     }
 }
 
+static bool tcg_out_dup_vec(TCGContext *s, TCGType type, unsigned vece,
+                            TCGReg dst, TCGReg src)
+{
+    unsigned bytes = type == TCG_TYPE_V64 ? 8 : 16;
+
+    tcg_out_vsetivli(s, bytes, vece);
+    if (src >= TCG_REG_V0) {
+        /* Replicate element 0 of a vector register */
+        tcg_out_opc_vec(s, OPC_VMV_X_S, TCG_REG_TMP0, src, 0);
+        src = TCG_REG_TMP0;
+    }
+    tcg_out_opc_vec(s, OPC_VMV_V_X, dst, TCG_REG_ZERO, src);
+    return true;
+}
+
+static bool tcg_out_dupm_vec(TCGContext *s, TCGType type, unsigned vece,
+                             TCGReg dst, TCGReg base, intptr_t offset)
+{
+    static const RISCVInsn ld_insn[4] = { OPC_LB, OPC_LH, OPC_LW, OPC_LD };
+
+    tcg_out_ldst(s, ld_insn[vece], TCG_REG_TMP0, base, offset);
+    return tcg_out_dup_vec(s, type, vece, dst, TCG_REG_TMP0);
+}
+
+static void tcg_out_dupi_vec(TCGContext *s, TCGType type,
+                             TCGReg dst, tcg_target_long val)
+{
+    unsigned bytes = type == TCG_TYPE_V64 ? 8 : 16;
+    int64_t imm;
+    unsigned vece;
+
+    /* Use the narrowest element size that replicates to VAL */
+    for (vece = MO_8; vece < MO_64; vece++) {
+        if (val == dup_const(vece, val)) {
+            break;
+        }
+    }
+    imm = sextract64(val, 0, 8 << vece);
+
+    tcg_out_vsetivli(s, bytes, vece);
+    if (imm == sextract64(imm, 0, 5)) {
+        tcg_out_opc_vec(s, OPC_VMV_V_I, dst, TCG_REG_ZERO, imm);
+    } else {
+        tcg_out_movi(s, TCG_TYPE_I64, TCG_REG_TMP0, val);
+        tcg_out_opc_vec(s, OPC_VMV_V_X, dst, TCG_REG_ZERO, TCG_REG_TMP0);
+    }
+}
+
+static void tcg_out_vec_shi(TCGContext *s, RISCVInsn opc_vi, RISCVInsn opc_vx,
+                            TCGReg dst, TCGReg src, TCGArg imm)
+{
+    /* The immediate form only encodes shift counts up to 31 */
+    if (imm < 32) {
+        tcg_out_opc_vec(s, opc_vi, dst, src, imm);
+    } else {
+        tcg_out_movi(s, TCG_TYPE_I64, TCG_REG_TMP0, imm);
+        tcg_out_opc_vec(s, opc_vx, dst, src, TCG_REG_TMP0);
+    }
+}
+
+static const struct {
+    RISCVInsn op;
+    bool swap;
+} tcg_cmpcond_to_rvv[] = {
+    [TCG_COND_EQ] =  { OPC_VMSEQ_VV,  false },
+    [TCG_COND_NE] =  { OPC_VMSNE_VV,  false },
+    [TCG_COND_LT] =  { OPC_VMSLT_VV,  false },
+    [TCG_COND_GE] =  { OPC_VMSLE_VV,  true  },
+    [TCG_COND_LE] =  { OPC_VMSLE_VV,  false },
+    [TCG_COND_GT] =  { OPC_VMSLT_VV,  true  },
+    [TCG_COND_LTU] = { OPC_VMSLTU_VV, false },
+    [TCG_COND_GEU] = { OPC_VMSLEU_VV, true  },
+    [TCG_COND_LEU] = { OPC_VMSLEU_VV, false },
+    [TCG_COND_GTU] = { OPC_VMSLTU_VV, true  }
+};
+
+static void tcg_out_cmp_vec(TCGContext *s, TCGCond cond, TCGReg ret,
+                            TCGReg arg1, TCGReg arg2)
+{
+    RISCVInsn op = tcg_cmpcond_to_rvv[cond].op;
+
+    tcg_debug_assert(op != 0);
+
+    if (tcg_cmpcond_to_rvv[cond].swap) {
+        TCGReg t = arg1;
+        arg1 = arg2;
+        arg2 = t;
+    }
+
+    /* Compute a mask in v0, then expand it to 0 / -1 elements */
+    tcg_out_opc_vec(s, op, TCG_REG_VMASK, arg1, arg2);
+    tcg_out_opc_vec(s, OPC_VMV_V_I, ret, TCG_REG_ZERO, 0);
+    tcg_out_opc_vec(s, OPC_VMERGE_VIM, ret, ret, -1);
+}
+
+static void tcg_out_vec_op(TCGContext *s, TCGOpcode opc,
+                           unsigned vecl, unsigned vece,
+                           const TCGArg *args, const int *const_args)
+{
+    TCGType type = vecl + TCG_TYPE_V64;
+    TCGArg a0 = args[0], a1 = args[1], a2 = args[2];
+
+    switch (opc) {
+    case INDEX_op_ld_vec:
+        tcg_out_ld(s, type, a0, a1, a2);
+        return;
+    case INDEX_op_st_vec:
+        tcg_out_st(s, type, a0, a1, a2);
+        return;
+    case INDEX_op_dupm_vec:
+        tcg_out_dupm_vec(s, type, vece, a0, a1, a2);
+        return;
+    default:
+        break;
+    }
+
+    tcg_out_vsetivli(s, type == TCG_TYPE_V64 ? 8 : 16, vece);
+
+    switch (opc) {
+    case INDEX_op_add_vec:
+        tcg_out_opc_vec(s, OPC_VADD_VV, a0, a1, a2);
+        break;
+    case INDEX_op_sub_vec:
+        tcg_out_opc_vec(s, OPC_VSUB_VV, a0, a1, a2);
+        break;
+    case INDEX_op_mul_vec:
+        tcg_out_opc_vec(s, OPC_VMUL_VV, a0, a1, a2);
+        break;
+    case INDEX_op_neg_vec:
+        tcg_out_opc_vec(s, OPC_VRSUB_VI, a0, a1, 0);
+        break;
+    case INDEX_op_and_vec:
+        tcg_out_opc_vec(s, OPC_VAND_VV, a0, a1, a2);
+        break;
+    case INDEX_op_or_vec:
+        tcg_out_opc_vec(s, OPC_VOR_VV, a0, a1, a2);
+        break;
+    case INDEX_op_xor_vec:
+        tcg_out_opc_vec(s, OPC_VXOR_VV, a0, a1, a2);
+        break;
+    case INDEX_op_not_vec:
+        tcg_out_opc_vec(s, OPC_VXOR_VI, a0, a1, -1);
+        break;
+    case INDEX_op_smin_vec:
+        tcg_out_opc_vec(s, OPC_VMIN_VV, a0, a1, a2);
+        break;
+    case INDEX_op_umin_vec:
+        tcg_out_opc_vec(s, OPC_VMINU_VV, a0, a1, a2);
+        break;
+    case INDEX_op_smax_vec:
+        tcg_out_opc_vec(s, OPC_VMAX_VV, a0, a1, a2);
+        break;
+    case INDEX_op_umax_vec:
+        tcg_out_opc_vec(s, OPC_VMAXU_VV, a0, a1, a2);
+        break;
+    case INDEX_op_ssadd_vec:
+        tcg_out_opc_vec(s, OPC_VSADD_VV, a0, a1, a2);
+        break;
+    case INDEX_op_usadd_vec:
+        tcg_out_opc_vec(s, OPC_VSADDU_VV, a0, a1, a2);
+        break;
+    case INDEX_op_sssub_vec:
+        tcg_out_opc_vec(s, OPC_VSSUB_VV, a0, a1, a2);
+        break;
+    case INDEX_op_ussub_vec:
+        tcg_out_opc_vec(s, OPC_VSSUBU_VV, a0, a1, a2);
+        break;
+    case INDEX_op_shli_vec:
+        tcg_out_vec_shi(s, OPC_VSLL_VI, OPC_VSLL_VX, a0, a1, a2);
+        break;
+    case INDEX_op_shri_vec:
+        tcg_out_vec_shi(s, OPC_VSRL_VI, OPC_VSRL_VX, a0, a1, a2);
+        break;
+    case INDEX_op_sari_vec:
+        tcg_out_vec_shi(s, OPC_VSRA_VI, OPC_VSRA_VX, a0, a1, a2);
+        break;
+    case INDEX_op_shls_vec:
+        tcg_out_opc_vec(s, OPC_VSLL_VX, a0, a1, a2);
+        break;
+    case INDEX_op_shrs_vec:
+        tcg_out_opc_vec(s, OPC_VSRL_VX, a0, a1, a2);
+        break;
+    case INDEX_op_sars_vec:
+        tcg_out_opc_vec(s, OPC_VSRA_VX, a0, a1, a2);
+        break;
+    case INDEX_op_shlv_vec:
+        tcg_out_opc_vec(s, OPC_VSLL_VV, a0, a1, a2);
+        break;
+    case INDEX_op_shrv_vec:
+        tcg_out_opc_vec(s, OPC_VSRL_VV, a0, a1, a2);
+        break;
+    case INDEX_op_sarv_vec:
+        tcg_out_opc_vec(s, OPC_VSRA_VV, a0, a1, a2);
+        break;
+    case INDEX_op_cmp_vec:
+        tcg_out_cmp_vec(s, args[3], a0, a1, a2);
+        break;
+
+    case INDEX_op_mov_vec:  /* Always emitted via tcg_out_mov.  */
+    case INDEX_op_dupi_vec: /* Always emitted via tcg_out_movi.  */
+    case INDEX_op_dup_vec:  /* Always emitted via tcg_out_dup_vec.  */
+    default:
+        g_assert_not_reached();
+    }
+}
+
+int tcg_can_emit_vec_op(TCGOpcode opc, TCGType type, unsigned vece)
+{
+    switch (opc) {
+    case INDEX_op_add_vec:
+    case INDEX_op_sub_vec:
+    case INDEX_op_mul_vec:
+    case INDEX_op_neg_vec:
+    case INDEX_op_and_vec:
+    case INDEX_op_or_vec:
+    case INDEX_op_xor_vec:
+    case INDEX_op_not_vec:
+    case INDEX_op_smin_vec:
+    case INDEX_op_umin_vec:
+    case INDEX_op_smax_vec:
+    case INDEX_op_umax_vec:
+    case INDEX_op_ssadd_vec:
+    case INDEX_op_usadd_vec:
+    case INDEX_op_sssub_vec:
+    case INDEX_op_ussub_vec:
+    case INDEX_op_shli_vec:
+    case INDEX_op_shri_vec:
+    case INDEX_op_sari_vec:
+    case INDEX_op_shls_vec:
+    case INDEX_op_shrs_vec:
+    case INDEX_op_sars_vec:
+    case INDEX_op_shlv_vec:
+    case INDEX_op_shrv_vec:
+    case INDEX_op_sarv_vec:
+    case INDEX_op_cmp_vec:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+void tcg_expand_vec_op(TCGOpcode opc, TCGType type, unsigned vece,
+                       TCGArg a0, ...)
+{
+    g_assert_not_reached();
+}
+
 static const TCGTargetOpDef *tcg_target_op_def(TCGOpcode op)
 {
     static const TCGTargetOpDef r
@@ -1654,6 +2106,16 @@ static const TCGTargetOpDef *tcg_target_op_def(TCGOpcode op)
         = { .args_ct_str = { "LZ", "LZ", "L", "L" } };
     static const TCGTargetOpDef r_r_rZ_rZ_rM_rM
         = { .args_ct_str = { "r", "r", "rZ", "rZ", "rM", "rM" } };
+    static const TCGTargetOpDef v_r
+        = { .args_ct_str = { "v", "r" } };
+    static const TCGTargetOpDef v_rv
+        = { .args_ct_str = { "v", "rv" } };
+    static const TCGTargetOpDef v_v
+        = { .args_ct_str = { "v", "v" } };
+    static const TCGTargetOpDef v_v_r
+        = { .args_ct_str = { "v", "v", "r" } };
+    static const TCGTargetOpDef v_v_v
+        = { .args_ct_str = { "v", "v", "v" } };
 
     switch (op) {
     case INDEX_op_goto_ptr:
@@ -1769,6 +2231,42 @@ static const TCGTargetOpDef *tcg_target_op_def(TCGOpcode op)
                : TARGET_LONG_BITS <= TCG_TARGET_REG_BITS ? &LZ_LZ_L
                : &LZ_LZ_L_L;
 
+    case INDEX_op_ld_vec:
+    case INDEX_op_st_vec:
+    case INDEX_op_dupm_vec:
+        return &v_r;
+    case INDEX_op_dup_vec:
+        return &v_rv;
+    case INDEX_op_neg_vec:
+    case INDEX_op_not_vec:
+    case INDEX_op_shli_vec:
+    case INDEX_op_shri_vec:
+    case INDEX_op_sari_vec:
+        return &v_v;
+    case INDEX_op_shls_vec:
+    case INDEX_op_shrs_vec:
+    case INDEX_op_sars_vec:
+        return &v_v_r;
+    case INDEX_op_add_vec:
+    case INDEX_op_sub_vec:
+    case INDEX_op_mul_vec:
+    case INDEX_op_and_vec:
+    case INDEX_op_or_vec:
+    case INDEX_op_xor_vec:
+    case INDEX_op_smin_vec:
+    case INDEX_op_umin_vec:
+    case INDEX_op_smax_vec:
+    case INDEX_op_umax_vec:
+    case INDEX_op_ssadd_vec:
+    case INDEX_op_usadd_vec:
+    case INDEX_op_sssub_vec:
+    case INDEX_op_ussub_vec:
+    case INDEX_op_shlv_vec:
+    case INDEX_op_shrv_vec:
+    case INDEX_op_sarv_vec:
+    case INDEX_op_cmp_vec:
+        return &v_v_v;
+
     default:
         return NULL;
     }
@@ -1840,14 +2338,35 @@ static void tcg_target_qemu_prologue(TCGContext *s)
     tcg_out_opc_imm(s, OPC_JALR, TCG_REG_ZERO, TCG_REG_RA, 0);
 }
 
+#ifndef COMPAT_HWCAP_ISA_V
+#define COMPAT_HWCAP_ISA_V (1 << ('V' - 'A'))
+#endif
+
 static void tcg_target_init(TCGContext *s)
 {
-    tcg_target_available_regs[TCG_TYPE_I32] = 0xffffffff;
+#if TCG_TARGET_REG_BITS == 64
+    unsigned long hwcap = qemu_getauxval(AT_HWCAP);
+
+    if (hwcap & COMPAT_HWCAP_ISA_V) {
+        unsigned long vlenb;
+
+        /* A TCG_TYPE_V128 value must fit in one register with LMUL=1 */
+        asm("csrr %0, 0xc22" : "=r"(vlenb));
+        have_rvv = vlenb >= 16;
+    }
+#endif
+
+    tcg_target_available_regs[TCG_TYPE_I32] = ALL_GENERAL_REGS;
     if (TCG_TARGET_REG_BITS == 64) {
-        tcg_target_available_regs[TCG_TYPE_I64] = 0xffffffff;
+        tcg_target_available_regs[TCG_TYPE_I64] = ALL_GENERAL_REGS;
+    }
+    if (have_rvv) {
+        tcg_target_available_regs[TCG_TYPE_V64] = ALL_VECTOR_REGS;
+        tcg_target_available_regs[TCG_TYPE_V128] = ALL_VECTOR_REGS;
     }
 
-    tcg_target_call_clobber_regs = -1u;
+    /* All vector registers are call clobbered */
+    tcg_target_call_clobber_regs = -1ull;
     tcg_regset_reset_reg(tcg_target_call_clobber_regs, TCG_REG_S0);
     tcg_regset_reset_reg(tcg_target_call_clobber_regs, TCG_REG_S1);
     tcg_regset_reset_reg(tcg_target_call_clobber_regs, TCG_REG_S2);
@@ -1869,6 +2388,7 @@ static void tcg_target_init(TCGContext *s)
     tcg_regset_set_reg(s->reserved_regs, TCG_REG_SP);
     tcg_regset_set_reg(s->reserved_regs, TCG_REG_GP);
     tcg_regset_set_reg(s->reserved_regs, TCG_REG_TP);
+    tcg_regset_set_reg(s->reserved_regs, TCG_REG_VMASK);
 }
 
 typedef struct {
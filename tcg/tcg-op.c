@@ -2720,6 +2720,75 @@ void tcg_gen_lookup_and_goto_ptr(void)
     }
 }
 
+/* Offset of a CPUState field from cpu_env */
+#define CPU_STATE_OFS(FIELD) \
+    ((int)offsetof(ArchCPU, parent_obj.FIELD) - (int)offsetof(ArchCPU, env))
+
+static uint32_t tcg_ibtc_site(void)
+{
+    return tcg_ctx->ibtc_site++ & (TB_IBTC_SIZE - 1);
+}
+
+void tcg_gen_lookup_and_goto_ptr_site(void)
+{
+    if (TCG_TARGET_HAS_goto_ptr && !qemu_loglevel_mask(CPU_LOG_TB_NOCHAIN)) {
+        TCGv_ptr ptr;
+        TCGv_i32 site;
+
+        plugin_gen_disable_mem_helpers();
+        ptr = tcg_temp_new_ptr();
+        site = tcg_const_i32(tcg_ibtc_site());
+        gen_helper_lookup_tb_ptr_site(ptr, cpu_env, site);
+        tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ptr));
+        tcg_temp_free_i32(site);
+        tcg_temp_free_ptr(ptr);
+    } else {
+        tcg_gen_exit_tb(NULL, 0);
+    }
+}
+
+void tcg_gen_push_return(void)
+{
+    TCGv_i32 top, site;
+    TCGv_ptr ptr;
+
+    if (!TCG_TARGET_HAS_goto_ptr || qemu_loglevel_mask(CPU_LOG_TB_NOCHAIN)) {
+        return;
+    }
+
+    top = tcg_temp_new_i32();
+    tcg_gen_ld_i32(top, cpu_env, CPU_STATE_OFS(tb_ras_top));
+    tcg_gen_addi_i32(top, top, 1);
+    tcg_gen_andi_i32(top, top, TB_RAS_SIZE - 1);
+    tcg_gen_st_i32(top, cpu_env, CPU_STATE_OFS(tb_ras_top));
+
+    ptr = tcg_temp_new_ptr();
+    tcg_gen_shli_i32(top, top, 2);
+    tcg_gen_ext_i32_ptr(ptr, top);
+    tcg_gen_add_ptr(ptr, ptr, cpu_env);
+    site = tcg_const_i32(tcg_ibtc_site());
+    tcg_gen_st_i32(site, ptr, CPU_STATE_OFS(tb_ras));
+
+    tcg_temp_free_i32(site);
+    tcg_temp_free_ptr(ptr);
+    tcg_temp_free_i32(top);
+}
+
+void tcg_gen_lookup_and_goto_ptr_return(void)
+{
+    if (TCG_TARGET_HAS_goto_ptr && !qemu_loglevel_mask(CPU_LOG_TB_NOCHAIN)) {
+        TCGv_ptr ptr;
+
+        plugin_gen_disable_mem_helpers();
+        ptr = tcg_temp_new_ptr();
+        gen_helper_lookup_tb_ptr_return(ptr, cpu_env);
+        tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ptr));
+        tcg_temp_free_ptr(ptr);
+    } else {
+        tcg_gen_exit_tb(NULL, 0);
+    }
+}
+
 static inline MemOp tcg_canonicalize_memop(MemOp op, bool is64, bool st)
 {
     /* Trigger the asserts within as early as possible.  */
@@ -185,7 +185,8 @@ struct tcg_region_state {
     size_t stride; /* .size + guard size */
 
     /* fields protected by the lock */
-    size_t current; /* current region index */
+    uint64_t *gen; /* allocation order of each region; 0 if it is free */
+    uint64_t next_gen;
     size_t agg_size_full; /* aggregate size of full regions */
 };
 
@@ -558,12 +559,16 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
 
 static bool tcg_region_alloc__locked(TCGContext *s)
 {
-    if (region.current == region.n) {
-        return true;
+    size_t i;
+
+    for (i = 0; i < region.n; i++) {
+        if (region.gen[i] == 0) {
+            tcg_region_assign(s, i);
+            region.gen[i] = ++region.next_gen;
+            return false;
+        }
     }
-    tcg_region_assign(s, region.current);
-    region.current++;
-    return false;
+    return true;
 }
 
 /*
@@ -601,7 +606,8 @@ void tcg_region_reset_all(void)
     unsigned int i;
 
     qemu_mutex_lock(&region.lock);
-    region.current = 0;
+    memset(region.gen, 0, region.n * sizeof(*region.gen));
+    region.next_gen = 0;
     region.agg_size_full = 0;
 
     for (i = 0; i < n_ctxs; i++) {
@@ -615,6 +621,101 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
+static gboolean tcg_region_evict_traverse(gpointer k, gpointer v,
+                                          gpointer data)
+{
+    void (*invalidate)(TranslationBlock *) = data;
+    TranslationBlock *tb = v;
+
+    invalidate(tb);
+    tb_destroy(tb);
+    return FALSE;
+}
+
+static int tcg_region_gen_cmp(const void *a, const void *b)
+{
+    uint64_t ga = region.gen[*(const size_t *)a];
+    uint64_t gb = region.gen[*(const size_t *)b];
+
+    return ga < gb ? -1 : ga > gb;
+}
+
+/*
+ * Make room in code_gen_buffer without throwing all the code away: the
+ * oldest half of the full regions, i.e. those that no TCG thread is
+ * translating into, have all their TBs passed to @invalidate and are
+ * then handed out again by tcg_region_alloc().  Regions are allocated
+ * in order as they fill up, so the oldest ones hold the code that was
+ * translated longest ago, e.g. boot code that is not run any more.
+ *
+ * Returns false if no region could be freed, in which case the caller
+ * has to fall back to a full flush.  *@n_evicted is set to the number
+ * of regions evicted by this call; it is zero if there were free
+ * regions already, e.g. because another vCPU made room first.
+ *
+ * Call from a safe-work context.
+ */
+bool tcg_region_evict(void (*invalidate)(TranslationBlock *),
+                      size_t *n_evicted)
+{
+    unsigned int n_ctxs = atomic_read(&n_tcg_ctxs);
+    g_autofree size_t *victims = g_new(size_t, region.n);
+    size_t n_free = 0, n_victims = 0;
+    size_t i;
+
+    qemu_mutex_lock(&region.lock);
+    for (i = 0; i < region.n; i++) {
+        void *start, *end;
+        unsigned int j;
+
+        if (region.gen[i] == 0) {
+            n_free++;
+            continue;
+        }
+        tcg_region_bounds(i, &start, &end);
+        for (j = 0; j < n_ctxs; j++) {
+            const TCGContext *s = atomic_read(&tcg_ctxs[j]);
+
+            if (s->code_gen_buffer == start) {
+                break;
+            }
+        }
+        if (j == n_ctxs) {
+            victims[n_victims++] = i;
+        }
+    }
+
+    /* Somebody else made room already, or there is nothing to evict */
+    if (n_free || n_victims == 0) {
+        qemu_mutex_unlock(&region.lock);
+        *n_evicted = 0;
+        return n_free != 0;
+    }
+
+    qsort(victims, n_victims, sizeof(*victims), tcg_region_gen_cmp);
+    n_victims = DIV_ROUND_UP(n_victims, 2);
+
+    for (i = 0; i < n_victims; i++) {
+        struct tcg_region_tree *rt = region_trees + victims[i] * tree_size;
+        void *start, *end;
+
+        qemu_mutex_lock(&rt->lock);
+        g_tree_foreach(rt->tree, tcg_region_evict_traverse, invalidate);
+        /* Increment the refcount first so that destroy acts as a reset */
+        g_tree_ref(rt->tree);
+        g_tree_destroy(rt->tree);
+        qemu_mutex_unlock(&rt->lock);
+
+        tcg_region_bounds(victims[i], &start, &end);
+        region.agg_size_full -= (end - start) - TCG_HIGHWATER;
+        region.gen[victims[i]] = 0;
+    }
+    qemu_mutex_unlock(&region.lock);
+
+    *n_evicted = n_victims;
+    return true;
+}
+
 #ifdef CONFIG_USER_ONLY
 static size_t tcg_n_regions(void)
 {
@@ -626,34 +727,34 @@ static size_t tcg_n_regions(void)
  * first try to set more regions than max_cpus, with those regions being of
  * reasonable size. If that's not possible we make do by evenly dividing
  * the code_gen_buffer among the vCPUs.
+ *
+ * Even with a single vCPU thread we use several regions, so that running
+ * out of space can evict the oldest ones instead of flushing everything.
  */
 static size_t tcg_n_regions(void)
 {
     size_t i;
-
-    /* Use a single region if all we have is one vCPU thread */
-#if !defined(CONFIG_USER_ONLY)
     MachineState *ms = MACHINE(qdev_get_machine());
-    unsigned int max_cpus = ms->smp.max_cpus;
-#endif
-    if (max_cpus == 1 || !qemu_tcg_mttcg_enabled()) {
-        return 1;
+    unsigned int n_threads = ms->smp.max_cpus;
+
+    if (!qemu_tcg_mttcg_enabled()) {
+        n_threads = 1;
     }
 
-    /* Try to have more regions than max_cpus, with each region being >= 2 MB */
+    /* Try to have more regions than threads, with each region being >= 2 MB */
     for (i = 8; i > 0; i--) {
         size_t regions_per_thread = i;
         size_t region_size;
 
         region_size = tcg_init_ctx.code_gen_buffer_size;
-        region_size /= max_cpus * regions_per_thread;
+        region_size /= n_threads * regions_per_thread;
 
         if (region_size >= 2 * 1024u * 1024) {
-            return max_cpus * regions_per_thread;
+            return n_threads * regions_per_thread;
         }
     }
     /* If we can't, then just allocate one region per vCPU thread */
-    return max_cpus;
+    return n_threads;
 }
 #endif
 
@@ -714,6 +815,7 @@ void tcg_region_init(void)
     /* init the region struct */
     qemu_mutex_init(&region.lock);
     region.n = n_regions;
+    region.gen = g_new0(uint64_t, n_regions);
     region.size = region_size - page_size;
     region.stride = region_size;
     region.start = buf;
@@ -33,6 +33,8 @@ enum op {
     OP_FMA,
     OP_SQRT,
     OP_CMP,
+    OP_CVT,
+    OP_I2F,
     OP_MAX_NR,
 };
 
@@ -44,6 +46,8 @@ static const char * const op_names[] = {
     [OP_FMA] = "mulAdd",
     [OP_SQRT] = "sqrt",
     [OP_CMP] = "cmp",
+    [OP_CVT] = "cvt",
+    [OP_I2F] = "i2f",
     [OP_MAX_NR] = NULL,
 };
 
@@ -119,6 +123,7 @@ static enum op operation;
 static enum tester tester;
 static uint64_t n_completed_ops;
 static unsigned int duration = DEFAULT_DURATION_SECS;
+static bool riscv_flags;
 static int64_t ns_elapsed;
 /* disable optimizations with volatile */
 static volatile union fp res;
@@ -190,6 +195,43 @@ static void fill_random(union fp *ops, int n_ops, enum precision prec,
     }
 }
 
+/*
+ * Conversions read their input from ops[1]: for "cvt" a value of the other
+ * precision (a double that needs rounding, or a float), and for "i2f" a
+ * 64-bit integer.
+ */
+static void fill_convert_source(union fp *ops, enum precision prec,
+                                enum op op)
+{
+    float_status s = {};
+
+    switch (op) {
+    case OP_CVT:
+        switch (prec) {
+        case PREC_SINGLE:
+        case PREC_FLOAT32:
+            ops[1].f64 = float32_to_float64(ops[0].f32, &s);
+            /* fill the bits that float32 cannot hold */
+            ops[1].u64 |= random_ops[1] & 0x1fffffff;
+            break;
+        case PREC_DOUBLE:
+        case PREC_FLOAT64:
+            ops[1].u64 = 0;
+            ops[1].f32 = make_float32((random_ops[0] & 0x807fffff) |
+                                      0x3f800000);
+            break;
+        default:
+            g_assert_not_reached();
+        }
+        break;
+    case OP_I2F:
+        ops[1].u64 = random_ops[1];
+        break;
+    default:
+        break;
+    }
+}
+
 /*
  * The main benchmark function. Instead of (ab)using macros, we rely
  * on the compiler to unfold this at compile-time.
@@ -204,9 +246,13 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
         int i;
 
         update_random_ops(n_ops, prec);
+        if (riscv_flags) {
+            set_float_exception_flags(0, &soft_status);
+        }
+        fill_random(ops, n_ops, prec, no_neg);
+        fill_convert_source(ops, prec, op);
         switch (prec) {
         case PREC_SINGLE:
-            fill_random(ops, n_ops, prec, no_neg);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float a = ops[0].f;
@@ -235,13 +281,18 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_CVT:
+                    res.f = ops[1].d;
+                    break;
+                case OP_I2F:
+                    res.f = (int64_t)ops[1].u64;
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_DOUBLE:
-            fill_random(ops, n_ops, prec, no_neg);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 double a = ops[0].d;
@@ -270,13 +321,18 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_CVT:
+                    res.d = ops[1].f;
+                    break;
+                case OP_I2F:
+                    res.d = (int64_t)ops[1].u64;
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_FLOAT32:
-            fill_random(ops, n_ops, prec, no_neg);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float32 a = ops[0].f32;
@@ -305,13 +361,18 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float32_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_CVT:
+                    res.f32 = float64_to_float32(ops[1].f64, &soft_status);
+                    break;
+                case OP_I2F:
+                    res.f32 = int64_to_float32(ops[1].u64, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_FLOAT64:
-            fill_random(ops, n_ops, prec, no_neg);
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float64 a = ops[0].f64;
@@ -340,6 +401,12 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float64_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_CVT:
+                    res.f64 = float32_to_float64(ops[1].f32, &soft_status);
+                    break;
+                case OP_I2F:
+                    res.f64 = int64_to_float64(ops[1].u64, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -377,6 +444,8 @@ GEN_BENCH_ALL_TYPES(mul, OP_MUL, 2)
 GEN_BENCH_ALL_TYPES(div, OP_DIV, 2)
 GEN_BENCH_ALL_TYPES(fma, OP_FMA, 3)
 GEN_BENCH_ALL_TYPES(cmp, OP_CMP, 2)
+GEN_BENCH_ALL_TYPES(cvt, OP_CVT, 2)
+GEN_BENCH_ALL_TYPES(i2f, OP_I2F, 2)
 #undef GEN_BENCH_ALL_TYPES
 
 #define GEN_BENCH_ALL_TYPES_NO_NEG(name, op, n)                         \
@@ -407,6 +476,8 @@ static const bench_func_t bench_funcs[OP_MAX_NR][PREC_MAX_NR] = {
     GEN_BENCH_FUNCS(fma, OP_FMA),
     GEN_BENCH_FUNCS(sqrt, OP_SQRT),
     GEN_BENCH_FUNCS(cmp, OP_CMP),
+    GEN_BENCH_FUNCS(cvt, OP_CVT),
+    GEN_BENCH_FUNCS(i2f, OP_I2F),
 };
 
 #undef GEN_BENCH_FUNCS
@@ -449,6 +520,9 @@ static void usage_complete(int argc, char *argv[])
             "Default: single\n");
     fprintf(stderr, " -r = rounding mode (even, zero, down, up, tieaway). "
             "Default: even\n");
+    fprintf(stderr, " -R = RISC-V semantics: default NaNs, and the accrued "
+            "flags are cleared\n      regularly like a guest writing fflags "
+            "(soft tester only).\n      Default: disabled\n");
     fprintf(stderr, " -t = tester (%s). Default: %s\n",
             tester_list, tester_names[0]);
     fprintf(stderr, " -z = flush inputs to zero (soft tester only). "
@@ -541,7 +615,7 @@ static void parse_args(int argc, char *argv[])
     int rounding = ROUND_EVEN;
 
     for (;;) {
-        c = getopt(argc, argv, "d:ho:p:r:t:zZ");
+        c = getopt(argc, argv, "d:ho:p:r:Rt:zZ");
         if (c < 0) {
             break;
         }
@@ -577,6 +651,10 @@ static void parse_args(int argc, char *argv[])
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'R':
+            set_default_nan_mode(true, &soft_status);
+            riscv_flags = true;
+            break;
         case 't':
             val = find_name(tester_names, optarg);
             if (val < 0) {
@@ -16,15 +16,30 @@
 
 QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
 
+typedef struct {
+    uint64_t bb_count;
+    uint64_t insn_count;
+} CPUCount;
+
 static uint64_t bb_count;
 static uint64_t insn_count;
 static bool do_inline;
 
+/* per-vCPU scoreboard for the inline counters, NULL in user mode */
+static CPUCount *counts;
+static int max_cpus;
+
 static void plugin_exit(qemu_plugin_id_t id, void *p)
 {
-    g_autofree gchar *out = g_strdup_printf(
-        "bb's: %" PRIu64", insns: %" PRIu64 "\n",
-        bb_count, insn_count);
+    g_autofree gchar *out = NULL;
+    int i;
+
+    for (i = 0; counts && i < max_cpus; i++) {
+        bb_count += counts[i].bb_count;
+        insn_count += counts[i].insn_count;
+    }
+    out = g_strdup_printf("bb's: %" PRIu64", insns: %" PRIu64 "\n",
+                          bb_count, insn_count);
     qemu_plugin_outs(out);
 }
 
@@ -40,7 +55,14 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 {
     unsigned long n_insns = qemu_plugin_tb_n_insns(tb);
 
-    if (do_inline) {
+    if (do_inline && counts) {
+        qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+            tb, QEMU_PLUGIN_INLINE_ADD_U64, &counts[0].bb_count,
+            sizeof(CPUCount), 1);
+        qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+            tb, QEMU_PLUGIN_INLINE_ADD_U64, &counts[0].insn_count,
+            sizeof(CPUCount), n_insns);
+    } else if (do_inline) {
         qemu_plugin_register_vcpu_tb_exec_inline(tb, QEMU_PLUGIN_INLINE_ADD_U64,
                                                  &bb_count, 1);
         qemu_plugin_register_vcpu_tb_exec_inline(tb, QEMU_PLUGIN_INLINE_ADD_U64,
@@ -58,6 +80,10 @@ QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
 {
     if (argc && strcmp(argv[0], "inline") == 0) {
         do_inline = true;
+        max_cpus = qemu_plugin_n_max_vcpus();
+        if (max_cpus > 0) {
+            counts = g_new0(CPUCount, max_cpus);
+        }
     }
 
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
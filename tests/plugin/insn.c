@@ -18,12 +18,23 @@ QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
 
 static uint64_t insn_count;
 static bool do_inline;
+static bool do_cond;
+
+/* in "cond" mode, cond_count is moved to insn_count every COND_PERIOD insns */
+#define COND_PERIOD 1024
+static uint64_t cond_count;
 
 static void vcpu_insn_exec_before(unsigned int cpu_index, void *udata)
 {
     insn_count++;
 }
 
+static void vcpu_insn_period(unsigned int cpu_index, void *udata)
+{
+    insn_count += cond_count;
+    cond_count = 0;
+}
+
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 {
     size_t n = qemu_plugin_tb_n_insns(tb);
@@ -32,7 +43,13 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
     for (i = 0; i < n; i++) {
         struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
 
-        if (do_inline) {
+        if (do_cond) {
+            qemu_plugin_register_vcpu_insn_exec_inline(
+                insn, QEMU_PLUGIN_INLINE_ADD_U64, &cond_count, 1);
+            qemu_plugin_register_vcpu_insn_exec_cond_cb(
+                insn, vcpu_insn_period, QEMU_PLUGIN_CB_NO_REGS,
+                QEMU_PLUGIN_COND_GE, &cond_count, 0, COND_PERIOD, NULL);
+        } else if (do_inline) {
             qemu_plugin_register_vcpu_insn_exec_inline(
                 insn, QEMU_PLUGIN_INLINE_ADD_U64, &insn_count, 1);
         } else {
@@ -44,7 +61,10 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 
 static void plugin_exit(qemu_plugin_id_t id, void *p)
 {
-    g_autofree gchar *out = g_strdup_printf("insns: %" PRIu64 "\n", insn_count);
+    g_autofree gchar *out = NULL;
+
+    insn_count += cond_count;
+    out = g_strdup_printf("insns: %" PRIu64 "\n", insn_count);
     qemu_plugin_outs(out);
 }
 
@@ -54,6 +74,8 @@ QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
 {
     if (argc && !strcmp(argv[0], "inline")) {
         do_inline = true;
+    } else if (argc && !strcmp(argv[0], "cond")) {
+        do_cond = true;
     }
 
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
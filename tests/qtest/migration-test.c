@@ -1335,6 +1335,86 @@ static void test_multifd_tcp_zstd(void)
 }
 #endif
 
+/*
+ * Turn a region that the guest does not touch into zeroes and back to
+ * data while the migration iterates, so that some multifd packets hold
+ * nothing but zero pages.  The XBZRLE cache has to follow, or the last
+ * version of the region is encoded against pages the destination has
+ * already cleared.
+ */
+static void test_multifd_tcp_xbzrle_zero(void)
+{
+    MigrateStart *args = migrate_start_new();
+    QTestState *from, *to;
+    uint64_t addr, size = 1024 * 1024;
+    g_autofree uint8_t *buf = g_malloc(size);
+    g_autofree uint8_t *dest_buf = g_malloc(size);
+    QDict *rsp;
+    char *uri;
+    uint64_t i;
+
+    if (test_migrate_start(&from, &to, "defer", args)) {
+        return;
+    }
+    addr = end_address + 4 * 1024 * 1024;
+
+    migrate_set_parameter_int(from, "downtime-limit", 1);
+    migrate_set_parameter_int(from, "max-bandwidth", 1000000000);
+    migrate_set_parameter_int(from, "xbzrle-cache-size", 128 * 1024 * 1024);
+
+    migrate_set_parameter_int(from, "multifd-channels", 4);
+    migrate_set_parameter_int(to, "multifd-channels", 4);
+
+    migrate_set_parameter_str(from, "multifd-compression", "xbzrle");
+    migrate_set_parameter_str(to, "multifd-compression", "xbzrle");
+
+    migrate_set_capability(from, "multifd", "true");
+    migrate_set_capability(to, "multifd", "true");
+    migrate_set_capability(from, "xbzrle", "true");
+    migrate_set_capability(to, "xbzrle", "true");
+
+    qtest_memset(from, addr, 0x55, size);
+
+    rsp = wait_command(to, "{ 'execute': 'migrate-incoming',"
+                           "  'arguments': { 'uri': 'tcp:127.0.0.1:0' }}");
+    qobject_unref(rsp);
+
+    wait_for_serial("src_serial");
+
+    uri = migrate_get_socket_address(to, "socket-address");
+
+    migrate_qmp(from, uri, "{}");
+
+    /* The first pass caches the region, the next ones send it as zeroes */
+    wait_for_migration_pass(from);
+    qtest_memset(from, addr, 0, size);
+    wait_for_migration_pass(from);
+    wait_for_migration_pass(from);
+
+    /* Close enough to the cached copy to be encoded against it */
+    for (i = 0; i < size; i++) {
+        buf[i] = i % TEST_MEM_PAGE_SIZE ? 0x55 : 0xaa;
+    }
+    qtest_memwrite(from, addr, buf, size);
+    wait_for_migration_pass(from);
+
+    migrate_set_parameter_int(from, "downtime-limit", 300);
+
+    if (!got_stop) {
+        qtest_qmp_eventwait(from, "STOP");
+    }
+    qtest_qmp_eventwait(to, "RESUME");
+
+    wait_for_serial("dest_serial");
+    wait_for_migration_complete(from);
+
+    qtest_memread(to, addr, dest_buf, size);
+    g_assert(memcmp(buf, dest_buf, size) == 0);
+
+    test_migrate_end(from, to, true);
+    g_free(uri);
+}
+
 /*
  * This test does:
  *  source               target
@@ -1499,6 +1579,8 @@ int main(int argc, char **argv)
     qtest_add_func("/migration/multifd/tcp/none", test_multifd_tcp_none);
     qtest_add_func("/migration/multifd/tcp/cancel", test_multifd_tcp_cancel);
     qtest_add_func("/migration/multifd/tcp/zlib", test_multifd_tcp_zlib);
+    qtest_add_func("/migration/multifd/tcp/xbzrle/zero",
+                   test_multifd_tcp_xbzrle_zero);
 #ifdef CONFIG_ZSTD
     qtest_add_func("/migration/multifd/tcp/zstd", test_multifd_tcp_zstd);
 #endif
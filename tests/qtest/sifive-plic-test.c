@@ -0,0 +1,191 @@
+/*
+ * QTest testcase for the SiFive PLIC, using the RISC-V virt machine
+ *
+ * Copyright (c) 2020 SiFive, Inc.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+/* Layout of the virt machine, see hw/riscv/virt.c */
+#define PLIC_BASE           0xc000000
+#define PLIC_PRIORITY_BASE  0x04
+#define PLIC_PENDING_BASE   0x1000
+#define PLIC_ENABLE_BASE    0x2000
+#define PLIC_ENABLE_STRIDE  0x80
+#define PLIC_CONTEXT_BASE   0x200000
+#define PLIC_CONTEXT_STRIDE 0x1000
+
+#define UART0_BASE          0x10000000
+#define UART0_IRQ           10
+#define UART_IER            1
+#define UART_IER_THRI       0x02
+
+/* Each hart has an M mode and an S mode context */
+#define CONTEXT_S(hart)     ((hart) * 2 + 1)
+
+#define BENCH_HARTS         8
+#define BENCH_ITERATIONS    20000
+
+static void plic_set_priority(QTestState *qts, int irq, uint32_t prio)
+{
+    qtest_writel(qts, PLIC_BASE + PLIC_PRIORITY_BASE + (irq - 1) * 4, prio);
+}
+
+static void plic_enable(QTestState *qts, int ctx, int irq, bool on)
+{
+    uint64_t addr = PLIC_BASE + PLIC_ENABLE_BASE +
+                    ctx * PLIC_ENABLE_STRIDE + (irq / 32) * 4;
+    uint32_t val = qtest_readl(qts, addr);
+
+    if (on) {
+        val |= 1u << (irq % 32);
+    } else {
+        val &= ~(1u << (irq % 32));
+    }
+    qtest_writel(qts, addr, val);
+}
+
+static void plic_set_threshold(QTestState *qts, int ctx, uint32_t threshold)
+{
+    qtest_writel(qts, PLIC_BASE + PLIC_CONTEXT_BASE +
+                 ctx * PLIC_CONTEXT_STRIDE, threshold);
+}
+
+static uint32_t plic_claim(QTestState *qts, int ctx)
+{
+    return qtest_readl(qts, PLIC_BASE + PLIC_CONTEXT_BASE +
+                       ctx * PLIC_CONTEXT_STRIDE + 4);
+}
+
+static void plic_complete(QTestState *qts, int ctx, int irq)
+{
+    qtest_writel(qts, PLIC_BASE + PLIC_CONTEXT_BASE +
+                 ctx * PLIC_CONTEXT_STRIDE + 4, irq);
+}
+
+static bool plic_pending(QTestState *qts, int irq)
+{
+    return qtest_readl(qts, PLIC_BASE + PLIC_PENDING_BASE + (irq / 32) * 4) &
+           (1u << (irq % 32));
+}
+
+/* The UART raises its interrupt as soon as THR empty is enabled */
+static void uart_irq(QTestState *qts, bool on)
+{
+    qtest_writeb(qts, UART0_BASE + UART_IER, on ? UART_IER_THRI : 0);
+}
+
+static void test_claim_complete(void)
+{
+    QTestState *qts = qtest_init("-machine virt -bios none");
+
+    plic_set_priority(qts, UART0_IRQ, 1);
+    plic_enable(qts, CONTEXT_S(0), UART0_IRQ, true);
+    plic_set_threshold(qts, CONTEXT_S(0), 0);
+
+    g_assert_false(plic_pending(qts, UART0_IRQ));
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, 0);
+
+    uart_irq(qts, true);
+    g_assert_true(plic_pending(qts, UART0_IRQ));
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, UART0_IRQ);
+    g_assert_false(plic_pending(qts, UART0_IRQ));
+
+    /* A claimed source is not delivered again until completed */
+    uart_irq(qts, false);
+    uart_irq(qts, true);
+    g_assert_true(plic_pending(qts, UART0_IRQ));
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, 0);
+
+    plic_complete(qts, CONTEXT_S(0), UART0_IRQ);
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, UART0_IRQ);
+    plic_complete(qts, CONTEXT_S(0), UART0_IRQ);
+
+    qtest_quit(qts);
+}
+
+static void test_priority_threshold(void)
+{
+    QTestState *qts = qtest_init("-machine virt -bios none");
+
+    plic_set_priority(qts, UART0_IRQ, 3);
+    plic_enable(qts, CONTEXT_S(0), UART0_IRQ, true);
+    plic_set_threshold(qts, CONTEXT_S(0), 3);
+    uart_irq(qts, true);
+
+    /* Only sources above the threshold are delivered */
+    g_assert_true(plic_pending(qts, UART0_IRQ));
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, 0);
+
+    plic_set_threshold(qts, CONTEXT_S(0), 2);
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, UART0_IRQ);
+    plic_complete(qts, CONTEXT_S(0), UART0_IRQ);
+
+    /* Priority 0 never interrupts */
+    uart_irq(qts, false);
+    uart_irq(qts, true);
+    plic_set_priority(qts, UART0_IRQ, 0);
+    plic_set_threshold(qts, CONTEXT_S(0), 0);
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, 0);
+
+    /* Neither does a source the context has not enabled */
+    plic_set_priority(qts, UART0_IRQ, 1);
+    plic_enable(qts, CONTEXT_S(0), UART0_IRQ, false);
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, 0);
+    plic_enable(qts, CONTEXT_S(0), UART0_IRQ, true);
+    g_assert_cmpuint(plic_claim(qts, CONTEXT_S(0)), ==, UART0_IRQ);
+
+    qtest_quit(qts);
+}
+
+/*
+ * Raise, claim and complete one source with it enabled on every context
+ * of a many-hart machine, which is the pattern of a busy virtio device.
+ */
+static void bench_claim_complete(void)
+{
+    QTestState *qts;
+    gint64 start;
+    double secs;
+    int i;
+
+    qts = qtest_initf("-machine virt -bios none -smp %d", BENCH_HARTS);
+
+    plic_set_priority(qts, UART0_IRQ, 1);
+    for (i = 0; i < BENCH_HARTS * 2; i++) {
+        plic_enable(qts, i, UART0_IRQ, true);
+    }
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        uart_irq(qts, true);
+        g_assert_cmpuint(plic_claim(qts, CONTEXT_S(i % BENCH_HARTS)), ==,
+                         UART0_IRQ);
+        uart_irq(qts, false);
+        plic_complete(qts, CONTEXT_S(i % BENCH_HARTS), UART0_IRQ);
+    }
+    secs = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    g_test_minimized_result(secs, "%d claim/complete cycles: %.3f s",
+                            BENCH_ITERATIONS, secs);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("sifive-plic/claim-complete", test_claim_complete);
+    qtest_add_func("sifive-plic/priority-threshold", test_priority_threshold);
+    if (g_test_perf()) {
+        qtest_add_func("sifive-plic/bench/claim-complete",
+                       bench_claim_complete);
+    }
+
+    return g_test_run();
+}
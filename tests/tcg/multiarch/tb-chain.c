@@ -0,0 +1,81 @@
+/*
+ * TB chaining benchmark
+ *
+ * Run a loop made of short translation blocks that end in conditional
+ * branches, so that almost all of the time goes into taking chained
+ * goto_tb exits. The time per TB shows the cost of the backend's direct
+ * jump sequence; compare runs of the same binary with and without a
+ * backend change, or with "-d nochain" to disable chaining.
+ *
+ * The branch counts are checked, so this also serves as a test.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ITERATIONS 4000000
+
+/* volatile, so that the compiler keeps the branches around the stores */
+static volatile uint64_t hits[4];
+
+static void __attribute__((noinline)) run(uint64_t n)
+{
+    uint64_t i;
+
+    for (i = 0; i < n; i++) {
+        if (i % 3 == 0) {
+            hits[0]++;
+        }
+        if (i & 4) {
+            hits[1]++;
+        }
+        if ((i & 7) == 5) {
+            hits[2]++;
+        }
+        hits[3]++;
+    }
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int check(int i, uint64_t expected)
+{
+    if (hits[i] != expected) {
+        fprintf(stderr, "hits[%d] = %llu, expected %llu\n", i,
+                (unsigned long long)hits[i], (unsigned long long)expected);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t n = argc > 1 ? strtoull(argv[1], NULL, 0) : ITERATIONS;
+    int64_t start, ns;
+    int err = 0;
+
+    start = now_ns();
+    run(n);
+    ns = now_ns() - start;
+
+    err |= check(0, (n + 2) / 3);
+    err |= check(1, n / 8 * 4 + (n % 8 > 4 ? n % 8 - 4 : 0));
+    err |= check(2, n / 8 + (n % 8 > 5));
+    err |= check(3, n);
+
+    /* each iteration ends about four blocks, one per conditional branch */
+    printf("%llu iterations in %lld ms, %.2f ns per block\n",
+           (unsigned long long)n, (long long)(ns / 1000000),
+           n ? (double)ns / (n * 4) : 0.0);
+    return err;
+}
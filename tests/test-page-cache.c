@@ -0,0 +1,160 @@
+/*
+ * XBZRLE page cache unit tests.
+ *
+ * Copyright (c) 2020 SiFive, Inc.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qemu/thread.h"
+#include "../migration/page_cache.h"
+
+#define PAGE_SIZE 4096
+#define CACHE_PAGES 64
+/* pages that are this far apart land in the same set of the cache */
+#define SET_STRIDE (CACHE_PAGES / 8 * PAGE_SIZE)
+#define THREADS 4
+#define THREAD_LOOPS 10000
+
+static void fill_page(uint8_t *page, uint64_t addr, uint64_t gen)
+{
+    memset(page, (uint8_t)(addr / PAGE_SIZE + gen), PAGE_SIZE);
+}
+
+static void test_init(void)
+{
+    Error *local_err = NULL;
+    PageCache *cache;
+
+    cache = cache_init(PAGE_SIZE - 1, PAGE_SIZE, &local_err);
+    g_assert(!cache);
+    error_free_or_abort(&local_err);
+
+    cache = cache_init(3 * PAGE_SIZE, PAGE_SIZE, &local_err);
+    g_assert(!cache);
+    error_free_or_abort(&local_err);
+
+    /* Smaller than a set */
+    cache = cache_init(2 * PAGE_SIZE, PAGE_SIZE, &error_abort);
+    g_assert(cache);
+    cache_fini(cache);
+}
+
+static void test_insert_lookup(void)
+{
+    PageCache *cache = cache_init(CACHE_PAGES * PAGE_SIZE, PAGE_SIZE,
+                                  &error_abort);
+    g_autofree uint8_t *page = g_malloc(PAGE_SIZE);
+    g_autofree uint8_t *buf = g_malloc(PAGE_SIZE);
+    uint64_t addr = 5 * PAGE_SIZE;
+
+    fill_page(page, addr, 0);
+    g_assert_false(cache_is_cached(cache, addr, 0));
+    g_assert_false(cache_lookup(cache, addr, buf, 0));
+    g_assert_false(cache_update(cache, addr, page));
+    g_assert(!get_cached_data(cache, addr));
+
+    g_assert_cmpint(cache_insert(cache, addr, page, 0), ==, 0);
+    g_assert_true(cache_is_cached(cache, addr, 0));
+    g_assert_true(cache_lookup(cache, addr, buf, 0));
+    g_assert_cmpint(memcmp(buf, page, PAGE_SIZE), ==, 0);
+    g_assert_cmpint(memcmp(get_cached_data(cache, addr), page, PAGE_SIZE),
+                    ==, 0);
+
+    fill_page(page, addr, 1);
+    g_assert_true(cache_update(cache, addr, page));
+    g_assert_true(cache_lookup(cache, addr, buf, 0));
+    g_assert_cmpint(memcmp(buf, page, PAGE_SIZE), ==, 0);
+
+    cache_fini(cache);
+}
+
+static void test_replacement(void)
+{
+    PageCache *cache = cache_init(CACHE_PAGES * PAGE_SIZE, PAGE_SIZE,
+                                  &error_abort);
+    g_autofree uint8_t *page = g_malloc(PAGE_SIZE);
+    uint64_t addr;
+    int i;
+
+    /* A whole set can be filled */
+    for (i = 0; i < 8; i++) {
+        addr = i * SET_STRIDE;
+        fill_page(page, addr, 0);
+        g_assert_cmpint(cache_insert(cache, addr, page, 0), ==, 0);
+    }
+
+    /* but fresh pages are not replaced */
+    addr = 8 * SET_STRIDE;
+    fill_page(page, addr, 0);
+    g_assert_cmpint(cache_insert(cache, addr, page, 1), ==, -1);
+
+    /* Page 0 is dirtied again a lot, so it survives the replacement */
+    for (i = 0; i < 8; i++) {
+        g_assert_true(cache_is_cached(cache, 0, 0));
+    }
+    g_assert_cmpint(cache_insert(cache, addr, page, 2), ==, 0);
+    g_assert_true(cache_is_cached(cache, addr, 2));
+    g_assert_true(cache_is_cached(cache, 0, 2));
+    g_assert_false(cache_is_cached(cache, SET_STRIDE, 2));
+
+    /* Other sets are not affected */
+    g_assert_cmpint(cache_insert(cache, PAGE_SIZE, page, 2), ==, 0);
+
+    cache_fini(cache);
+}
+
+static PageCache *thread_cache;
+
+static void *cache_thread(void *opaque)
+{
+    uint64_t base = (uintptr_t)opaque * PAGE_SIZE;
+    g_autofree uint8_t *page = g_malloc(PAGE_SIZE);
+    g_autofree uint8_t *buf = g_malloc(PAGE_SIZE);
+    int i;
+
+    for (i = 0; i < THREAD_LOOPS; i++) {
+        uint64_t addr = base + (i % CACHE_PAGES) * THREADS * PAGE_SIZE;
+
+        if (cache_lookup(thread_cache, addr, buf, i / CACHE_PAGES)) {
+            /* The page is always left with the last update of the loop */
+            fill_page(page, addr, i / CACHE_PAGES - 1);
+            g_assert_cmpint(memcmp(buf, page, PAGE_SIZE), ==, 0);
+            fill_page(page, addr, i / CACHE_PAGES);
+            cache_update(thread_cache, addr, page);
+        } else {
+            fill_page(page, addr, i / CACHE_PAGES);
+            cache_insert(thread_cache, addr, page, i / CACHE_PAGES);
+        }
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    QemuThread threads[THREADS];
+    uintptr_t i;
+
+    thread_cache = cache_init(CACHE_PAGES * PAGE_SIZE, PAGE_SIZE,
+                              &error_abort);
+    for (i = 0; i < THREADS; i++) {
+        qemu_thread_create(&threads[i], "page-cache", cache_thread,
+                           (void *)i, QEMU_THREAD_JOINABLE);
+    }
+    for (i = 0; i < THREADS; i++) {
+        qemu_thread_join(&threads[i]);
+    }
+    cache_fini(thread_cache);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/page_cache/init", test_init);
+    g_test_add_func("/page_cache/insert_lookup", test_insert_lookup);
+    g_test_add_func("/page_cache/replacement", test_replacement);
+    g_test_add_func("/page_cache/threads", test_threads);
+    return g_test_run();
+}
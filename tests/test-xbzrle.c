@@ -16,6 +16,8 @@
 #include "../migration/xbzrle.h"
 
 #define PAGE_SIZE 4096
+#define ACCEL_PAGES 1024
+#define BENCH_LOOPS 20
 
 static void test_uleb(void)
 {
@@ -174,6 +176,108 @@ static void test_encode_decode(void)
     }
 }
 
+/* Flip a few runs of bytes, from single bytes to most of the page */
+static void fill_accel_page(uint8_t *old_buf, uint8_t *new_buf)
+{
+    int runs = g_test_rand_int_range(0, 300);
+    int max_len = g_test_rand_int_range(1, 80);
+    int i, j;
+
+    for (i = 0; i < PAGE_SIZE; i++) {
+        old_buf[i] = g_test_rand_int();
+    }
+    memcpy(new_buf, old_buf, PAGE_SIZE);
+
+    for (i = 0; i < runs; i++) {
+        int start = g_test_rand_int_range(0, PAGE_SIZE);
+        int len = g_test_rand_int_range(1, max_len + 1);
+
+        for (j = start; j < MIN(start + len, PAGE_SIZE); j++) {
+            new_buf[j] ^= g_test_rand_int_range(1, 256);
+        }
+    }
+}
+
+static void bench_encode(uint8_t *old_buf, uint8_t *new_buf,
+                         uint8_t *compressed)
+{
+    gint64 start = g_get_monotonic_time();
+    double secs, mbps;
+    int i, j;
+
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        for (j = 0; j < ACCEL_PAGES; j++) {
+            xbzrle_encode_buffer(old_buf + j * PAGE_SIZE,
+                                 new_buf + j * PAGE_SIZE, PAGE_SIZE,
+                                 compressed, PAGE_SIZE);
+        }
+    }
+    secs = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+    mbps = (double)BENCH_LOOPS * ACCEL_PAGES * PAGE_SIZE / (1024 * 1024) / secs;
+
+    g_test_maximized_result(mbps, "encode: %.1f MB/s", mbps);
+}
+
+/*
+ * Every implementation of the encoder must produce exactly the same
+ * stream, including where it gives up because of overflow.
+ */
+static void test_encode_accel(void)
+{
+    uint8_t *old_buf = g_malloc(ACCEL_PAGES * PAGE_SIZE);
+    uint8_t *new_buf = g_malloc(ACCEL_PAGES * PAGE_SIZE);
+    uint8_t *expected = g_malloc(ACCEL_PAGES * PAGE_SIZE);
+    int *expected_len = g_new(int, ACCEL_PAGES);
+    uint8_t *compressed = g_malloc(PAGE_SIZE);
+    uint8_t *test = g_malloc(PAGE_SIZE);
+    bool first = true;
+    int i, rc, dlen;
+
+    for (i = 0; i < ACCEL_PAGES; i++) {
+        fill_accel_page(old_buf + i * PAGE_SIZE, new_buf + i * PAGE_SIZE);
+    }
+
+    do {
+        for (i = 0; i < ACCEL_PAGES; i++) {
+            dlen = xbzrle_encode_buffer(old_buf + i * PAGE_SIZE,
+                                        new_buf + i * PAGE_SIZE, PAGE_SIZE,
+                                        compressed, PAGE_SIZE);
+            if (first) {
+                expected_len[i] = dlen;
+                if (dlen > 0) {
+                    memcpy(expected + i * PAGE_SIZE, compressed, dlen);
+                }
+            } else {
+                g_assert_cmpint(dlen, ==, expected_len[i]);
+                if (dlen > 0) {
+                    g_assert(memcmp(compressed, expected + i * PAGE_SIZE,
+                                    dlen) == 0);
+                }
+            }
+
+            if (dlen >= 0) {
+                memcpy(test, old_buf + i * PAGE_SIZE, PAGE_SIZE);
+                rc = xbzrle_decode_buffer(compressed, dlen, test, PAGE_SIZE);
+                g_assert(rc <= PAGE_SIZE);
+                g_assert(memcmp(test, new_buf + i * PAGE_SIZE,
+                                PAGE_SIZE) == 0);
+            }
+        }
+
+        if (g_test_perf()) {
+            bench_encode(old_buf, new_buf, compressed);
+        }
+        first = false;
+    } while (test_xbzrle_encode_next_accel());
+
+    g_free(old_buf);
+    g_free(new_buf);
+    g_free(expected);
+    g_free(expected_len);
+    g_free(compressed);
+    g_free(test);
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
@@ -186,6 +290,8 @@ int main(int argc, char **argv)
     g_test_add_func("/xbzrle/encode_decode_overflow",
                     test_encode_decode_overflow);
     g_test_add_func("/xbzrle/encode_decode", test_encode_decode);
+    /* Must come last, it leaves the plain C encoder selected */
+    g_test_add_func("/xbzrle/encode_accel", test_encode_accel);
 
     return g_test_run();
 }